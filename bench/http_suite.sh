@@ -0,0 +1,23 @@
+#!/bin/bash
+# Runs every HTTP scenario through `fsk bench-http` and prints one line each.
+# Run from the repo root: bash bench/http_suite.sh [fsk binary] [extra bench-http options]
+# e.g. bash bench/http_suite.sh ./build/fsk -c 128 -d 15
+# Keep the output of a known-good build to compare against.
+FSK=${1:-fsk}
+shift
+run() {
+    local name=$1
+    shift
+    printf "%-8s " "$name"
+    "$FSK" bench-http "$@" --json "${EXTRA[@]}" 2>/dev/null | sed -E \
+        's/.*"errors":([0-9]+).*"p50":([0-9]+).*"p99":([0-9]+).*"p999":([0-9]+).*"rps":([0-9.]+).*/rps \5  p50 \2us  p99 \3us  p99.9 \4us  errors \1/'
+}
+EXTRA=("$@")
+
+run hello  bench/http_hello.fsk
+run echo   bench/http_echo.fsk --path /echo --body @bench/data/echo.json
+run routes bench/http_routes.fsk --path /users/42/posts/7
+run static bench/http_static.fsk --path /files/echo.json
+run sqlite bench/http_sqlite.fsk --path /users/42
+run cached bench/http_cache.fsk --path /users
+run many   bench/http_concurrency.fsk -c 1024
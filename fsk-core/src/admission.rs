@@ -0,0 +1,169 @@
+use std::ffi::CString;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+use axum::{body::Body, http::{header, HeaderValue, StatusCode}, response::Response};
+use libc::{c_char, c_void};
+
+/// What an interpreter's event loop reports about itself, from any thread.
+#[repr(C)]
+#[derive(Default, Clone, Copy)]
+pub struct FskLoopLoad {
+    /// Tasks posted to the loop and not started yet.
+    pub queue_depth: u64,
+    /// How long the oldest of them has been waiting, in microseconds.
+    pub lag_us: u64,
+}
+
+/// (context, out): fills `out` for the interpreter behind `context`.
+pub type FskLoopLoadCallback = extern "C" fn(*mut c_void, *mut FskLoopLoad);
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum Rejection {
+    InFlight,
+    Queue,
+    Lag,
+}
+
+/// Limits past which a request is answered 503 before it reaches an
+/// interpreter. Zero means no limit.
+#[derive(Clone, Copy, Default)]
+pub struct Limits {
+    pub max_in_flight: usize,
+    pub max_queue_depth: u64,
+    pub max_loop_lag_us: u64,
+    pub retry_after_secs: u32,
+}
+
+/// Admission control and its counters for one server. Static files and
+/// cache hits never get here: they don't cost the interpreters anything.
+pub struct Admission {
+    port: u16,
+    limits: Limits,
+    load: Option<FskLoopLoadCallback>,
+    contexts: Vec<usize>,
+    in_flight: AtomicUsize,
+    peak_in_flight: AtomicUsize,
+    admitted: AtomicU64,
+    rejected_in_flight: AtomicU64,
+    rejected_queue: AtomicU64,
+    rejected_lag: AtomicU64,
+}
+
+/// An admitted request; it stops counting as in flight when dropped.
+pub struct Admitted {
+    admission: Arc<Admission>,
+}
+
+impl Drop for Admitted {
+    fn drop(&mut self) {
+        self.admission.in_flight.fetch_sub(1, Ordering::AcqRel);
+    }
+}
+
+impl Admission {
+    pub fn new(port: u16, limits: Limits, load: Option<FskLoopLoadCallback>, contexts: Vec<usize>) -> Admission {
+        Admission {
+            port,
+            limits,
+            load,
+            contexts,
+            in_flight: AtomicUsize::new(0),
+            peak_in_flight: AtomicUsize::new(0),
+            admitted: AtomicU64::new(0),
+            rejected_in_flight: AtomicU64::new(0),
+            rejected_queue: AtomicU64::new(0),
+            rejected_lag: AtomicU64::new(0),
+        }
+    }
+
+    fn load_of(&self, context: usize) -> FskLoopLoad {
+        let mut load = FskLoopLoad::default();
+        if let Some(callback) = self.load {
+            callback(context as *mut c_void, &mut load);
+        }
+        load
+    }
+
+    /// Lets a request bound for the isolate behind `context` in, or says which
+    /// limit turned it away.
+    pub fn admit(self: &Arc<Self>, context: usize) -> Result<Admitted, Rejection> {
+        let limits = &self.limits;
+        if limits.max_queue_depth > 0 || limits.max_loop_lag_us > 0 {
+            let load = self.load_of(context);
+            if limits.max_queue_depth > 0 && load.queue_depth >= limits.max_queue_depth {
+                self.rejected_queue.fetch_add(1, Ordering::Relaxed);
+                return Err(Rejection::Queue);
+            }
+            if limits.max_loop_lag_us > 0 && load.lag_us >= limits.max_loop_lag_us {
+                self.rejected_lag.fetch_add(1, Ordering::Relaxed);
+                return Err(Rejection::Lag);
+            }
+        }
+        let now = self.in_flight.fetch_add(1, Ordering::AcqRel) + 1;
+        if limits.max_in_flight > 0 && now > limits.max_in_flight {
+            self.in_flight.fetch_sub(1, Ordering::AcqRel);
+            self.rejected_in_flight.fetch_add(1, Ordering::Relaxed);
+            return Err(Rejection::InFlight);
+        }
+        self.peak_in_flight.fetch_max(now, Ordering::Relaxed);
+        self.admitted.fetch_add(1, Ordering::Relaxed);
+        Ok(Admitted { admission: self.clone() })
+    }
+
+    /// 503 with Retry-After, sent without reading the request body.
+    pub fn reject(&self, reason: Rejection) -> Response<Body> {
+        let reason = match reason {
+            Rejection::InFlight => "too many requests in flight",
+            Rejection::Queue => "event loop queue full",
+            Rejection::Lag => "event loop lagging",
+        };
+        let mut response = Response::new(Body::from(format!("Service Unavailable ({})", reason)));
+        *response.status_mut() = StatusCode::SERVICE_UNAVAILABLE;
+        response.headers_mut().insert(header::RETRY_AFTER, HeaderValue::from(self.limits.retry_after_secs.max(1)));
+        response
+    }
+
+    pub fn stats(&self) -> serde_json::Value {
+        let loads: Vec<FskLoopLoad> = self.contexts.iter().map(|&c| self.load_of(c)).collect();
+        let in_flight_limit = |n: usize| if n == 0 { serde_json::Value::Null } else { serde_json::json!(n) };
+        let u64_limit = |n: u64| if n == 0 { serde_json::Value::Null } else { serde_json::json!(n) };
+        let rejected_in_flight = self.rejected_in_flight.load(Ordering::Relaxed);
+        let rejected_queue = self.rejected_queue.load(Ordering::Relaxed);
+        let rejected_lag = self.rejected_lag.load(Ordering::Relaxed);
+        serde_json::json!({
+            "port": self.port,
+            "inFlight": self.in_flight.load(Ordering::Relaxed),
+            "peakInFlight": self.peak_in_flight.load(Ordering::Relaxed),
+            "admitted": self.admitted.load(Ordering::Relaxed),
+            "rejected": rejected_in_flight + rejected_queue + rejected_lag,
+            "rejectedInFlight": rejected_in_flight,
+            "rejectedQueue": rejected_queue,
+            "rejectedLag": rejected_lag,
+            "queued": loads.iter().map(|l| l.queue_depth).sum::<u64>(),
+            "loopLagMs": loads.iter().map(|l| l.lag_us).max().unwrap_or(0) as f64 / 1000.0,
+            "limits": {
+                "maxInFlight": in_flight_limit(self.limits.max_in_flight),
+                "maxQueueDepth": u64_limit(self.limits.max_queue_depth),
+                "maxLoopLagMs": u64_limit(self.limits.max_loop_lag_us / 1000),
+            },
+        })
+    }
+}
+
+lazy_static::lazy_static! {
+    // Every server's admission state, for fsk_http_stats.
+    pub static ref SERVERS: Mutex<Vec<Arc<Admission>>> = Mutex::new(Vec::new());
+}
+
+pub fn register(admission: Arc<Admission>) {
+    SERVERS.lock().unwrap_or_else(|e| e.into_inner()).push(admission);
+}
+
+/// Counters of every server in this process, as a JSON array. Free the
+/// string with fsk_free_string.
+#[no_mangle]
+pub extern "C" fn fsk_http_stats() -> *mut c_char {
+    let servers = SERVERS.lock().unwrap_or_else(|e| e.into_inner());
+    let stats: Vec<serde_json::Value> = servers.iter().map(|server| server.stats()).collect();
+    CString::new(serde_json::Value::Array(stats).to_string()).unwrap().into_raw()
+}
@@ -0,0 +1,408 @@
+use std::collections::{BTreeMap, HashMap};
+use std::ffi::{CStr, CString};
+use std::hint::black_box;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Barrier, Mutex};
+use std::time::{Duration, Instant};
+use libc::c_char;
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+use tokio::net::TcpStream;
+use crate::runtime::RUNTIME;
+use crate::shard::ShardedMap;
+
+/// What `fsk bench-http` asks for: one request, replayed over `connections`
+/// keep-alive connections to 127.0.0.1:`port` for `duration_ms`. Requests
+/// answered during the first `warmup_ms` are not counted.
+#[repr(C)]
+pub struct FskBenchOptions {
+    pub port: u16,
+    pub method: *const c_char,
+    pub path: *const c_char,
+    pub content_type: *const c_char,
+    pub body: *const c_char,
+    pub body_len: usize,
+    pub connections: u32,
+    pub duration_ms: u64,
+    pub warmup_ms: u64,
+}
+
+/// What one connection measured. Latencies are in microseconds.
+#[derive(Default)]
+struct Tally {
+    latencies: Vec<u32>,
+    errors: u64,
+    bytes: u64,
+    statuses: BTreeMap<u16, u64>,
+}
+
+/// Reads HTTP/1.1 responses off one connection, keeping whatever was read
+/// past the end of the previous one.
+struct Reader {
+    stream: TcpStream,
+    buf: Vec<u8>,
+}
+
+/// Status, body size, and whether the server will close the connection.
+struct Answer {
+    status: u16,
+    body: usize,
+    close: bool,
+}
+
+impl Reader {
+    async fn fill(&mut self) -> std::io::Result<()> {
+        let start = self.buf.len();
+        self.buf.resize(start + 16 * 1024, 0);
+        let n = self.stream.read(&mut self.buf[start..]).await?;
+        self.buf.truncate(start + n);
+        if n == 0 {
+            return Err(std::io::ErrorKind::UnexpectedEof.into());
+        }
+        Ok(())
+    }
+
+    /// Offset of the first CRLF in the buffer, reading until there is one.
+    async fn line(&mut self) -> std::io::Result<usize> {
+        loop {
+            if let Some(i) = self.buf.windows(2).position(|w| w == b"\r\n") {
+                return Ok(i);
+            }
+            self.fill().await?;
+        }
+    }
+
+    async fn response(&mut self, head_request: bool) -> std::io::Result<Answer> {
+        let head_end = loop {
+            if let Some(i) = self.buf.windows(4).position(|w| w == b"\r\n\r\n") {
+                break i;
+            }
+            self.fill().await?;
+        };
+        let head = String::from_utf8_lossy(&self.buf[..head_end]).into_owned();
+        self.buf.drain(..head_end + 4);
+
+        let mut lines = head.split("\r\n");
+        let status_line = lines.next().unwrap_or("");
+        let status = status_line
+            .split(' ')
+            .nth(1)
+            .and_then(|s| s.parse::<u16>().ok())
+            .ok_or_else(|| std::io::Error::new(std::io::ErrorKind::InvalidData, "bad status line"))?;
+        let mut length: Option<usize> = None;
+        let mut chunked = false;
+        let mut close = status_line.starts_with("HTTP/1.0");
+        for line in lines {
+            let (name, value) = match line.split_once(':') {
+                Some(pair) => pair,
+                None => continue,
+            };
+            let value = value.trim().to_ascii_lowercase();
+            match name.trim().to_ascii_lowercase().as_str() {
+                "content-length" => length = value.parse().ok(),
+                "transfer-encoding" => chunked = value.contains("chunked"),
+                "connection" => close = value.contains("close"),
+                _ => {}
+            }
+        }
+
+        let no_body = head_request || status == 204 || status == 304 || (100..200).contains(&status);
+        let body = if no_body {
+            0
+        } else if chunked {
+            self.chunked().await?
+        } else if let Some(length) = length {
+            while self.buf.len() < length {
+                self.fill().await?;
+            }
+            self.buf.drain(..length);
+            length
+        } else {
+            // Delimited by the close: read it all.
+            let mut total = self.buf.len();
+            self.buf.clear();
+            while self.fill().await.is_ok() {
+                total += self.buf.len();
+                self.buf.clear();
+            }
+            close = true;
+            total
+        };
+        Ok(Answer { status, body, close })
+    }
+
+    async fn chunked(&mut self) -> std::io::Result<usize> {
+        let mut total = 0;
+        loop {
+            let end = self.line().await?;
+            let size_text = String::from_utf8_lossy(&self.buf[..end]).into_owned();
+            let size = usize::from_str_radix(size_text.split(';').next().unwrap_or("").trim(), 16)
+                .map_err(|_| std::io::Error::new(std::io::ErrorKind::InvalidData, "bad chunk size"))?;
+            self.buf.drain(..end + 2);
+            if size == 0 {
+                // Trailers, then the blank line.
+                loop {
+                    let end = self.line().await?;
+                    self.buf.drain(..end + 2);
+                    if end == 0 {
+                        return Ok(total);
+                    }
+                }
+            }
+            while self.buf.len() < size + 2 {
+                self.fill().await?;
+            }
+            self.buf.drain(..size + 2);
+            total += size;
+        }
+    }
+}
+
+/// One connection's closed loop: send, wait for the whole answer, repeat.
+/// Reconnects (counting an error) when the server drops it.
+async fn connection(port: u16, request: std::sync::Arc<Vec<u8>>, head: bool, measure_from: Instant, stop_at: Instant) -> Tally {
+    let mut tally = Tally::default();
+    let mut reader: Option<Reader> = None;
+    while Instant::now() < stop_at {
+        if reader.is_none() {
+            match TcpStream::connect(("127.0.0.1", port)).await {
+                Ok(stream) => {
+                    let _ = stream.set_nodelay(true);
+                    reader = Some(Reader { stream, buf: Vec::with_capacity(16 * 1024) });
+                }
+                Err(_) => {
+                    if Instant::now() >= measure_from {
+                        tally.errors += 1;
+                    }
+                    tokio::time::sleep(Duration::from_millis(10)).await;
+                    continue;
+                }
+            }
+        }
+        let conn = reader.as_mut().unwrap();
+        let sent = Instant::now();
+        let result = match conn.stream.write_all(&request).await {
+            Ok(()) => tokio::time::timeout_at(stop_at.into(), conn.response(head)).await,
+            Err(e) => Ok(Err(e)),
+        };
+        match result {
+            // Still waiting when time ran out: not a failure, just not counted.
+            Err(_) => break,
+            Ok(Ok(answer)) => {
+                let done = Instant::now();
+                if sent >= measure_from {
+                    tally.latencies.push(done.duration_since(sent).as_micros().min(u32::MAX as u128) as u32);
+                    tally.bytes += answer.body as u64;
+                    *tally.statuses.entry(answer.status).or_insert(0) += 1;
+                }
+                if answer.close {
+                    reader = None;
+                }
+            }
+            Ok(Err(_)) => {
+                if sent >= measure_from {
+                    tally.errors += 1;
+                }
+                reader = None;
+            }
+        }
+    }
+    tally
+}
+
+fn percentile(sorted: &[u32], p: f64) -> u32 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let rank = ((p / 100.0) * sorted.len() as f64).ceil() as usize;
+    sorted[rank.clamp(1, sorted.len()) - 1]
+}
+
+fn build_request(method: &str, path: &str, content_type: &str, body: &[u8]) -> Vec<u8> {
+    let mut request = format!("{} {} HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: fsk-bench\r\nAccept: */*\r\n", method, path).into_bytes();
+    if !body.is_empty() || method == "POST" || method == "PUT" || method == "PATCH" {
+        if !content_type.is_empty() {
+            request.extend_from_slice(format!("Content-Type: {}\r\n", content_type).as_bytes());
+        }
+        request.extend_from_slice(format!("Content-Length: {}\r\n", body.len()).as_bytes());
+    }
+    request.extend_from_slice(b"\r\n");
+    request.extend_from_slice(body);
+    request
+}
+
+/// Runs the load and reports as JSON: requests, errors, seconds, rps, bytes,
+/// p50/p90/p99/p999/max and mean latency in microseconds, and a count per status.
+pub fn run(port: u16, method: &str, path: &str, content_type: &str, body: &[u8], connections: u32, duration: Duration, warmup: Duration) -> serde_json::Value {
+    let request = std::sync::Arc::new(build_request(method, path, content_type, body));
+    let head = method.eq_ignore_ascii_case("HEAD");
+    let tallies = RUNTIME.block_on(async {
+        let start = Instant::now();
+        let measure_from = start + warmup;
+        let stop_at = measure_from + duration;
+        let tasks: Vec<_> = (0..connections.max(1))
+            .map(|_| tokio::spawn(connection(port, request.clone(), head, measure_from, stop_at)))
+            .collect();
+        let mut tallies = Vec::with_capacity(tasks.len());
+        for task in tasks {
+            if let Ok(tally) = task.await {
+                tallies.push(tally);
+            }
+        }
+        tallies
+    });
+
+    let mut latencies = Vec::with_capacity(tallies.iter().map(|t| t.latencies.len()).sum());
+    let mut errors = 0;
+    let mut bytes = 0;
+    let mut statuses: BTreeMap<u16, u64> = BTreeMap::new();
+    for tally in tallies {
+        latencies.extend_from_slice(&tally.latencies);
+        errors += tally.errors;
+        bytes += tally.bytes;
+        for (status, count) in tally.statuses {
+            *statuses.entry(status).or_insert(0) += count;
+        }
+    }
+    latencies.sort_unstable();
+    let seconds = duration.as_secs_f64();
+    let mean = if latencies.is_empty() { 0.0 } else { latencies.iter().map(|&l| l as f64).sum::<f64>() / latencies.len() as f64 };
+    serde_json::json!({
+        "requests": latencies.len(),
+        "errors": errors,
+        "seconds": seconds,
+        "rps": latencies.len() as f64 / seconds.max(0.001),
+        "bytes": bytes,
+        "connections": connections.max(1),
+        "latency_us": {
+            "mean": mean,
+            "p50": percentile(&latencies, 50.0),
+            "p90": percentile(&latencies, 90.0),
+            "p99": percentile(&latencies, 99.0),
+            "p999": percentile(&latencies, 99.9),
+            "max": latencies.last().copied().unwrap_or(0),
+        },
+        "status": statuses.iter().map(|(s, c)| (s.to_string(), serde_json::json!(c))).collect::<serde_json::Map<_, _>>(),
+    })
+}
+
+fn text(ptr: *const c_char, default: &str) -> String {
+    if ptr.is_null() {
+        default.to_string()
+    } else {
+        unsafe { CStr::from_ptr(ptr).to_string_lossy().into_owned() }
+    }
+}
+
+/// Runs the load described by `options` and returns the JSON report. Free it
+/// with fsk_free_string.
+#[no_mangle]
+pub extern "C" fn fsk_bench_http(options: *const FskBenchOptions) -> *mut c_char {
+    let options = unsafe { &*options };
+    let body: &[u8] = if options.body.is_null() || options.body_len == 0 {
+        &[]
+    } else {
+        unsafe { std::slice::from_raw_parts(options.body as *const u8, options.body_len) }
+    };
+    let report = run(
+        options.port,
+        &text(options.method, "GET"),
+        &text(options.path, "/"),
+        &text(options.content_type, ""),
+        body,
+        options.connections,
+        Duration::from_millis(options.duration_ms.max(1)),
+        Duration::from_millis(options.warmup_ms),
+    );
+    CString::new(report.to_string()).unwrap().into_raw()
+}
+
+
+/// Requests each thread keeps pending at once in `fsk bench-ids`, like a
+/// worker with several responses outstanding.
+const IDS_IN_FLIGHT: u64 = 16;
+
+/// The bridge's per-request id bookkeeping before sharding: one locked counter
+/// and one locked table for every thread.
+struct LockedIds {
+    next: Mutex<u64>,
+    pending: Mutex<HashMap<u64, u64>>,
+}
+
+/// What every HTTP request does on the Rust side: take an id, park its
+/// response slot under that id, then take the slot back when the interpreter
+/// answers. `batch` does IDS_IN_FLIGHT of them; `threads` threads run batches
+/// until `requests` are done between them. Returns wall time per request in
+/// nanoseconds, best of three runs.
+fn id_lifecycle(threads: u32, requests: u64, batch: impl Fn() + Sync) -> f64 {
+    let batches = (requests / threads as u64 / IDS_IN_FLIGHT).max(1);
+    let mut best = f64::MAX;
+    for _ in 0..3 {
+        let barrier = Barrier::new(threads as usize + 1);
+        let start = std::thread::scope(|scope| {
+            for _ in 0..threads {
+                scope.spawn(|| {
+                    barrier.wait();
+                    for _ in 0..batches {
+                        batch();
+                    }
+                });
+            }
+            barrier.wait();
+            Instant::now()
+        });
+        // The scope has joined every thread by now.
+        let ns = start.elapsed().as_nanos() as f64 / (batches * IDS_IN_FLIGHT * threads as u64) as f64;
+        best = best.min(ns);
+    }
+    best
+}
+
+/// Runs the id lifecycle on `threads` threads against the old layout (locked
+/// counter and table) and the current one (an atomic counter like NEXT_REQ_ID
+/// and a ShardedMap like PENDING_REQUESTS), and reports ns/request for each.
+pub fn id_tables(threads: u32, requests: u64) -> serde_json::Value {
+    let threads = threads.max(1);
+    let locked = LockedIds { next: Mutex::new(1), pending: Mutex::new(HashMap::new()) };
+    let locked_ns = id_lifecycle(threads, requests, || {
+        let mut ids = [0u64; IDS_IN_FLIGHT as usize];
+        for slot in ids.iter_mut() {
+            *slot = {
+                let mut next = locked.next.lock().unwrap();
+                let id = *next;
+                *next += 1;
+                id
+            };
+            locked.pending.lock().unwrap().insert(*slot, *slot);
+        }
+        for id in &ids {
+            black_box(locked.pending.lock().unwrap().remove(id));
+        }
+    });
+
+    let next = AtomicU64::new(1);
+    let pending: ShardedMap<u64> = ShardedMap::new();
+    let sharded_ns = id_lifecycle(threads, requests, || {
+        let mut ids = [0u64; IDS_IN_FLIGHT as usize];
+        for slot in ids.iter_mut() {
+            *slot = next.fetch_add(1, Ordering::Relaxed);
+            pending.insert(*slot, *slot);
+        }
+        for id in &ids {
+            black_box(pending.remove(*id));
+        }
+    });
+
+    serde_json::json!({
+        "threads": threads,
+        "requests": (requests / threads as u64 / IDS_IN_FLIGHT).max(1) * IDS_IN_FLIGHT * threads as u64,
+        "locked_ns": locked_ns,
+        "sharded_ns": sharded_ns,
+    })
+}
+
+/// Runs `fsk bench-ids` for one thread count and returns the JSON report. Free
+/// it with fsk_free_string.
+#[no_mangle]
+pub extern "C" fn fsk_bench_ids(threads: u32, requests: u64) -> *mut c_char {
+    CString::new(id_tables(threads, requests).to_string()).unwrap().into_raw()
+}
@@ -0,0 +1,322 @@
+use std::collections::{BTreeMap, HashMap};
+use std::ffi::CStr;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use axum::{body::{Body, Bytes}, http::{header, request::Parts, HeaderMap, HeaderName, HeaderValue, Method, StatusCode}, response::Response};
+use hyper::body::HttpBody;
+use libc::c_char;
+use crate::http::PENDING_REQUESTS;
+
+/// A single body may take at most this share of the cache.
+const MAX_ENTRY_SHARE: usize = 8;
+
+/// What a handler asked for with `res.cache(ttlMs, varyKeys, staleMs)`. It rides
+/// along with the response as an extension until the server stores it.
+#[derive(Clone)]
+pub struct CacheDirective {
+    pub ttl: Duration,
+    pub stale: Duration,
+    pub vary: Vec<HeaderName>,
+}
+
+pub struct Entry {
+    base: String,
+    path: String,
+    status: StatusCode,
+    headers: HeaderMap,
+    body: Bytes,
+    stored: Instant,
+    ttl: Duration,
+    stale: Duration,
+    size: usize,
+    // Set while one request refreshes a stale entry, so the others don't pile on.
+    revalidating: AtomicBool,
+}
+
+impl Entry {
+    fn response(&self, age: Duration) -> Response<Body> {
+        let mut response = Response::new(Body::from(self.body.clone()));
+        *response.status_mut() = self.status;
+        *response.headers_mut() = self.headers.clone();
+        response.headers_mut().insert(header::AGE, HeaderValue::from(age.as_secs()));
+        response
+    }
+
+    /// Lets the next stale hit try again (the refresh failed or was not cacheable).
+    pub fn revalidated(&self) {
+        self.revalidating.store(false, Ordering::Release);
+    }
+}
+
+pub enum Lookup {
+    Fresh(Response<Body>),
+    /// Past its TTL but within its stale window. With an entry, this request
+    /// was picked to refresh it in the background.
+    Stale(Response<Body>, Option<Arc<Entry>>),
+    Miss,
+}
+
+#[derive(Default)]
+struct Inner {
+    // "GET /path?query" -> request headers its answers vary on, and how many
+    // entries it has (it goes with the last one).
+    vary: HashMap<String, (Vec<HeaderName>, usize)>,
+    // Full key (base key plus vary values) -> entry and its LRU tick.
+    entries: HashMap<String, (Arc<Entry>, u64)>,
+    lru: BTreeMap<u64, String>,
+    tick: u64,
+    bytes: usize,
+}
+
+impl Inner {
+    fn touch(&mut self, key: &str) {
+        self.tick += 1;
+        let tick = self.tick;
+        if let Some((_, old)) = self.entries.get_mut(key) {
+            let old = std::mem::replace(old, tick);
+            if let Some(k) = self.lru.remove(&old) {
+                self.lru.insert(tick, k);
+            }
+        }
+    }
+
+    fn remove(&mut self, key: &str) {
+        if let Some((entry, tick)) = self.entries.remove(key) {
+            self.lru.remove(&tick);
+            self.bytes -= entry.size;
+            if let Some((_, count)) = self.vary.get_mut(&entry.base) {
+                *count -= 1;
+                if *count == 0 {
+                    self.vary.remove(&entry.base);
+                }
+            }
+        }
+    }
+}
+
+/// Responses handlers opted into with res.cache(), answered by the server
+/// without entering the interpreter. Entries are keyed by method, path and
+/// query, and the request headers named in varyKeys; the least recently used
+/// go first once `max_bytes` is reached. A hit skips routing and FSK.use
+/// middleware too, so requests with credentials are never looked up or stored.
+pub struct ResponseCache {
+    max_bytes: usize,
+    inner: Mutex<Inner>,
+    // Bumped by purge: a response computed before a purge is not stored after it.
+    generation: AtomicU64,
+}
+
+fn base_key(method: &Method, uri: &axum::http::Uri) -> Option<String> {
+    // HEAD reads what GET stored; only GET answers are stored.
+    if method != Method::GET && method != Method::HEAD {
+        return None;
+    }
+    let target = uri.path_and_query().map(|p| p.as_str()).unwrap_or("/");
+    Some(format!("GET {}", target))
+}
+
+fn full_key(base: &str, vary: &[HeaderName], headers: &HeaderMap) -> String {
+    let mut key = base.to_string();
+    for name in vary {
+        key.push('\n');
+        for value in headers.get_all(name) {
+            key.push_str(&String::from_utf8_lossy(value.as_bytes()));
+            key.push(',');
+        }
+    }
+    key
+}
+
+/// Requests that may be answered per user: their answers are left to the handler.
+fn credentialed(headers: &HeaderMap) -> bool {
+    headers.contains_key(header::AUTHORIZATION) || headers.contains_key(header::COOKIE)
+}
+
+/// Answers that must not be shared between clients, or that other caches were told not to keep.
+fn storable(status: StatusCode, headers: &HeaderMap) -> bool {
+    if status != StatusCode::OK || headers.contains_key(header::SET_COOKIE) || headers.contains_key(header::CONTENT_ENCODING) {
+        return false;
+    }
+    !headers
+        .get_all(header::CACHE_CONTROL)
+        .iter()
+        .filter_map(|v| v.to_str().ok())
+        .any(|v| {
+            let v = v.to_ascii_lowercase();
+            v.contains("no-store") || v.contains("private")
+        })
+}
+
+impl ResponseCache {
+    pub fn new(max_bytes: usize) -> ResponseCache {
+        ResponseCache { max_bytes, inner: Mutex::new(Inner::default()), generation: AtomicU64::new(0) }
+    }
+
+    pub fn generation(&self) -> u64 {
+        self.generation.load(Ordering::Acquire)
+    }
+
+    pub fn lookup(&self, parts: &Parts) -> Lookup {
+        if credentialed(&parts.headers) {
+            return Lookup::Miss;
+        }
+        let base = match base_key(&parts.method, &parts.uri) {
+            Some(base) => base,
+            None => return Lookup::Miss,
+        };
+        let mut inner = self.inner.lock().unwrap_or_else(|e| e.into_inner());
+        let key = match inner.vary.get(&base) {
+            Some((vary, _)) => full_key(&base, vary, &parts.headers),
+            None => return Lookup::Miss,
+        };
+        let entry = match inner.entries.get(&key) {
+            Some((entry, _)) => entry.clone(),
+            None => return Lookup::Miss,
+        };
+        let age = entry.stored.elapsed();
+        if age < entry.ttl {
+            inner.touch(&key);
+            return Lookup::Fresh(entry.response(age));
+        }
+        if age < entry.ttl + entry.stale {
+            inner.touch(&key);
+            let refresh = !entry.revalidating.swap(true, Ordering::AcqRel);
+            let response = entry.response(age);
+            return Lookup::Stale(response, if refresh { Some(entry) } else { None });
+        }
+        inner.remove(&key);
+        Lookup::Miss
+    }
+
+    /// Keeps `response` when its request (`parts`) and the handler's directive
+    /// allow it, and hands back an equivalent response. `generation` is the
+    /// value from before the request was dispatched.
+    pub async fn store(&self, parts: &Parts, generation: u64, mut response: Response<Body>) -> Response<Body> {
+        let directive = match response.extensions_mut().remove::<CacheDirective>() {
+            Some(directive) => directive,
+            None => return response,
+        };
+        if parts.method != Method::GET
+            || directive.ttl.is_zero()
+            || credentialed(&parts.headers)
+            || !storable(response.status(), response.headers())
+        {
+            return response;
+        }
+        // Whole bodies only, and none that would push out most of the cache.
+        match response.body().size_hint().exact() {
+            Some(len) if (len as usize) <= self.max_bytes / MAX_ENTRY_SHARE => {}
+            _ => return response,
+        }
+        let base = match base_key(&parts.method, &parts.uri) {
+            Some(base) => base,
+            None => return response,
+        };
+
+        let (mut head, body) = response.into_parts();
+        // Downstream caches should split on the same headers.
+        for name in &directive.vary {
+            head.headers.append(header::VARY, HeaderValue::from_name(name.clone()));
+        }
+        let body = match hyper::body::to_bytes(body).await {
+            Ok(body) => body,
+            Err(_) => return Response::from_parts(head, Body::empty()),
+        };
+        let key = full_key(&base, &directive.vary, &parts.headers);
+        let size = key.len() + body.len() + head.headers.iter().map(|(n, v)| n.as_str().len() + v.len()).sum::<usize>();
+        let entry = Arc::new(Entry {
+            base: base.clone(),
+            path: parts.uri.path().to_string(),
+            status: head.status,
+            headers: head.headers.clone(),
+            body: body.clone(),
+            stored: Instant::now(),
+            ttl: directive.ttl,
+            stale: directive.stale,
+            size,
+            revalidating: AtomicBool::new(false),
+        });
+
+        {
+            let mut inner = self.inner.lock().unwrap_or_else(|e| e.into_inner());
+            if self.generation() == generation {
+                inner.remove(&key);
+                // Another vary set for the same URL orphans the old variants; LRU reclaims them.
+                let vary = inner.vary.entry(base).or_insert((Vec::new(), 0));
+                vary.0 = directive.vary;
+                vary.1 += 1;
+                inner.tick += 1;
+                let tick = inner.tick;
+                inner.bytes += size;
+                inner.lru.insert(tick, key.clone());
+                inner.entries.insert(key, (entry, tick));
+                while inner.bytes > self.max_bytes {
+                    let oldest = match inner.lru.iter().next() {
+                        Some((_, k)) => k.clone(),
+                        None => break,
+                    };
+                    inner.remove(&oldest);
+                }
+            }
+        }
+        Response::from_parts(head, Body::from(body))
+    }
+
+    /// Drops entries for `pattern`: an exact path, a prefix ending in `*`, or
+    /// `*` for everything. Returns how many went.
+    pub fn purge(&self, pattern: &str) -> usize {
+        let mut inner = self.inner.lock().unwrap_or_else(|e| e.into_inner());
+        self.generation.fetch_add(1, Ordering::AcqRel);
+        let matches = |path: &str| match pattern.strip_suffix('*') {
+            Some(prefix) => path.starts_with(prefix),
+            None => path == pattern,
+        };
+        let doomed: Vec<String> = inner
+            .entries
+            .iter()
+            .filter(|(_, (entry, _))| matches(&entry.path))
+            .map(|(key, _)| key.clone())
+            .collect();
+        for key in &doomed {
+            inner.remove(key);
+        }
+        doomed.len()
+    }
+}
+
+lazy_static::lazy_static! {
+    // Every server's cache, for fsk_http_cache_purge.
+    pub static ref CACHES: Mutex<Vec<Arc<ResponseCache>>> = Mutex::new(Vec::new());
+}
+
+pub fn register(cache: Arc<ResponseCache>) {
+    CACHES.lock().unwrap_or_else(|e| e.into_inner()).push(cache);
+}
+
+/// Marks the response to `req_id` as cacheable for `ttl_ms`, then served stale
+/// for up to `stale_ms` more while one request refreshes it. `vary` lists
+/// request header names, comma-separated. False if the request is unknown.
+#[no_mangle]
+pub extern "C" fn fsk_http_cache(req_id: u64, ttl_ms: u64, stale_ms: u64, vary: *const c_char) -> bool {
+    let vary = if vary.is_null() { String::new() } else { unsafe { CStr::from_ptr(vary).to_string_lossy().into_owned() } };
+    let directive = CacheDirective {
+        ttl: Duration::from_millis(ttl_ms),
+        stale: Duration::from_millis(stale_ms),
+        vary: vary
+            .split(',')
+            .map(|name| name.trim())
+            .filter(|name| !name.is_empty())
+            .filter_map(|name| HeaderName::from_bytes(name.to_ascii_lowercase().as_bytes()).ok())
+            .collect(),
+    };
+    PENDING_REQUESTS.with(req_id, |handle| handle.cache = Some(directive)).is_some()
+}
+
+/// Purges `pattern` (see ResponseCache::purge) from every server's cache.
+#[no_mangle]
+pub extern "C" fn fsk_http_cache_purge(pattern: *const c_char) -> u64 {
+    let pattern = unsafe { CStr::from_ptr(pattern).to_string_lossy().into_owned() };
+    let caches = CACHES.lock().unwrap_or_else(|e| e.into_inner());
+    caches.iter().map(|cache| cache.purge(&pattern) as u64).sum()
+}
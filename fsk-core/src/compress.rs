@@ -0,0 +1,289 @@
+use std::collections::hash_map::RandomState;
+use std::collections::{HashMap, HashSet};
+use std::hash::{BuildHasher, Hash, Hasher};
+use std::sync::Mutex;
+use axum::{body::{Body, Bytes}, http::{header, HeaderMap, HeaderValue, StatusCode}, response::Response};
+use std::cell::RefCell;
+use flate2::{Compress, Compression, Crc, FlushCompress, Status};
+use hyper::body::HttpBody;
+
+/// Bytes of compressed bodies kept for reuse by one server.
+const CACHE_BYTES_MAX: usize = 32 * 1024 * 1024;
+/// Distinct bodies remembered while waiting for a second sighting.
+const SEEN_MAX: usize = 4096;
+/// Level for bodies kept in the cache: they are compressed once, so spend more.
+const CACHED_LEVEL: u32 = 9;
+/// Bodies above this are compressed off the runtime's worker threads.
+const BLOCKING_ABOVE: usize = 256 * 1024;
+
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Debug)]
+pub enum Encoding {
+    Gzip,
+    Deflate,
+}
+
+impl Encoding {
+    fn name(self) -> &'static str {
+        match self {
+            Encoding::Gzip => "gzip",
+            Encoding::Deflate => "deflate",
+        }
+    }
+}
+
+/// Picks gzip or deflate from Accept-Encoding, honouring q-values ("q=0" refuses).
+/// gzip wins ties since every client that sends deflate also takes gzip.
+pub fn negotiate(accept: &str) -> Option<Encoding> {
+    let mut best: Option<(Encoding, f32)> = None;
+    for item in accept.split(',') {
+        let mut parts = item.split(';');
+        let name = parts.next().unwrap_or("").trim().to_ascii_lowercase();
+        let q = parts
+            .filter_map(|p| p.trim().strip_prefix("q="))
+            .next()
+            .and_then(|q| q.trim().parse::<f32>().ok())
+            .unwrap_or(1.0);
+        let encoding = match name.as_str() {
+            "gzip" | "x-gzip" | "*" => Encoding::Gzip,
+            "deflate" => Encoding::Deflate,
+            _ => continue,
+        };
+        if q > 0.0 && best.map_or(true, |(e, bq)| q > bq || (q == bq && encoding == Encoding::Gzip && e != Encoding::Gzip)) {
+            best = Some((encoding, q));
+        }
+    }
+    best.map(|(e, _)| e)
+}
+
+/// Content types worth compressing: text and the structured formats APIs send.
+/// Images, video and archives are already compressed.
+pub fn compressible(content_type: &str) -> bool {
+    let essence = content_type.split(';').next().unwrap_or("").trim().to_ascii_lowercase();
+    essence.starts_with("text/")
+        || essence.ends_with("+json")
+        || essence.ends_with("+xml")
+        || matches!(
+            essence.as_str(),
+            "application/json" | "application/javascript" | "application/xml" | "application/wasm" | "image/svg+xml"
+        )
+}
+
+thread_local! {
+    // miniz's compressor state is ~300 KB; building one per response costs more
+    // than compressing a typical API body, so each thread keeps and resets its own.
+    static DEFLATERS: RefCell<Vec<(u32, bool, Compress)>> = RefCell::new(Vec::new());
+}
+
+fn deflate_into(out: &mut Vec<u8>, data: &[u8], level: u32, zlib: bool) {
+    DEFLATERS.with(|cell| {
+        let mut deflaters = cell.borrow_mut();
+        let index = match deflaters.iter().position(|(l, z, _)| *l == level && *z == zlib) {
+            Some(index) => index,
+            None => {
+                deflaters.push((level, zlib, Compress::new(Compression::new(level), zlib)));
+                deflaters.len() - 1
+            }
+        };
+        let deflater = &mut deflaters[index].2;
+        deflater.reset();
+        let start = deflater.total_in();
+        loop {
+            let consumed = (deflater.total_in() - start) as usize;
+            out.reserve(data.len() / 4 + 64);
+            let status = deflater.compress_vec(&data[consumed..], out, FlushCompress::Finish).expect("deflate into a Vec");
+            if status == Status::StreamEnd {
+                break;
+            }
+        }
+    });
+}
+
+pub fn compress(encoding: Encoding, data: &[u8], level: u32) -> Bytes {
+    let mut out = Vec::with_capacity(data.len() / 3 + 64);
+    match encoding {
+        Encoding::Gzip => {
+            // RFC 1952 framing around a raw deflate stream.
+            out.extend_from_slice(&[0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff]);
+            deflate_into(&mut out, data, level, false);
+            let mut crc = Crc::new();
+            crc.update(data);
+            out.extend_from_slice(&crc.sum().to_le_bytes());
+            out.extend_from_slice(&(data.len() as u32).to_le_bytes());
+        }
+        // HTTP "deflate" is the zlib format, not raw deflate.
+        Encoding::Deflate => deflate_into(&mut out, data, level, true),
+    }
+    Bytes::from(out)
+}
+
+/// Negotiated response compression for one server. Bodies are compressed on the
+/// runtime side, never on an interpreter thread, at a fast level. A body seen a
+/// second time (same bytes and type) is compressed again at CACHED_LEVEL and
+/// kept, so hot JSON and static files pay once.
+pub struct Compressor {
+    min_size: usize,
+    level: u32,
+    cache: Mutex<HashMap<(u64, Encoding), Bytes>>,
+    cached_bytes: Mutex<usize>,
+    seen: Mutex<HashSet<u64>>,
+    // Keyed per server, so a client cannot craft a body that collides with another.
+    hasher: RandomState,
+}
+
+impl Compressor {
+    /// `level` (0-9) is used for bodies seen once.
+    pub fn new(min_size: usize, level: u32) -> Compressor {
+        Compressor {
+            min_size,
+            level: level.min(9),
+            cache: Mutex::new(HashMap::new()),
+            cached_bytes: Mutex::new(0),
+            seen: Mutex::new(HashSet::new()),
+            hasher: RandomState::new(),
+        }
+    }
+
+    /// Compresses `response` for a client that sent `accept` (Accept-Encoding),
+    /// when its type, size and status allow. Streaming bodies pass through.
+    pub async fn apply(&self, accept: Option<&HeaderValue>, response: Response<Body>) -> Response<Body> {
+        let encoding = match accept.and_then(|v| v.to_str().ok()).and_then(negotiate) {
+            Some(encoding) => encoding,
+            None => return self.vary(response),
+        };
+        if !self.eligible(response.status(), response.headers()) {
+            return self.vary(response);
+        }
+        // Only whole bodies: a stream's size is not known up front.
+        match response.body().size_hint().exact() {
+            Some(len) if len as usize >= self.min_size => {}
+            _ => return self.vary(response),
+        }
+
+        let (mut parts, body) = response.into_parts();
+        let data = match hyper::body::to_bytes(body).await {
+            Ok(data) => data,
+            Err(_) => return Response::from_parts(parts, Body::empty()),
+        };
+        let key = self.cache_key(&parts.headers, &data);
+        let compressed = match self.cached(key, encoding) {
+            Some(compressed) => compressed,
+            None => {
+                let hot = self.seen_before(key);
+                let level = if hot { CACHED_LEVEL } else { self.level };
+                let compressed = if data.len() > BLOCKING_ABOVE {
+                    let input = data.clone();
+                    tokio::task::spawn_blocking(move || compress(encoding, &input, level)).await.ok()
+                } else {
+                    Some(compress(encoding, &data, level))
+                };
+                match compressed {
+                    Some(compressed) => {
+                        if hot {
+                            self.store(key, encoding, &compressed);
+                        }
+                        compressed
+                    }
+                    None => return self.vary(Response::from_parts(parts, Body::from(data))),
+                }
+            }
+        };
+        // Compression that doesn't pay (tiny or random-looking bodies) is skipped.
+        if compressed.len() >= data.len() {
+            return self.vary(Response::from_parts(parts, Body::from(data)));
+        }
+
+        let headers = &mut parts.headers;
+        headers.insert(header::CONTENT_ENCODING, HeaderValue::from_static(encoding.name()));
+        headers.insert(header::CONTENT_LENGTH, HeaderValue::from(compressed.len()));
+        // The compressed bytes are another representation: a strong ETag must not match both.
+        if let Some(etag) = headers.get(header::ETAG).and_then(|v| v.to_str().ok()) {
+            if !etag.starts_with("W/") {
+                if let Ok(weak) = HeaderValue::from_str(&format!("W/{}", etag)) {
+                    headers.insert(header::ETAG, weak);
+                }
+            }
+        }
+        add_vary(Response::from_parts(parts, Body::from(compressed)))
+    }
+
+    fn eligible(&self, status: StatusCode, headers: &HeaderMap) -> bool {
+        if status == StatusCode::NO_CONTENT || status == StatusCode::NOT_MODIFIED || status == StatusCode::PARTIAL_CONTENT {
+            return false;
+        }
+        if headers.contains_key(header::CONTENT_ENCODING) || headers.contains_key(header::CONTENT_RANGE) {
+            return false;
+        }
+        let no_transform = headers
+            .get_all(header::CACHE_CONTROL)
+            .iter()
+            .filter_map(|v| v.to_str().ok())
+            .any(|v| v.to_ascii_lowercase().contains("no-transform"));
+        // Untyped bodies are the strings Fsk handlers send: treat them as text.
+        let content_type = headers.get(header::CONTENT_TYPE).and_then(|v| v.to_str().ok()).unwrap_or("text/plain");
+        !no_transform && compressible(content_type)
+    }
+
+    /// Every answer that could have been compressed varies on Accept-Encoding,
+    /// compressed or not, so shared caches keep the two apart.
+    fn vary(&self, response: Response<Body>) -> Response<Body> {
+        if self.eligible(response.status(), response.headers()) {
+            add_vary(response)
+        } else {
+            response
+        }
+    }
+
+    fn cached(&self, key: u64, encoding: Encoding) -> Option<Bytes> {
+        self.cache.lock().unwrap().get(&(key, encoding)).cloned()
+    }
+
+    /// Records `key`; true if it was already there. One-off bodies never get
+    /// further than this set.
+    fn seen_before(&self, key: u64) -> bool {
+        let mut seen = self.seen.lock().unwrap();
+        if seen.contains(&key) {
+            return true;
+        }
+        if seen.len() >= SEEN_MAX {
+            seen.clear();
+        }
+        seen.insert(key);
+        false
+    }
+
+    fn store(&self, key: u64, encoding: Encoding, compressed: &Bytes) {
+        let mut cache = self.cache.lock().unwrap();
+        let mut bytes = self.cached_bytes.lock().unwrap();
+        // Over budget: start over, like the static file cache.
+        if *bytes + compressed.len() > CACHE_BYTES_MAX {
+            cache.clear();
+            *bytes = 0;
+        }
+        if let Some(old) = cache.insert((key, encoding), compressed.clone()) {
+            *bytes -= old.len();
+        }
+        *bytes += compressed.len();
+    }
+
+    /// The bytes themselves, along with the content type. An ETag is not enough:
+    /// handlers can reuse one across resources and static tags are only len+mtime.
+    fn cache_key(&self, headers: &HeaderMap, body: &[u8]) -> u64 {
+        let mut hasher = self.hasher.build_hasher();
+        headers.get(header::CONTENT_TYPE).map(|v| v.as_bytes()).hash(&mut hasher);
+        body.hash(&mut hasher);
+        hasher.finish()
+    }
+}
+
+fn add_vary(mut response: Response<Body>) -> Response<Body> {
+    let listed = response
+        .headers()
+        .get_all(header::VARY)
+        .iter()
+        .filter_map(|v| v.to_str().ok())
+        .any(|v| v.split(',').any(|name| name.trim().eq_ignore_ascii_case("accept-encoding") || name.trim() == "*"));
+    if !listed {
+        response.headers_mut().append(header::VARY, HeaderValue::from_static("accept-encoding"));
+    }
+    response
+}
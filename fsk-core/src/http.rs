@@ -1,19 +1,70 @@
 use std::ffi::{CStr, CString};
 use libc::{c_char, c_void};
 use reqwest;
-use std::sync::{Arc, Mutex};
-use std::collections::HashMap;
-use tokio::sync::oneshot;
-use axum::{routing::any, Router, body::Body, http::Request, response::Response};
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use tokio::sync::{mpsc, oneshot, Notify, Semaphore};
+use hyper::body::HttpBody;
+use axum::{routing::any, Router, body::{Body, Bytes}, http::{header::{ACCEPT_ENCODING, CONTENT_LENGTH}, HeaderName, HeaderValue, Request, StatusCode}, response::Response};
 use std::net::SocketAddr;
+use std::time::Duration;
+use crate::runtime::RUNTIME;
+use crate::shard::ShardedMap;
+use crate::router::FskRouter;
+use crate::static_files::StaticFiles;
+use crate::compress::Compressor;
+use crate::cache::{self, CacheDirective, Lookup, ResponseCache};
+use crate::admission::{self, Admission, FskLoopLoadCallback, Limits};
 
 pub struct ResponseHandle {
-    pub tx: oneshot::Sender<(u16, String)>,
+    pub tx: oneshot::Sender<Response<Body>>,
+    /// Set by fsk_http_cache; travels with the response as an extension.
+    pub cache: Option<CacheDirective>,
+    /// Where a streaming response reports written chunks (see FskHttpDrainCallback).
+    pub on_drain: FskHttpDrainCallback,
+    pub context: usize,
 }
 
+/// A streaming response body between fsk_http_respond_stream and fsk_http_end:
+/// fsk_http_write queues chunks here and returns, pump_body hands them to hyper.
+pub struct StreamingBody {
+    pub chunks: mpsc::UnboundedSender<Bytes>,
+    pub abort: Arc<Notify>,
+}
+
+/// One response header from Fsk (NUL-terminated name and value).
+#[repr(C)]
+pub struct FskHeader {
+    pub name: *const c_char,
+    pub value: *const c_char,
+}
+
+/// How long a queued response chunk waits for a client that stopped reading.
+const STREAM_WRITE_TIMEOUT: Duration = Duration::from_secs(30);
+
+/// Request body chunks handed to an isolate but not yet acknowledged. Reading
+/// from the client pauses at this many, so a slow handler bounds the memory an
+/// upload can take.
+const BODY_CREDITS_PER_REQUEST: usize = 4;
+
+/// `state` values of FskHttpBodyCallback.
+const BODY_DATA: i32 = 0;
+const BODY_END: i32 = 1;
+const BODY_ABORTED: i32 = 2;
+
+/// Request ids; 0 is never handed out.
+pub static NEXT_REQ_ID: AtomicU64 = AtomicU64::new(1);
+
 lazy_static::lazy_static! {
-    pub static ref PENDING_REQUESTS: Arc<Mutex<HashMap<u64, ResponseHandle>>> = Arc::new(Mutex::new(HashMap::new()));
-    pub static ref NEXT_REQ_ID: Arc<Mutex<u64>> = Arc::new(Mutex::new(1));
+    // Per-request tables, sharded by id: every tokio worker and interpreter
+    // thread touches them on each request, so they must not share one lock.
+    pub static ref PENDING_REQUESTS: ShardedMap<ResponseHandle> = ShardedMap::new();
+    // Chunk queues of streaming responses, fed by fsk_http_write until fsk_http_end.
+    pub static ref STREAMING_BODIES: ShardedMap<StreamingBody> = ShardedMap::new();
+    // Chunk credits of streaming request bodies, returned by fsk_http_body_ack.
+    pub static ref BODY_CREDITS: ShardedMap<Arc<Semaphore>> = ShardedMap::new();
+    // Shared so fetches reuse pooled connections instead of a client per call.
+    pub static ref HTTP_CLIENT: reqwest::Client = reqwest::Client::new();
 }
 
 #[no_mangle]
@@ -22,97 +73,574 @@ pub extern "C" fn fsk_fetch_blocking(url: *const c_char) -> *mut c_char {
         CStr::from_ptr(url).to_string_lossy().into_owned()
     };
 
-    match reqwest::blocking::get(&url) {
-        Ok(res) => {
-            match res.text() {
-                Ok(text) => {
-                    let c_str = CString::new(text).unwrap();
-                    c_str.into_raw()
+    // Called from the interpreter's I/O pool, never from a runtime thread.
+    let text = RUNTIME.block_on(async {
+        match HTTP_CLIENT.get(&url).send().await {
+            Ok(res) => match res.text().await {
+                Ok(text) => text,
+                Err(_) => "Error: Could not read response text".to_string(),
+            },
+            Err(e) => format!("Error: {}", e),
+        }
+    });
+
+    let c_str = CString::new(text).unwrap();
+    c_str.into_raw()
+}
+
+/// A request as handed to Fsk. Pointers are only valid during the callback.
+#[repr(C)]
+pub struct FskRequest {
+    pub id: u64,
+    pub method: *const c_char,
+    pub path: *const c_char,
+    /// With `streaming` the body is empty and arrives through FskHttpBodyCallback.
+    pub body: *const u8,
+    pub body_len: usize,
+    pub streaming: bool,
+    /// Matched route id, or -1 (no router, or unmatched with a fallback handler).
+    pub route: i32,
+    /// Route parameters as name/value pairs.
+    pub params: *const FskHeader,
+    pub param_count: usize,
+    /// Ids of the middleware whose prefix covers the path, in order.
+    pub middleware: *const u32,
+    pub middleware_count: usize,
+}
+
+pub type FskHttpCallback = extern "C" fn(*const FskRequest, *mut c_void);
+/// (req_id, chunk, chunk_len, state, context); each BODY_DATA chunk must be acknowledged
+/// with fsk_http_body_ack, then one BODY_END or BODY_ABORTED call closes the body.
+pub type FskHttpBodyCallback = extern "C" fn(u64, *const u8, usize, i32, *mut c_void);
+/// (req_id, bytes, written, context): a chunk queued by fsk_http_write went to the
+/// client (written) or was dropped with the rest of the body because the client
+/// left or stalled for STREAM_WRITE_TIMEOUT. Called from a runtime thread.
+pub type FskHttpDrainCallback = extern "C" fn(u64, usize, bool, *mut c_void);
+
+/// Settings FSK.listen passes to the server.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct FskServerOptions {
+    pub on_request: FskHttpCallback,
+    pub on_body: FskHttpBodyCallback,
+    pub on_drain: FskHttpDrainCallback,
+    /// Larger bodies are refused with 413 (from Content-Length when present); 0 = no limit.
+    pub max_body_size: u64,
+    /// Bodies up to this size arrive whole in the request callback; larger ones stream.
+    pub buffered_body_size: u64,
+    /// FskRouter from fsk_router_new, or null to pass every request through.
+    /// The server takes ownership of it.
+    pub router: *mut c_void,
+    /// With a router: unmatched requests still go to Fsk (route -1) instead of a 404.
+    pub fallback: bool,
+    /// StaticFiles from fsk_static_new, or null. The server takes ownership of it.
+    pub static_files: *mut c_void,
+    /// gzip/deflate for clients that accept it, on compressible bodies of at
+    /// least compress_min_size bytes, at compress_level (0-9).
+    pub compress: bool,
+    pub compress_min_size: u64,
+    pub compress_level: u32,
+    /// Byte budget of the res.cache() response cache; 0 turns it off.
+    pub cache_size: u64,
+    /// Admission control (0 = no limit): past max_in_flight unanswered requests,
+    /// or when the chosen isolate's loop (as `loop_load` reports it) has
+    /// max_queue_depth tasks waiting or its oldest has waited max_loop_lag_ms,
+    /// requests are answered 503 with Retry-After: retry_after seconds.
+    pub loop_load: Option<FskLoopLoadCallback>,
+    pub max_in_flight: u64,
+    pub max_queue_depth: u64,
+    pub max_loop_lag_ms: u64,
+    pub retry_after: u32,
+}
+
+// serve() takes the router pointer over before the options cross threads;
+// the rest is plain data and callbacks that are safe to call from any thread.
+unsafe impl Send for FskServerOptions {}
+unsafe impl Sync for FskServerOptions {}
+
+/// One interpreter that can take requests, with its count of unanswered ones.
+struct Isolate {
+    context: usize,
+    in_flight: AtomicUsize,
+}
+
+/// Picks the isolate with the fewest in-flight requests. The scan starts at a
+/// rotating index so ties spread evenly instead of piling onto isolate 0.
+fn pick_isolate(isolates: &[Isolate], next: &AtomicUsize) -> usize {
+    let start = next.fetch_add(1, Ordering::Relaxed) % isolates.len();
+    let mut best = start;
+    let mut best_depth = usize::MAX;
+    for k in 0..isolates.len() {
+        let i = (start + k) % isolates.len();
+        let depth = isolates[i].in_flight.load(Ordering::Relaxed);
+        if depth < best_depth {
+            best = i;
+            best_depth = depth;
+            if depth == 0 {
+                break;
+            }
+        }
+    }
+    best
+}
+
+/// Decrements the isolate's in-flight count when the request finishes or is dropped.
+struct InFlightGuard {
+    isolates: Arc<Vec<Isolate>>,
+    index: usize,
+}
+
+impl Drop for InFlightGuard {
+    fn drop(&mut self) {
+        self.isolates[self.index].in_flight.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+fn payload_too_large() -> Response<Body> {
+    Response::builder()
+        .status(StatusCode::PAYLOAD_TOO_LARGE)
+        .body(Body::from("Payload Too Large"))
+        .unwrap()
+}
+
+/// Feeds a large request body to its isolate chunk by chunk. Each chunk takes a
+/// credit that comes back with fsk_http_body_ack, so the client is only read as
+/// fast as the script consumes. Going over max_body_size answers 413 and aborts.
+async fn stream_body(req_id: u64, mut body: Body, first: Vec<Bytes>, mut total: u64, options: FskServerOptions, context: usize, credits: Arc<Semaphore>) {
+    let deliver = |chunk: &[u8], state: i32| {
+        (options.on_body)(req_id, chunk.as_ptr(), chunk.len(), state, context as *mut c_void);
+    };
+
+    let mut state = BODY_END;
+    for chunk in first {
+        match credits.acquire().await {
+            Ok(permit) => permit.forget(),
+            Err(_) => {
+                state = BODY_ABORTED;
+                break;
+            }
+        }
+        deliver(&chunk, BODY_DATA);
+    }
+    while state == BODY_END {
+        match body.data().await {
+            Some(Ok(chunk)) => {
+                total += chunk.len() as u64;
+                if options.max_body_size > 0 && total > options.max_body_size {
+                    complete(req_id, payload_too_large());
+                    state = BODY_ABORTED;
+                    break;
                 }
-                Err(_) => {
-                    let c_str = CString::new("Error: Could not read response text").unwrap();
-                    c_str.into_raw()
+                match credits.acquire().await {
+                    Ok(permit) => permit.forget(),
+                    Err(_) => state = BODY_ABORTED,
+                }
+                if state == BODY_END {
+                    deliver(&chunk, BODY_DATA);
                 }
             }
-        }
-        Err(e) => {
-            let c_str = CString::new(format!("Error: {}", e)).unwrap();
-            c_str.into_raw()
+            Some(Err(_)) => state = BODY_ABORTED,
+            None => break,
         }
     }
+    BODY_CREDITS.remove(req_id);
+    deliver(&[], state);
 }
 
-pub type FskHttpCallback = extern "C" fn(u64, *const c_char, *const c_char, *const c_char, *mut c_void);
+/// Returns one chunk credit of a streaming request body.
+#[no_mangle]
+pub extern "C" fn fsk_http_body_ack(req_id: u64) {
+    BODY_CREDITS.with(req_id, |credits| credits.add_permits(1));
+}
 
 #[no_mangle]
-pub extern "C" fn fsk_start_server(port: u16, callback: FskHttpCallback, context: *mut c_void) {
-    let context_addr = context as usize;
-    let rt = tokio::runtime::Runtime::new().unwrap();
-    rt.block_on(async {
-        let app = Router::new().fallback(any(move |req: Request<Body>| async move {
-            let method = req.method().to_string();
-            let path = req.uri().path().to_string();
-            
-            // Collect body
-            let body_bytes: axum::body::Bytes = hyper::body::to_bytes(req.into_body()).await.unwrap_or_default();
-            let body_str = String::from_utf8_lossy(&body_bytes).to_string();
-
-            let req_id = {
-                let mut id_gen = NEXT_REQ_ID.lock().unwrap();
-                let id = *id_gen;
-                *id_gen += 1;
-                id
-            };
-
-            let (tx, rx) = oneshot::channel();
-            {
-                let mut pending = PENDING_REQUESTS.lock().unwrap();
-                pending.insert(req_id, ResponseHandle { tx });
-            }
+pub extern "C" fn fsk_start_server(port: u16, options: *const FskServerOptions, context: *mut c_void) {
+    if options.is_null() {
+        return;
+    }
+    serve(port, unsafe { *options }, vec![context as usize]);
+}
 
-            // Signal Fsk
-            let c_method = CString::new(method).unwrap();
-            let c_path = CString::new(path).unwrap();
-            let c_body = CString::new(body_str).unwrap();
-            
-            unsafe {
-                callback(req_id, c_method.as_ptr(), c_path.as_ptr(), c_body.as_ptr(), context_addr as *mut c_void);
-            }
+/// Serves one port from several interpreters (isolates), each with its own event loop.
+#[no_mangle]
+pub extern "C" fn fsk_start_server_isolates(port: u16, options: *const FskServerOptions, contexts: *const *mut c_void, count: usize) {
+    if options.is_null() || contexts.is_null() || count == 0 {
+        return;
+    }
+    let contexts = unsafe { std::slice::from_raw_parts(contexts, count) };
+    serve(port, unsafe { *options }, contexts.iter().map(|c| *c as usize).collect());
+}
 
-            // Wait for Fsk to respond via fsk_http_respond
-            match rx.await {
-                Ok((status, body)) => {
-                    Response::builder()
-                        .status(status)
-                        .body(Body::from(body))
-                        .unwrap()
+fn serve(port: u16, options: FskServerOptions, contexts: Vec<usize>) {
+    let limits = Limits {
+        max_in_flight: options.max_in_flight as usize,
+        max_queue_depth: options.max_queue_depth,
+        max_loop_lag_us: options.max_loop_lag_ms.saturating_mul(1000),
+        retry_after_secs: options.retry_after,
+    };
+    let admission = Arc::new(Admission::new(port, limits, options.loop_load, contexts.clone()));
+    admission::register(admission.clone());
+    let isolates: Arc<Vec<Isolate>> = Arc::new(
+        contexts.into_iter().map(|context| Isolate { context, in_flight: AtomicUsize::new(0) }).collect(),
+    );
+    let next = Arc::new(AtomicUsize::new(0));
+    let router: Option<Arc<FskRouter>> = if options.router.is_null() {
+        None
+    } else {
+        Some(Arc::new(*unsafe { Box::from_raw(options.router as *mut FskRouter) }))
+    };
+    let static_files: Option<Arc<StaticFiles>> = if options.static_files.is_null() {
+        None
+    } else {
+        Some(Arc::new(*unsafe { Box::from_raw(options.static_files as *mut StaticFiles) }))
+    };
+    let compressor: Option<Arc<Compressor>> = if options.compress {
+        Some(Arc::new(Compressor::new(options.compress_min_size as usize, options.compress_level)))
+    } else {
+        None
+    };
+    let response_cache: Option<Arc<ResponseCache>> = if options.cache_size > 0 {
+        let response_cache = Arc::new(ResponseCache::new(options.cache_size as usize));
+        cache::register(response_cache.clone());
+        Some(response_cache)
+    } else {
+        None
+    };
+
+    // Bound before returning, so the script can request its own routes right after listen().
+    let addr = SocketAddr::from(([0, 0, 0, 0], port));
+    let listener = std::net::TcpListener::bind(addr).expect("Failed to bind HTTP");
+
+    // Runs on the shared runtime; returns as soon as the server task is spawned.
+    RUNTIME.spawn(async move {
+        let count = isolates.len();
+        let app = Router::new().fallback(any(move |req: Request<Body>| {
+            let isolates = isolates.clone();
+            let next = next.clone();
+            let router = router.clone();
+            let static_files = static_files.clone();
+            let compressor = compressor.clone();
+            let response_cache = response_cache.clone();
+            let admission = admission.clone();
+            async move {
+                let (parts, mut body) = req.into_parts();
+                let accept = parts.headers.get(ACCEPT_ENCODING).cloned();
+
+                // Mounted files are answered here; a miss falls through to the routes.
+                if let Some(files) = &static_files {
+                    if let Some(response) = files.serve(&parts.method, parts.uri.path(), &parts.headers).await {
+                        return encode(&compressor, accept, response).await;
+                    }
                 }
-                Err(_) => {
-                    Response::builder()
-                        .status(500)
-                        .body(Body::from("Internal Server Error (Fsk dropped request)"))
-                        .unwrap()
+
+                // res.cache() answers skip routing, middleware and the interpreter. A stale
+                // one goes out at once while this request refreshes it in the background.
+                let mut stale: Option<(Response<Body>, Arc<cache::Entry>)> = None;
+                if let Some(response_cache) = &response_cache {
+                    match response_cache.lookup(&parts) {
+                        Lookup::Fresh(response) | Lookup::Stale(response, None) => {
+                            return encode(&compressor, accept, response).await;
+                        }
+                        Lookup::Stale(response, Some(entry)) => stale = Some((response, entry)),
+                        Lookup::Miss => {}
+                    }
                 }
+                let generation = response_cache.as_ref().map_or(0, |c| c.generation());
+
+                // Route before touching the body or the interpreter; params are
+                // copied out so nothing borrows the router across awaits.
+                let mut route: i32 = -1;
+                let mut params: Vec<(CString, CString)> = Vec::new();
+                let mut middleware: Vec<u32> = Vec::new();
+                if let Some(router) = &router {
+                    let path = crate::router::decode_path(parts.uri.path());
+                    match router.find(parts.method.as_str(), &path) {
+                        Some(found) => {
+                            route = found.route as i32;
+                            params = found.params.iter()
+                                .map(|(name, value)| (CString::new(*name).unwrap_or_default(), CString::new(*value).unwrap_or_default()))
+                                .collect();
+                        }
+                        None if !options.fallback => {
+                            return Response::builder()
+                                .status(StatusCode::NOT_FOUND)
+                                .body(Body::from("Not Found"))
+                                .unwrap();
+                        }
+                        None => {}
+                    }
+                    middleware = router.middleware_for(&path);
+                }
+
+                // Shed load before reading the body or queueing on a loop that is already behind.
+                let index = pick_isolate(&isolates, &next);
+                let admitted = match admission.admit(isolates[index].context) {
+                    Ok(admitted) => admitted,
+                    Err(reason) => {
+                        if let Some((response, entry)) = stale {
+                            entry.revalidated();
+                            return encode(&compressor, accept, response).await;
+                        }
+                        return admission.reject(reason);
+                    }
+                };
+
+                let dispatch = async move {
+                    let _admitted = admitted;
+                    // Refuse what is announced too large before reading any of it.
+                    let declared = parts.headers.get(CONTENT_LENGTH)
+                        .and_then(|v| v.to_str().ok())
+                        .and_then(|v| v.parse::<u64>().ok());
+                    if options.max_body_size > 0 && declared.map_or(false, |n| n > options.max_body_size) {
+                        return payload_too_large();
+                    }
+
+                    // Small bodies are collected here; past buffered_body_size the request
+                    // is dispatched right away and the rest of the body streams.
+                    let mut buffered: Vec<Bytes> = Vec::new();
+                    let mut total: u64 = 0;
+                    let mut streaming = false;
+                    loop {
+                        match body.data().await {
+                            Some(Ok(chunk)) => {
+                                total += chunk.len() as u64;
+                                if options.max_body_size > 0 && total > options.max_body_size {
+                                    return payload_too_large();
+                                }
+                                buffered.push(chunk);
+                                if total > options.buffered_body_size {
+                                    streaming = true;
+                                    break;
+                                }
+                            }
+                            Some(Err(_)) => {
+                                return Response::builder()
+                                    .status(StatusCode::BAD_REQUEST)
+                                    .body(Body::from("Bad Request"))
+                                    .unwrap();
+                            }
+                            None => break,
+                        }
+                    }
+
+                    let req_id = NEXT_REQ_ID.fetch_add(1, Ordering::Relaxed);
+                    let (tx, rx) = oneshot::channel();
+                    PENDING_REQUESTS.insert(req_id, ResponseHandle { tx, cache: None, on_drain: options.on_drain, context: isolates[index].context });
+
+                    isolates[index].in_flight.fetch_add(1, Ordering::Relaxed);
+                    let _guard = InFlightGuard { isolates: isolates.clone(), index };
+                    let context_addr = isolates[index].context;
+
+                    // Signal Fsk. A buffered body goes out as one length-delimited slice.
+                    let c_method = CString::new(parts.method.as_str()).unwrap();
+                    let c_path = CString::new(parts.uri.path()).unwrap();
+                    let whole: Vec<u8> = if streaming { Vec::new() } else { buffered.concat() };
+                    if streaming {
+                        BODY_CREDITS.insert(req_id, Arc::new(Semaphore::new(BODY_CREDITS_PER_REQUEST)));
+                    }
+
+                    {
+                        // Raw pointers are not Send: keep them out of the awaits below.
+                        let c_params: Vec<FskHeader> = params.iter()
+                            .map(|(name, value)| FskHeader { name: name.as_ptr(), value: value.as_ptr() })
+                            .collect();
+                        let request = FskRequest {
+                            id: req_id,
+                            method: c_method.as_ptr(),
+                            path: c_path.as_ptr(),
+                            body: whole.as_ptr(),
+                            body_len: whole.len(),
+                            streaming,
+                            route,
+                            params: c_params.as_ptr(),
+                            param_count: c_params.len(),
+                            middleware: middleware.as_ptr(),
+                            middleware_count: middleware.len(),
+                        };
+                        (options.on_request)(&request, context_addr as *mut c_void);
+                    }
+
+                    if streaming {
+                        let credits = BODY_CREDITS.get_cloned(req_id);
+                        if let Some(credits) = credits {
+                            tokio::spawn(stream_body(req_id, body, buffered, total, options, context_addr, credits));
+                        }
+                    }
+
+                    // Wait for Fsk to respond via fsk_http_respond
+                    let response = match rx.await {
+                        Ok(response) => response,
+                        Err(_) => {
+                            return Response::builder()
+                                .status(500)
+                                .body(Body::from("Internal Server Error (Fsk dropped request)"))
+                                .unwrap();
+                        }
+                    };
+                    match &response_cache {
+                        Some(response_cache) => response_cache.store(&parts, generation, response).await,
+                        None => response,
+                    }
+                };
+
+                if let Some((response, entry)) = stale {
+                    tokio::spawn(async move {
+                        dispatch.await;
+                        entry.revalidated();
+                    });
+                    return encode(&compressor, accept, response).await;
+                }
+                encode(&compressor, accept, dispatch.await).await
             }
         }));
 
-        let addr = SocketAddr::from(([0, 0, 0, 0], port));
-        println!("[RUST] Fsk Server listening on http://{}", addr);
-        axum::Server::bind(&addr)
+        if count > 1 {
+            println!("[RUST] Fsk Server listening on http://{} ({} isolates)", addr, count);
+        } else {
+            println!("[RUST] Fsk Server listening on http://{}", addr);
+        }
+        axum::Server::from_tcp(listener)
+            .unwrap()
             .serve(app.into_make_service())
             .await
             .unwrap();
     });
 }
 
+async fn encode(compressor: &Option<Arc<Compressor>>, accept: Option<HeaderValue>, response: Response<Body>) -> Response<Body> {
+    match compressor {
+        Some(compressor) => compressor.apply(accept.as_ref(), response).await,
+        None => response,
+    }
+}
+
+fn build_response(status: u16, headers: *const FskHeader, header_count: usize, body: Body) -> Response<Body> {
+    let mut response = Response::new(body);
+    *response.status_mut() = StatusCode::from_u16(status).unwrap_or(StatusCode::INTERNAL_SERVER_ERROR);
+    if !headers.is_null() {
+        let headers = unsafe { std::slice::from_raw_parts(headers, header_count) };
+        for header in headers {
+            let name = unsafe { CStr::from_ptr(header.name) }.to_bytes();
+            let value = unsafe { CStr::from_ptr(header.value) }.to_bytes();
+            // An invalid header is dropped instead of failing the whole response.
+            if let (Ok(name), Ok(value)) = (HeaderName::from_bytes(name), HeaderValue::from_bytes(value)) {
+                response.headers_mut().append(name, value);
+            }
+        }
+    }
+    response
+}
+
+/// Hands the response to the waiting handler; false if the request is unknown or the client left.
+fn complete(req_id: u64, response: Response<Body>) -> bool {
+    let handle = PENDING_REQUESTS.remove(req_id);
+    match handle {
+        Some(handle) => {
+            let mut response = response;
+            if let Some(directive) = handle.cache {
+                response.extensions_mut().insert(directive);
+            }
+            handle.tx.send(response).is_ok()
+        }
+        None => false,
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn fsk_http_respond(req_id: u64, status: u16, body: *const c_char) {
-    let body_str = unsafe {
-        CStr::from_ptr(body).to_string_lossy().into_owned()
+    let body = unsafe { CStr::from_ptr(body).to_bytes().to_vec() };
+    complete(req_id, build_response(status, std::ptr::null(), 0, Body::from(body)));
+}
+
+/// Answers with headers and a length-delimited body, so binary payloads survive.
+#[no_mangle]
+pub extern "C" fn fsk_http_respond_full(req_id: u64, status: u16, headers: *const FskHeader, header_count: usize, body: *const u8, body_len: usize) {
+    let body = if body.is_null() || body_len == 0 {
+        Vec::new()
+    } else {
+        unsafe { std::slice::from_raw_parts(body, body_len).to_vec() }
     };
+    complete(req_id, build_response(status, headers, header_count, Body::from(body)));
+}
+
+/// Sends the status and headers now; the body follows chunk by chunk through
+/// fsk_http_write and is terminated by fsk_http_end (chunked encoding).
+#[no_mangle]
+pub extern "C" fn fsk_http_respond_stream(req_id: u64, status: u16, headers: *const FskHeader, header_count: usize) -> bool {
+    let hook = PENDING_REQUESTS.with(req_id, |handle| (handle.on_drain, handle.context));
+    let (on_drain, context) = match hook {
+        Some(hook) => hook,
+        None => return false,
+    };
+    let (sender, body) = Body::channel();
+    if !complete(req_id, build_response(status, headers, header_count, body)) {
+        return false;
+    }
+    let (chunks, queue) = mpsc::unbounded_channel();
+    let abort = Arc::new(Notify::new());
+    STREAMING_BODIES.insert(req_id, StreamingBody { chunks, abort: abort.clone() });
+    RUNTIME.spawn(pump_body(req_id, sender, queue, abort, on_drain, context));
+    true
+}
 
-    let mut pending = PENDING_REQUESTS.lock().unwrap();
-    if let Some(handle) = pending.remove(&req_id) {
-        let _ = handle.tx.send((status, body_str));
+/// Moves queued chunks into the response body. hyper holds one chunk per body,
+/// so each send waits for the client to take the previous one; every chunk is
+/// reported back through on_drain, which is how the script sees backpressure.
+/// The body ends cleanly once fsk_http_end closed the queue and it is empty.
+async fn pump_body(req_id: u64, mut sender: hyper::body::Sender, mut queue: mpsc::UnboundedReceiver<Bytes>,
+                   abort: Arc<Notify>, on_drain: FskHttpDrainCallback, context: usize) {
+    let drain = |bytes: usize, written: bool| on_drain(req_id, bytes, written, context as *mut c_void);
+    loop {
+        let chunk = tokio::select! {
+            _ = abort.notified() => break,
+            chunk = queue.recv() => match chunk {
+                Some(chunk) => chunk,
+                None => return,
+            },
+        };
+        let len = chunk.len();
+        let written = tokio::select! {
+            _ = abort.notified() => false,
+            sent = tokio::time::timeout(STREAM_WRITE_TIMEOUT, sender.send_data(chunk)) => matches!(sent, Ok(Ok(()))),
+        };
+        drain(len, written);
+        if !written {
+            break;
+        }
+    }
+    // Aborted, or the client is gone: a truncated transfer, not a complete body.
+    STREAMING_BODIES.remove(req_id);
+    sender.abort();
+    queue.close();
+    while let Some(chunk) = queue.recv().await {
+        drain(chunk.len(), false);
     }
 }
+
+/// Queues one chunk of a streaming response and returns at once; the chunk's
+/// fate comes back through on_drain. False if the stream is over (ended,
+/// aborted, or the client left).
+#[no_mangle]
+pub extern "C" fn fsk_http_write(req_id: u64, data: *const u8, len: usize) -> bool {
+    if data.is_null() || len == 0 {
+        return STREAMING_BODIES.with(req_id, |_| ()).is_some();
+    }
+    let chunk = Bytes::copy_from_slice(unsafe { std::slice::from_raw_parts(data, len) });
+    STREAMING_BODIES.with(req_id, |body| body.chunks.send(chunk).is_ok()).unwrap_or(false)
+}
+
+/// Drops a streaming response: the client sees the transfer cut short instead of
+/// a complete body. Queued chunks are reported to on_drain as not written.
+#[no_mangle]
+pub extern "C" fn fsk_http_abort(req_id: u64) {
+    if let Some(body) = STREAMING_BODIES.remove(req_id) {
+        body.abort.notify_one();
+    }
+}
+
+/// Ends a streaming response: closing the queue lets pump_body send what is
+/// left, then end the body.
+#[no_mangle]
+pub extern "C" fn fsk_http_end(req_id: u64) {
+    STREAMING_BODIES.remove(req_id);
+}
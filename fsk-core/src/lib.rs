@@ -6,6 +6,14 @@ pub mod system;
 pub mod sql;
 pub mod vm;
 pub mod ffi;
+pub mod runtime;
+pub mod router;
+pub mod static_files;
+pub mod compress;
+pub mod shard;
+pub mod bench;
+pub mod cache;
+pub mod admission;
 
 pub use http::*;
 pub use utils::*;
@@ -14,3 +22,7 @@ pub use crypto::*;
 pub use system::*;
 pub use sql::*;
 pub use vm::*;
+pub use router::*;
+pub use static_files::*;
+pub use compress::*;
+pub use bench::*;
@@ -1,25 +1,380 @@
-use tokio::net::{TcpListener, TcpStream};
-use tokio_tungstenite::{accept_async, tungstenite::protocol::Message};
-use futures_util::{StreamExt, SinkExt};
+use tokio::io::{AsyncRead, AsyncWrite, AsyncWriteExt, ReadBuf};
+use tokio::net::{tcp::OwnedWriteHalf, tcp::OwnedReadHalf, TcpListener};
+use tokio::sync::mpsc::{unbounded_channel, UnboundedReceiver, UnboundedSender};
+use tokio::sync::Notify;
+use tokio_tungstenite::accept_async;
+use futures_util::{FutureExt, StreamExt};
+use axum::body::Bytes;
+use std::collections::{HashMap, VecDeque};
 use std::ffi::{CString, CStr};
+use std::io;
+use std::pin::Pin;
+use std::sync::{Arc, Condvar, Mutex, RwLock};
+use std::task::{Context, Poll};
+use std::time::{Duration, Instant};
 use libc::{c_char, c_void};
-use std::sync::{Arc, Mutex};
-use std::collections::HashMap;
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicUsize, Ordering};
+use crate::runtime::RUNTIME;
+use crate::shard::ShardedMap;
 
-pub type FskWsCallback = extern "C" fn(u32, *const c_char, *mut c_void);
+/// One inbound message; `data` is only valid during the callback.
+#[repr(C)]
+pub struct FskWsMessage {
+    pub data: *const u8,
+    pub len: usize,
+    pub binary: bool,
+}
+
+/// (ws_id, messages, count, context): messages from one socket that arrived
+/// together, in order.
+pub type FskWsCallback = extern "C" fn(u32, *const FskWsMessage, usize, *mut c_void);
+
+/// What a full send queue does with one more frame.
+pub const WS_OVERFLOW_DROP_OLDEST: u32 = 0;
+pub const WS_OVERFLOW_DISCONNECT: u32 = 1;
+pub const WS_OVERFLOW_BLOCK: u32 = 2;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct FskWsOptions {
+    /// Frames a socket may have waiting to be written; 0 for no limit.
+    pub max_queue: u32,
+    /// WS_OVERFLOW_*.
+    pub overflow: u32,
+    /// With WS_OVERFLOW_BLOCK, how long a sender waits for room before the
+    /// socket is disconnected.
+    pub block_timeout_ms: u64,
+    /// Inbound messages handed over per callback at most.
+    pub max_batch: u32,
+}
+
+impl Default for FskWsOptions {
+    fn default() -> Self {
+        FskWsOptions { max_queue: 1024, overflow: WS_OVERFLOW_DROP_OLDEST, block_timeout_ms: 5000, max_batch: 64 }
+    }
+}
+
+/// Writes of queued frames are merged up to this size.
+const MAX_WRITE: usize = 64 * 1024;
+
+/// WebSocket ids; 0 is never handed out.
+pub static NEXT_WS_ID: AtomicU32 = AtomicU32::new(1);
+
+enum Offer {
+    Queued,
+    Closed,
+    /// Full under WS_OVERFLOW_BLOCK: the frame comes back for a blocking push.
+    Full(Bytes),
+}
+
+#[derive(Default)]
+struct QueueState {
+    frames: VecDeque<Bytes>,
+    closed: bool,
+}
+
+/// Frames waiting for one socket's writer, bounded by FskWsOptions. Senders
+/// are script threads; the writer is a tokio task.
+pub struct SendQueue {
+    limit: usize,
+    overflow: u32,
+    block_timeout: Duration,
+    state: Mutex<QueueState>,
+    // Wakes senders blocked on a full queue.
+    space: Condvar,
+    // Wakes the writer.
+    ready: Notify,
+    // Wakes the reader when the queue is closed under it.
+    shutdown: Notify,
+    // Closed for falling behind: the writer says so with a close frame.
+    kicked: AtomicBool,
+    depth: AtomicUsize,
+    peak: AtomicUsize,
+    sent: AtomicU64,
+    dropped: AtomicU64,
+    received: AtomicU64,
+    batches: AtomicU64,
+}
+
+impl SendQueue {
+    fn new(options: &FskWsOptions) -> SendQueue {
+        SendQueue {
+            limit: options.max_queue as usize,
+            overflow: options.overflow,
+            block_timeout: Duration::from_millis(options.block_timeout_ms),
+            state: Mutex::new(QueueState::default()),
+            space: Condvar::new(),
+            ready: Notify::new(),
+            shutdown: Notify::new(),
+            kicked: AtomicBool::new(false),
+            depth: AtomicUsize::new(0),
+            peak: AtomicUsize::new(0),
+            sent: AtomicU64::new(0),
+            dropped: AtomicU64::new(0),
+            received: AtomicU64::new(0),
+            batches: AtomicU64::new(0),
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, QueueState> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn enqueue(&self, state: &mut QueueState, frame: Bytes) {
+        state.frames.push_back(frame);
+        self.depth.store(state.frames.len(), Ordering::Relaxed);
+        self.peak.fetch_max(state.frames.len(), Ordering::Relaxed);
+        self.ready.notify_one();
+    }
+
+    /// Drops what is queued and ends the connection.
+    fn kick(&self, state: &mut QueueState) {
+        self.dropped.fetch_add(state.frames.len() as u64 + 1, Ordering::Relaxed);
+        state.frames.clear();
+        self.depth.store(0, Ordering::Relaxed);
+        self.kicked.store(true, Ordering::Release);
+        self.close_locked(state);
+    }
+
+    fn close_locked(&self, state: &mut QueueState) {
+        state.closed = true;
+        self.ready.notify_one();
+        self.shutdown.notify_one();
+        self.space.notify_all();
+    }
+
+    fn close(&self) {
+        let mut state = self.lock();
+        self.close_locked(&mut state);
+    }
+
+    /// Queues `frame` unless the socket is closed or the queue is full and
+    /// the policy is to block.
+    fn offer(&self, frame: Bytes) -> Offer {
+        let mut state = self.lock();
+        if state.closed {
+            return Offer::Closed;
+        }
+        if self.limit > 0 && state.frames.len() >= self.limit {
+            match self.overflow {
+                WS_OVERFLOW_DISCONNECT => {
+                    self.kick(&mut state);
+                    return Offer::Closed;
+                }
+                WS_OVERFLOW_BLOCK => return Offer::Full(frame),
+                _ => {
+                    state.frames.pop_front();
+                    self.dropped.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+        }
+        self.enqueue(&mut state, frame);
+        Offer::Queued
+    }
+
+    /// Waits until `deadline` for room, then gives up on the socket.
+    fn push_blocking(&self, frame: Bytes, deadline: Instant) -> bool {
+        let mut state = self.lock();
+        loop {
+            if state.closed {
+                return false;
+            }
+            if state.frames.len() < self.limit {
+                self.enqueue(&mut state, frame);
+                return true;
+            }
+            let now = Instant::now();
+            if now >= deadline {
+                self.kick(&mut state);
+                return false;
+            }
+            state = self.space.wait_timeout(state, deadline - now).unwrap_or_else(|e| e.into_inner()).0;
+        }
+    }
+
+    /// False if the frame was not queued (socket closed or disconnected).
+    pub fn push(&self, frame: Bytes) -> bool {
+        match self.offer(frame) {
+            Offer::Queued => true,
+            Offer::Closed => false,
+            Offer::Full(frame) => self.push_blocking(frame, Instant::now() + self.block_timeout),
+        }
+    }
+
+    /// The next bytes to write: one frame, or several merged up to
+    /// MAX_WRITE. None once the queue is closed.
+    async fn next_chunk(&self) -> Option<Bytes> {
+        loop {
+            {
+                let mut state = self.lock();
+                if let Some(first) = state.frames.pop_front() {
+                    let mut chunk = None;
+                    let mut count = 1;
+                    if first.len() < MAX_WRITE && state.frames.front().map_or(false, |f| first.len() + f.len() <= MAX_WRITE) {
+                        let mut merged = first.to_vec();
+                        while let Some(f) = state.frames.front() {
+                            if merged.len() + f.len() > MAX_WRITE {
+                                break;
+                            }
+                            merged.extend_from_slice(f);
+                            state.frames.pop_front();
+                            count += 1;
+                        }
+                        chunk = Some(Bytes::from(merged));
+                    }
+                    self.depth.store(state.frames.len(), Ordering::Relaxed);
+                    self.sent.fetch_add(count, Ordering::Relaxed);
+                    self.space.notify_all();
+                    return Some(chunk.unwrap_or(first));
+                }
+                if state.closed {
+                    return None;
+                }
+            }
+            self.ready.notified().await;
+        }
+    }
+
+    fn stats(&self, ws_id: u32) -> serde_json::Value {
+        let overflow = match self.overflow {
+            WS_OVERFLOW_DISCONNECT => "disconnect",
+            WS_OVERFLOW_BLOCK => "block",
+            _ => "dropOldest",
+        };
+        serde_json::json!({
+            "id": ws_id,
+            "queued": self.depth.load(Ordering::Relaxed),
+            "peakQueued": self.peak.load(Ordering::Relaxed),
+            "maxQueue": if self.limit == 0 { serde_json::Value::Null } else { serde_json::json!(self.limit) },
+            "onFull": overflow,
+            "sent": self.sent.load(Ordering::Relaxed),
+            "dropped": self.dropped.load(Ordering::Relaxed),
+            "received": self.received.load(Ordering::Relaxed),
+            "batches": self.batches.load(Ordering::Relaxed),
+        })
+    }
+}
+
+/// An open socket: its send queue and the rooms it joined.
+pub struct WsSocket {
+    queue: Arc<SendQueue>,
+    rooms: Vec<String>,
+}
+
+/// Members of a room, with their queues so a publish needs no lookup per
+/// member.
+#[derive(Default)]
+struct Room {
+    members: RwLock<HashMap<u32, Arc<SendQueue>>>,
+}
 
 lazy_static::lazy_static! {
-    pub static ref WS_SOCKETS: Arc<Mutex<HashMap<u32, tokio::sync::mpsc::UnboundedSender<Message>>>> = Arc::new(Mutex::new(HashMap::new()));
-    pub static ref NEXT_WS_ID: Arc<Mutex<u32>> = Arc::new(Mutex::new(1));
+    // Every open socket, sharded by id (see ShardedMap).
+    pub static ref WS_SOCKETS: ShardedMap<WsSocket> = ShardedMap::new();
+    // Room name -> members. Joins and leaves hold this lock so an emptied room
+    // is never dropped under a concurrent join; publishes only clone the Arc.
+    static ref ROOMS: Mutex<HashMap<String, Arc<Room>>> = Mutex::new(HashMap::new());
+}
+
+/// A whole unmasked server frame (FIN set, no extensions), encoded once
+/// however many sockets it goes to.
+pub fn encode_ws_frame(payload: &[u8], binary: bool) -> Bytes {
+    let opcode = if binary { 0x2 } else { 0x1 };
+    let mut frame = Vec::with_capacity(payload.len() + 10);
+    frame.push(0x80 | opcode);
+    match payload.len() {
+        n if n < 126 => frame.push(n as u8),
+        n if n <= 0xFFFF => {
+            frame.push(126);
+            frame.extend_from_slice(&(n as u16).to_be_bytes());
+        }
+        n => {
+            frame.push(127);
+            frame.extend_from_slice(&(n as u64).to_be_bytes());
+        }
+    }
+    frame.extend_from_slice(payload);
+    Bytes::from(frame)
+}
+
+fn text_frame(payload: &[u8]) -> Bytes {
+    // Text frames must be UTF-8 or the client drops the connection.
+    match std::str::from_utf8(payload) {
+        Ok(_) => encode_ws_frame(payload, false),
+        Err(_) => encode_ws_frame(String::from_utf8_lossy(payload).as_bytes(), false),
+    }
+}
+
+/// The connection as tungstenite sees it: reads come from the socket, and its
+/// writes (handshake reply, pongs, close) go to the socket's writer, which
+/// sends them between whole frames. Data frames never pass through
+/// tungstenite, so one encoded frame can be queued on any number of sockets.
+struct Inbound {
+    read: OwnedReadHalf,
+    control: UnboundedSender<Bytes>,
+}
+
+impl AsyncRead for Inbound {
+    fn poll_read(mut self: Pin<&mut Self>, cx: &mut Context<'_>, buf: &mut ReadBuf<'_>) -> Poll<io::Result<()>> {
+        Pin::new(&mut self.read).poll_read(cx, buf)
+    }
+}
+
+impl AsyncWrite for Inbound {
+    fn poll_write(self: Pin<&mut Self>, _cx: &mut Context<'_>, buf: &[u8]) -> Poll<io::Result<usize>> {
+        // tungstenite writes out its whole buffer of complete frames at once.
+        match self.control.send(Bytes::copy_from_slice(buf)) {
+            Ok(()) => Poll::Ready(Ok(buf.len())),
+            Err(_) => Poll::Ready(Err(io::ErrorKind::BrokenPipe.into())),
+        }
+    }
+
+    fn poll_flush(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        Poll::Ready(Ok(()))
+    }
+
+    fn poll_shutdown(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        Poll::Ready(Ok(()))
+    }
+}
+
+/// Writes control bytes first, then queued frames, until the reader is gone
+/// or the queue is closed.
+async fn write_loop(mut write: OwnedWriteHalf, mut control: UnboundedReceiver<Bytes>, queue: Arc<SendQueue>) {
+    loop {
+        let chunk = tokio::select! {
+            biased;
+            chunk = control.recv() => match chunk {
+                Some(chunk) => chunk,
+                None => break,
+            },
+            chunk = queue.next_chunk() => match chunk {
+                Some(chunk) => chunk,
+                None => break,
+            },
+        };
+        if write.write_all(&chunk).await.is_err() {
+            break;
+        }
+    }
+    if queue.kicked.load(Ordering::Acquire) {
+        // Close frame, status 1008 (policy violation): the client fell behind.
+        let _ = write.write_all(&[0x88, 0x02, 0x03, 0xF0]).await;
+    }
+    let _ = write.shutdown().await;
 }
 
 #[no_mangle]
-pub extern "C" fn fsk_ws_listen(port: u16, callback: FskWsCallback, context: *mut c_void) {
+pub extern "C" fn fsk_ws_listen(port: u16, options: *const FskWsOptions, callback: FskWsCallback, context: *mut c_void) {
+    let options = if options.is_null() { FskWsOptions::default() } else { unsafe { *options } };
     let context_addr = context as usize;
-    let rt = tokio::runtime::Runtime::new().unwrap();
-    rt.block_on(async {
-        let addr = format!("0.0.0.0:{}", port);
-        let listener = TcpListener::bind(&addr).await.expect("Failed to bind WS");
+    // Bound before returning, so the script can connect as soon as WS.listen does.
+    let addr = format!("0.0.0.0:{}", port);
+    let listener = std::net::TcpListener::bind(&addr).expect("Failed to bind WS");
+    listener.set_nonblocking(true).expect("Failed to bind WS");
+    // Runs on the shared runtime; returns as soon as the listener task is spawned.
+    RUNTIME.spawn(async move {
+        let listener = TcpListener::from_std(listener).expect("Failed to bind WS");
         println!("[RUST] WebSocket Server listening on ws://{}", addr);
 
         while let Ok((stream, _)) = listener.accept().await {
@@ -27,57 +382,204 @@ pub extern "C" fn fsk_ws_listen(port: u16, callback: FskWsCallback, context: *mu
             let context_addr = context_addr;
 
             tokio::spawn(async move {
-                if let Ok(ws_stream) = accept_async(stream).await {
-                    let ws_id = {
-                        let mut id_gen = NEXT_WS_ID.lock().unwrap();
-                        let id = *id_gen;
-                        *id_gen += 1;
-                        id
-                    };
-
-                    let (mut write, mut read) = ws_stream.split();
-                    let (tx, mut rx) = tokio::sync::mpsc::unbounded_channel::<Message>();
-                    
-                    {
-                        let mut sockets = WS_SOCKETS.lock().unwrap();
-                        sockets.insert(ws_id, tx);
-                    }
+                let _ = stream.set_nodelay(true);
+                let (read, write) = stream.into_split();
+                let (control_tx, control_rx) = unbounded_channel::<Bytes>();
+                let queue = Arc::new(SendQueue::new(&options));
+                tokio::spawn(write_loop(write, control_rx, queue.clone()));
 
-                    tokio::spawn(async move {
-                        while let Some(msg) = rx.recv().await {
-                            if write.send(msg).await.is_err() { break; }
-                        }
-                    });
-
-                    while let Some(msg) = read.next().await {
-                        if let Ok(msg) = msg {
-                            if msg.is_text() || msg.is_binary() {
-                                let txt = msg.to_text().unwrap_or_default();
-                                let c_txt = CString::new(txt).unwrap();
-                                unsafe {
-                                    callback(ws_id, c_txt.as_ptr(), context_addr as *mut c_void);
+                if let Ok(mut ws_stream) = accept_async(Inbound { read, control: control_tx }).await {
+                    let ws_id = NEXT_WS_ID.fetch_add(1, Ordering::Relaxed);
+                    WS_SOCKETS.insert(ws_id as u64, WsSocket { queue: queue.clone(), rooms: Vec::new() });
+                    let max_batch = options.max_batch.max(1) as usize;
+
+                    let mut ended = false;
+                    while !ended {
+                        let first = tokio::select! {
+                            msg = ws_stream.next() => msg,
+                            _ = queue.shutdown.notified() => break,
+                        };
+                        let mut batch: Vec<(Vec<u8>, bool)> = Vec::new();
+                        let mut next = first;
+                        loop {
+                            match next {
+                                Some(Ok(msg)) => {
+                                    if msg.is_text() || msg.is_binary() {
+                                        let binary = msg.is_binary();
+                                        batch.push((msg.into_data(), binary));
+                                    }
                                 }
+                                _ => {
+                                    ended = true;
+                                    break;
+                                }
+                            }
+                            if batch.len() >= max_batch {
+                                break;
                             }
-                        } else {
-                            break;
+                            // Whatever else has already arrived goes in the same callback.
+                            next = match ws_stream.next().now_or_never() {
+                                Some(msg) => msg,
+                                None => break,
+                            };
                         }
+                        if batch.is_empty() {
+                            continue;
+                        }
+                        let messages: Vec<FskWsMessage> = batch
+                            .iter()
+                            .map(|(data, binary)| FskWsMessage { data: data.as_ptr(), len: data.len(), binary: *binary })
+                            .collect();
+                        queue.received.fetch_add(messages.len() as u64, Ordering::Relaxed);
+                        queue.batches.fetch_add(1, Ordering::Relaxed);
+                        callback(ws_id, messages.as_ptr(), messages.len(), context_addr as *mut c_void);
                     }
 
-                    {
-                        let mut sockets = WS_SOCKETS.lock().unwrap();
-                        sockets.remove(&ws_id);
+                    if let Some(socket) = WS_SOCKETS.remove(ws_id as u64) {
+                        for room in &socket.rooms {
+                            leave_room(ws_id, room);
+                        }
                     }
                 }
+                queue.close();
             });
         }
     });
 }
 
+fn queue(ws_id: u32, frame: Bytes) -> bool {
+    // The queue is cloned out so a blocking push doesn't hold the shard.
+    match WS_SOCKETS.with(ws_id as u64, |socket| socket.queue.clone()) {
+        Some(queue) => queue.push(frame),
+        None => false,
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn fsk_ws_send(ws_id: u32, message: *const c_char) {
-    let msg_str = unsafe { CStr::from_ptr(message).to_string_lossy().into_owned() };
-    let sockets = WS_SOCKETS.lock().unwrap();
-    if let Some(tx) = sockets.get(&ws_id) {
-        let _ = tx.send(Message::Text(msg_str));
+    let message = unsafe { CStr::from_ptr(message) };
+    queue(ws_id, text_frame(message.to_bytes()));
+}
+
+/// Sends `len` bytes as one text or binary frame. False if the socket is gone.
+#[no_mangle]
+pub extern "C" fn fsk_ws_send_bytes(ws_id: u32, data: *const u8, len: usize, binary: bool) -> bool {
+    let payload = if len == 0 { &[][..] } else { unsafe { std::slice::from_raw_parts(data, len) } };
+    queue(ws_id, if binary { encode_ws_frame(payload, true) } else { text_frame(payload) })
+}
+
+fn room_name(room: *const c_char) -> String {
+    unsafe { CStr::from_ptr(room).to_string_lossy().into_owned() }
+}
+
+fn leave_room(ws_id: u32, room: &str) -> bool {
+    let mut rooms = ROOMS.lock().unwrap_or_else(|e| e.into_inner());
+    let (left, empty) = match rooms.get(room) {
+        Some(members) => {
+            let mut members = members.members.write().unwrap_or_else(|e| e.into_inner());
+            (members.remove(&ws_id).is_some(), members.is_empty())
+        }
+        None => return false,
+    };
+    if empty {
+        rooms.remove(room);
+    }
+    left
+}
+
+/// Adds the socket to `room`, created on first join. False if the socket is gone.
+#[no_mangle]
+pub extern "C" fn fsk_ws_join(ws_id: u32, room: *const c_char) -> bool {
+    let room = room_name(room);
+    let queue = WS_SOCKETS.with(ws_id as u64, |socket| {
+        if !socket.rooms.contains(&room) {
+            socket.rooms.push(room.clone());
+        }
+        socket.queue.clone()
+    });
+    let queue = match queue {
+        Some(queue) => queue,
+        None => return false,
+    };
+    let mut rooms = ROOMS.lock().unwrap_or_else(|e| e.into_inner());
+    let members = rooms.entry(room).or_default();
+    members.members.write().unwrap_or_else(|e| e.into_inner()).insert(ws_id, queue);
+    true
+}
+
+/// Removes the socket from `room`; rooms go away with their last member.
+#[no_mangle]
+pub extern "C" fn fsk_ws_leave(ws_id: u32, room: *const c_char) -> bool {
+    let room = room_name(room);
+    WS_SOCKETS.with(ws_id as u64, |socket| socket.rooms.retain(|r| *r != room));
+    leave_room(ws_id, &room)
+}
+
+/// Queues one frame on every member of `room` but `except` (0 for none). The
+/// frame is encoded once; each member gets a reference to the same bytes.
+/// Returns how many sockets it was queued on; full queues follow the
+/// server's overflow policy, and disconnected members leave the room.
+#[no_mangle]
+pub extern "C" fn fsk_ws_publish(room: *const c_char, data: *const u8, len: usize, binary: bool, except: u32) -> u64 {
+    let room = room_name(room);
+    let members = match ROOMS.lock().unwrap_or_else(|e| e.into_inner()).get(&room) {
+        Some(members) => members.clone(),
+        None => return 0,
+    };
+    let payload = if len == 0 { &[][..] } else { unsafe { std::slice::from_raw_parts(data, len) } };
+    let frame = if binary { encode_ws_frame(payload, true) } else { text_frame(payload) };
+
+    let mut sent = 0;
+    let mut closed = Vec::new();
+    let mut full = Vec::new();
+    {
+        let members = members.members.read().unwrap_or_else(|e| e.into_inner());
+        for (&ws_id, queue) in members.iter() {
+            if ws_id == except {
+                continue;
+            }
+            match queue.offer(frame.clone()) {
+                Offer::Queued => sent += 1,
+                Offer::Closed => closed.push(ws_id),
+                Offer::Full(frame) => full.push((ws_id, queue.clone(), frame)),
+            }
+        }
+    }
+    // Blocking senders wait with the room unlocked, all against one deadline:
+    // a publish stalls the caller for one block_timeout at most, not one per
+    // slow member. Members still full past it are disconnected.
+    let mut deadline = None;
+    for (ws_id, queue, frame) in full {
+        let deadline = *deadline.get_or_insert_with(|| Instant::now() + queue.block_timeout);
+        if queue.push_blocking(frame, deadline) {
+            sent += 1;
+        } else {
+            closed.push(ws_id);
+        }
+    }
+    // A socket that joined while closing can miss the cleanup; drop it here.
+    for ws_id in closed {
+        leave_room(ws_id, &room);
+    }
+    sent
+}
+
+/// Number of sockets in `room`.
+#[no_mangle]
+pub extern "C" fn fsk_ws_room_size(room: *const c_char) -> u64 {
+    let room = room_name(room);
+    match ROOMS.lock().unwrap_or_else(|e| e.into_inner()).get(&room) {
+        Some(members) => members.members.read().unwrap_or_else(|e| e.into_inner()).len() as u64,
+        None => 0,
+    }
+}
+
+/// Queue and traffic counters of one socket as JSON, or null if it is closed.
+/// Free the string with fsk_free_string.
+#[no_mangle]
+pub extern "C" fn fsk_ws_stats(ws_id: u32) -> *mut c_char {
+    match WS_SOCKETS.with(ws_id as u64, |socket| socket.queue.stats(ws_id)) {
+        Some(stats) => CString::new(stats.to_string()).unwrap().into_raw(),
+        None => std::ptr::null_mut(),
     }
 }
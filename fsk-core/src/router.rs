@@ -0,0 +1,267 @@
+use std::borrow::Cow;
+use std::collections::HashMap;
+use std::ffi::CStr;
+use libc::{c_char, c_void};
+
+/// One piece of a route pattern. `:name` and `*name` must span a whole path
+/// segment, and `*name` must come last.
+enum Segment {
+    Static(String),
+    Param(String),
+    Wildcard(String),
+}
+
+fn parse_pattern(pattern: &str) -> Result<Vec<Segment>, String> {
+    if !pattern.starts_with('/') {
+        return Err(format!("route must start with '/': {}", pattern));
+    }
+    let mut segments = Vec::new();
+    let mut text = String::new();
+    let parts: Vec<&str> = pattern.split('/').collect();
+    for (i, part) in parts.iter().enumerate() {
+        if i > 0 {
+            text.push('/');
+        }
+        let dynamic = part.starts_with(':') || part.starts_with('*');
+        if !dynamic {
+            text.push_str(part);
+            continue;
+        }
+        let name = &part[1..];
+        if name.is_empty() {
+            return Err(format!("unnamed parameter in route {}", pattern));
+        }
+        if !text.is_empty() {
+            segments.push(Segment::Static(std::mem::take(&mut text)));
+        }
+        if part.starts_with(':') {
+            segments.push(Segment::Param(name.to_string()));
+        } else {
+            if i + 1 != parts.len() {
+                return Err(format!("'*{}' must be the last segment of {}", name, pattern));
+            }
+            segments.push(Segment::Wildcard(name.to_string()));
+        }
+    }
+    if !text.is_empty() {
+        segments.push(Segment::Static(text));
+    }
+    Ok(segments)
+}
+
+/// Byte length of the longest common prefix, compared char by char so it always
+/// ends on a boundary: "/café" and "/cafè" share "/caf", not part of the "é".
+fn common_prefix(a: &str, b: &str) -> usize {
+    a.char_indices()
+        .zip(b.chars())
+        .take_while(|((_, x), y)| x == y)
+        .last()
+        .map_or(0, |((i, x), _)| i + x.len_utf8())
+}
+
+fn first_char(text: &str) -> Option<char> {
+    text.chars().next()
+}
+
+/// Radix tree node. Static edges are compressed strings whose first chars are
+/// distinct (so an edge and a new text share at least that char, and a split
+/// never leaves an empty label); a `:param` child and a `*wildcard` route hang off the same node.
+/// Lookup prefers static edges, then the parameter, then the wildcard.
+#[derive(Default)]
+struct Node {
+    children: Vec<(String, Node)>,
+    param: Option<(String, Box<Node>)>,
+    wildcard: Option<(String, u32)>,
+    route: Option<u32>,
+}
+
+impl Node {
+    fn insert_static(&mut self, text: &str) -> &mut Node {
+        let first = match first_char(text) {
+            Some(first) => first,
+            None => return self,
+        };
+        let index = match self.children.iter().position(|(label, _)| first_char(label) == Some(first)) {
+            Some(index) => index,
+            None => {
+                self.children.push((text.to_string(), Node::default()));
+                return &mut self.children.last_mut().unwrap().1;
+            }
+        };
+        let common = common_prefix(&self.children[index].0, text);
+        if common < self.children[index].0.len() {
+            // Split the edge at the shared prefix.
+            let (label, child) = std::mem::take(&mut self.children[index]);
+            let mut middle = Node::default();
+            middle.children.push((label[common..].to_string(), child));
+            self.children[index] = (label[..common].to_string(), middle);
+        }
+        self.children[index].1.insert_static(&text[common..])
+    }
+
+    fn insert(&mut self, segments: &[Segment], route: u32) -> Result<(), String> {
+        match segments.split_first() {
+            None => {
+                if self.route.is_some() {
+                    return Err("route already defined".to_string());
+                }
+                self.route = Some(route);
+                Ok(())
+            }
+            Some((Segment::Static(text), rest)) => self.insert_static(text).insert(rest, route),
+            Some((Segment::Param(name), rest)) => {
+                let (existing, child) = self.param.get_or_insert_with(|| (name.clone(), Box::new(Node::default())));
+                if existing != name {
+                    return Err(format!("':{}' conflicts with ':{}' at the same position", name, existing));
+                }
+                child.insert(rest, route)
+            }
+            Some((Segment::Wildcard(name), _)) => {
+                if self.wildcard.is_some() {
+                    return Err("wildcard already defined".to_string());
+                }
+                self.wildcard = Some((name.clone(), route));
+                Ok(())
+            }
+        }
+    }
+
+    fn find<'a, 'p>(&'a self, path: &'p str, params: &mut Vec<(&'a str, &'p str)>) -> Option<u32> {
+        let head = first_char(path);
+        if head.is_none() {
+            if let Some(route) = self.route {
+                return Some(route);
+            }
+        } else if let Some((label, child)) = self.children.iter().find(|(label, _)| first_char(label) == head) {
+            if path.starts_with(label.as_str()) {
+                if let Some(route) = child.find(&path[label.len()..], params) {
+                    return Some(route);
+                }
+            }
+        }
+        if let Some((name, child)) = &self.param {
+            let end = path.find('/').unwrap_or(path.len());
+            if end > 0 {
+                let mark = params.len();
+                params.push((name.as_str(), &path[..end]));
+                if let Some(route) = child.find(&path[end..], params) {
+                    return Some(route);
+                }
+                params.truncate(mark);
+            }
+        }
+        if let Some((name, route)) = &self.wildcard {
+            params.push((name.as_str(), path));
+            return Some(*route);
+        }
+        None
+    }
+}
+
+/// The request path as routes are written: `%XX` escapes decoded, so a route
+/// "/café" matches the "/caf%C3%A9" a client sends. "%2F" stays encoded (a
+/// decoded slash would move segment boundaries), and a path whose escapes do
+/// not decode to UTF-8 is matched as it came.
+pub fn decode_path(path: &str) -> Cow<'_, str> {
+    if !path.contains('%') {
+        return Cow::Borrowed(path);
+    }
+    let hex = |b: u8| (b as char).to_digit(16).map(|d| d as u8);
+    let bytes = path.as_bytes();
+    let mut out = Vec::with_capacity(bytes.len());
+    let mut i = 0;
+    while i < bytes.len() {
+        if bytes[i] == b'%' && i + 2 < bytes.len() {
+            if let (Some(hi), Some(lo)) = (hex(bytes[i + 1]), hex(bytes[i + 2])) {
+                let byte = hi << 4 | lo;
+                if byte != b'/' {
+                    out.push(byte);
+                    i += 3;
+                    continue;
+                }
+            }
+        }
+        out.push(bytes[i]);
+        i += 1;
+    }
+    match String::from_utf8(out) {
+        Ok(decoded) => Cow::Owned(decoded),
+        Err(_) => Cow::Borrowed(path),
+    }
+}
+
+/// Routes and middleware registered by FSK.route / FSK.use. Route and
+/// middleware ids are chosen by the interpreter and handed back on a match.
+#[derive(Default)]
+pub struct FskRouter {
+    trees: HashMap<String, Node>,
+    middleware: Vec<(String, u32)>,
+}
+
+pub struct RouteMatch<'a, 'p> {
+    pub route: u32,
+    pub params: Vec<(&'a str, &'p str)>,
+}
+
+impl FskRouter {
+    pub fn add(&mut self, method: &str, pattern: &str, route: u32) -> Result<(), String> {
+        let segments = parse_pattern(pattern)?;
+        self.trees.entry(method.to_ascii_uppercase()).or_default().insert(&segments, route)
+    }
+
+    /// Routes registered for `method`, then those registered for any method ("ALL").
+    pub fn find<'a, 'p>(&'a self, method: &str, path: &'p str) -> Option<RouteMatch<'a, 'p>> {
+        for tree in [self.trees.get(method), self.trees.get("ALL")].into_iter().flatten() {
+            let mut params = Vec::new();
+            if let Some(route) = tree.find(path, &mut params) {
+                return Some(RouteMatch { route, params });
+            }
+        }
+        None
+    }
+
+    /// Middleware whose prefix covers `path` (on a segment boundary), in registration order.
+    pub fn middleware_for(&self, path: &str) -> Vec<u32> {
+        self.middleware
+            .iter()
+            .filter(|(prefix, _)| {
+                let prefix = prefix.trim_end_matches('/');
+                path.starts_with(prefix) && (path.len() == prefix.len() || path.as_bytes()[prefix.len()] == b'/')
+            })
+            .map(|(_, id)| *id)
+            .collect()
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn fsk_router_new() -> *mut c_void {
+    Box::into_raw(Box::new(FskRouter::default())) as *mut c_void
+}
+
+/// Frees a router that was not handed to fsk_start_server.
+#[no_mangle]
+pub extern "C" fn fsk_router_free(router: *mut c_void) {
+    if !router.is_null() {
+        unsafe { drop(Box::from_raw(router as *mut FskRouter)) };
+    }
+}
+
+/// Adds `method pattern` as route `route`. On failure returns a message to free
+/// with fsk_free_string, otherwise null.
+#[no_mangle]
+pub extern "C" fn fsk_router_add(router: *mut c_void, method: *const c_char, pattern: *const c_char, route: u32) -> *mut c_char {
+    let router = unsafe { &mut *(router as *mut FskRouter) };
+    let method = unsafe { CStr::from_ptr(method).to_string_lossy() };
+    let pattern = unsafe { CStr::from_ptr(pattern).to_string_lossy() };
+    match router.add(&method, &pattern, route) {
+        Ok(()) => std::ptr::null_mut(),
+        Err(message) => std::ffi::CString::new(format!("{} {}: {}", method, pattern, message)).unwrap_or_default().into_raw(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn fsk_router_use(router: *mut c_void, prefix: *const c_char, id: u32) {
+    let router = unsafe { &mut *(router as *mut FskRouter) };
+    let prefix = unsafe { CStr::from_ptr(prefix).to_string_lossy().into_owned() };
+    router.middleware.push((prefix, id));
+}
@@ -0,0 +1,16 @@
+use tokio::runtime::{Builder, Runtime};
+
+lazy_static::lazy_static! {
+    // One tokio runtime for every server and client in fsk-core.
+    // FSK_TOKIO_THREADS overrides the worker count (defaults to the core count).
+    pub static ref RUNTIME: Runtime = {
+        let mut builder = Builder::new_multi_thread();
+        builder.enable_all().thread_name("fsk-tokio");
+        if let Some(n) = std::env::var("FSK_TOKIO_THREADS").ok().and_then(|v| v.parse::<usize>().ok()) {
+            if n > 0 {
+                builder.worker_threads(n);
+            }
+        }
+        builder.build().expect("Failed to build tokio runtime")
+    };
+}
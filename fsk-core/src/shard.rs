@@ -0,0 +1,50 @@
+use std::collections::HashMap;
+use std::sync::{Mutex, MutexGuard};
+
+/// Shards per map. Ids come from a counter, so consecutive ids land on
+/// consecutive shards and concurrent requests rarely share a lock.
+const SHARDS: usize = 64;
+
+/// Id-keyed table split over SHARDS mutexes, for the tables every tokio worker
+/// and interpreter thread touches per request or message (pending responses,
+/// sockets, connections). Each operation locks one shard, briefly.
+pub struct ShardedMap<V> {
+    shards: Vec<Mutex<HashMap<u64, V>>>,
+}
+
+impl<V> ShardedMap<V> {
+    pub fn new() -> ShardedMap<V> {
+        ShardedMap { shards: (0..SHARDS).map(|_| Mutex::new(HashMap::new())).collect() }
+    }
+
+    fn shard(&self, id: u64) -> MutexGuard<'_, HashMap<u64, V>> {
+        // A panic while holding a shard leaves plain data behind: keep going.
+        self.shards[id as usize % SHARDS].lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    pub fn insert(&self, id: u64, value: V) -> Option<V> {
+        self.shard(id).insert(id, value)
+    }
+
+    pub fn remove(&self, id: u64) -> Option<V> {
+        self.shard(id).remove(&id)
+    }
+
+    /// Runs `f` on the entry with its shard locked; keep `f` short.
+    pub fn with<R>(&self, id: u64, f: impl FnOnce(&mut V) -> R) -> Option<R> {
+        self.shard(id).get_mut(&id).map(f)
+    }
+
+    pub fn get_cloned(&self, id: u64) -> Option<V>
+    where
+        V: Clone,
+    {
+        self.shard(id).get(&id).cloned()
+    }
+}
+
+impl<V> Default for ShardedMap<V> {
+    fn default() -> Self {
+        ShardedMap::new()
+    }
+}
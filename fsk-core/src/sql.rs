@@ -2,11 +2,15 @@ use rusqlite::{Connection, params};
 use std::ffi::{CStr, CString};
 use libc::c_char;
 use std::sync::{Arc, Mutex};
-use std::collections::HashMap;
+use std::sync::atomic::{AtomicU32, Ordering};
+use crate::shard::ShardedMap;
+
+/// Connection ids; 0 means the open failed.
+static NEXT_DB_ID: AtomicU32 = AtomicU32::new(1);
 
 lazy_static::lazy_static! {
-    static ref DB_CONNECTIONS: Arc<Mutex<HashMap<u32, Connection>>> = Arc::new(Mutex::new(HashMap::new()));
-    static ref NEXT_DB_ID: Arc<Mutex<u32>> = Arc::new(Mutex::new(1));
+    // Each connection has its own lock, so a slow query only holds up its own database.
+    static ref DB_CONNECTIONS: ShardedMap<Arc<Mutex<Connection>>> = ShardedMap::new();
 }
 
 #[no_mangle]
@@ -14,10 +18,8 @@ pub extern "C" fn fsk_sql_open(path: *const c_char) -> u32 {
     let path = unsafe { CStr::from_ptr(path).to_string_lossy().into_owned() };
     match Connection::open(path) {
         Ok(conn) => {
-            let mut id_gen = NEXT_DB_ID.lock().unwrap();
-            let id = *id_gen;
-            *id_gen += 1;
-            DB_CONNECTIONS.lock().unwrap().insert(id, conn);
+            let id = NEXT_DB_ID.fetch_add(1, Ordering::Relaxed);
+            DB_CONNECTIONS.insert(id as u64, Arc::new(Mutex::new(conn)));
             id
         }
         Err(_) => 0,
@@ -27,9 +29,10 @@ pub extern "C" fn fsk_sql_open(path: *const c_char) -> u32 {
 #[no_mangle]
 pub extern "C" fn fsk_sql_query(db_id: u32, query: *const c_char) -> *mut c_char {
     let query_str = unsafe { CStr::from_ptr(query).to_string_lossy().into_owned() };
-    let connections = DB_CONNECTIONS.lock().unwrap();
-    
-    if let Some(conn) = connections.get(&db_id) {
+    let connection = DB_CONNECTIONS.get_cloned(db_id as u64);
+
+    if let Some(connection) = connection {
+        let conn = connection.lock().unwrap_or_else(|e| e.into_inner());
         let mut stmt = match conn.prepare(&query_str) {
             Ok(s) => s,
             Err(e) => return CString::new(format!("Error: {}", e)).unwrap().into_raw(),
@@ -0,0 +1,367 @@
+use std::collections::HashMap;
+use std::ffi::{CStr, CString};
+use std::path::{Component, Path, PathBuf};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+use libc::{c_char, c_void};
+use axum::{body::{Body, Bytes}, http::{header, HeaderMap, Method, StatusCode}, response::Response};
+use futures_util::stream;
+use tokio::io::{AsyncReadExt, AsyncSeekExt};
+
+/// Files up to this size are kept in memory and served as shared slices.
+const CACHED_FILE_MAX: u64 = 1024 * 1024;
+/// Total bytes of file contents kept by one server.
+const CACHE_BYTES_MAX: u64 = 64 * 1024 * 1024;
+/// A cached entry is trusted this long before its metadata is checked again.
+const REVALIDATE_AFTER: Duration = Duration::from_secs(1);
+/// Read size for files streamed from disk.
+const STREAM_CHUNK: usize = 64 * 1024;
+
+#[derive(Clone)]
+struct CachedFile {
+    path: PathBuf,
+    len: u64,
+    modified: SystemTime,
+    etag: String,
+    last_modified: String,
+    content_type: &'static str,
+    /// Whole contents for small files; None means stream from disk.
+    data: Option<Bytes>,
+    checked: Instant,
+}
+
+/// Directories mounted with FSK.static, served by the server without entering
+/// the interpreter. Keeps an open-file cache: metadata and, for small files, the
+/// contents, so a hit costs no syscall and no copy.
+#[derive(Default)]
+pub struct StaticFiles {
+    mounts: Vec<(String, PathBuf)>,
+    cache: Mutex<HashMap<PathBuf, Arc<CachedFile>>>,
+    cached_bytes: Mutex<u64>,
+}
+
+impl StaticFiles {
+    pub fn add(&mut self, prefix: &str, dir: &str) -> Result<(), String> {
+        let root = std::fs::canonicalize(dir).map_err(|e| format!("{}: {}", dir, e))?;
+        if !root.is_dir() {
+            return Err(format!("{} is not a directory", dir));
+        }
+        self.mounts.push((prefix.trim_end_matches('/').to_string(), root));
+        Ok(())
+    }
+
+    /// Answers GET/HEAD requests for files under a mount. None lets the request
+    /// continue to the routes (not a static path, or no such file).
+    pub async fn serve(&self, method: &Method, path: &str, headers: &HeaderMap) -> Option<Response<Body>> {
+        if method != Method::GET && method != Method::HEAD {
+            return None;
+        }
+        for (prefix, root) in &self.mounts {
+            let Some(rest) = path.strip_prefix(prefix.as_str()) else { continue };
+            if !rest.is_empty() && !rest.starts_with('/') {
+                continue;
+            }
+            let Some(file) = resolve(root, rest) else { continue };
+            if let Some(entry) = self.lookup(file).await {
+                return Some(respond(&entry, method == Method::HEAD, headers).await);
+            }
+        }
+        None
+    }
+
+    async fn lookup(&self, key: PathBuf) -> Option<Arc<CachedFile>> {
+        let cached = self.cache.lock().unwrap().get(&key).cloned();
+        if let Some(entry) = &cached {
+            if entry.checked.elapsed() < REVALIDATE_AFTER {
+                return cached;
+            }
+        }
+
+        let mut path = key.clone();
+        let mut meta = tokio::fs::metadata(&path).await.ok()?;
+        if meta.is_dir() {
+            path.push("index.html");
+            meta = tokio::fs::metadata(&path).await.ok()?;
+        }
+        if !meta.is_file() {
+            return None;
+        }
+        // Symlinks must not lead out of the mounted directory.
+        let real = tokio::fs::canonicalize(&path).await.ok()?;
+        if !self.mounts.iter().any(|(_, root)| real.starts_with(root)) {
+            return None;
+        }
+
+        let modified = meta.modified().unwrap_or(UNIX_EPOCH);
+        if let Some(entry) = cached {
+            if entry.path == path && entry.len == meta.len() && entry.modified == modified {
+                let entry = Arc::new(CachedFile { checked: Instant::now(), ..(*entry).clone() });
+                self.store(&key, entry.clone());
+                return Some(entry);
+            }
+        }
+
+        let data = if meta.len() <= CACHED_FILE_MAX {
+            Some(Bytes::from(tokio::fs::read(&path).await.ok()?))
+        } else {
+            None
+        };
+        let seconds = modified.duration_since(UNIX_EPOCH).map(|d| d.as_secs()).unwrap_or(0);
+        let entry = Arc::new(CachedFile {
+            len: data.as_ref().map_or(meta.len(), |d| d.len() as u64),
+            etag: format!("\"{:x}-{:x}\"", meta.len(), modified.duration_since(UNIX_EPOCH).map(|d| d.as_nanos()).unwrap_or(0)),
+            last_modified: http_date(seconds),
+            content_type: content_type(&path),
+            path,
+            modified,
+            data,
+            checked: Instant::now(),
+        });
+        self.store(&key, entry.clone());
+        Some(entry)
+    }
+
+    fn store(&self, key: &Path, entry: Arc<CachedFile>) {
+        let mut cache = self.cache.lock().unwrap();
+        let mut bytes = self.cached_bytes.lock().unwrap();
+        let size = entry.data.as_ref().map_or(0, |d| d.len() as u64);
+        if let Some(old) = cache.remove(key) {
+            *bytes -= old.data.as_ref().map_or(0, |d| d.len() as u64);
+        }
+        // Over budget: start over rather than track recency for every hit.
+        if *bytes + size > CACHE_BYTES_MAX {
+            cache.clear();
+            *bytes = 0;
+        }
+        *bytes += size;
+        cache.insert(key.to_path_buf(), entry);
+    }
+}
+
+/// Maps the part of the URL after the mount prefix to a path under root.
+/// Percent-escapes are decoded; "..", absolute and NUL-bearing paths are refused.
+fn resolve(root: &Path, rest: &str) -> Option<PathBuf> {
+    let decoded = percent_decode(rest)?;
+    let mut path = root.to_path_buf();
+    for component in Path::new(decoded.trim_start_matches('/')).components() {
+        match component {
+            Component::Normal(part) => path.push(part),
+            Component::CurDir => {}
+            _ => return None,
+        }
+    }
+    Some(path)
+}
+
+fn percent_decode(text: &str) -> Option<String> {
+    let bytes = text.as_bytes();
+    let mut out = Vec::with_capacity(bytes.len());
+    let mut i = 0;
+    while i < bytes.len() {
+        if bytes[i] == b'%' {
+            let hex = text.get(i + 1..i + 3)?;
+            out.push(u8::from_str_radix(hex, 16).ok()?);
+            i += 3;
+        } else {
+            out.push(bytes[i]);
+            i += 1;
+        }
+    }
+    if out.contains(&0) {
+        return None;
+    }
+    String::from_utf8(out).ok()
+}
+
+async fn respond(file: &CachedFile, head: bool, headers: &HeaderMap) -> Response<Body> {
+    let builder = Response::builder()
+        .header(header::ETAG, file.etag.as_str())
+        .header(header::LAST_MODIFIED, file.last_modified.as_str())
+        .header(header::ACCEPT_RANGES, "bytes");
+
+    let request = |name| headers.get(name).and_then(|v| v.to_str().ok());
+    let not_modified = match request(header::IF_NONE_MATCH) {
+        Some(tags) => tags.split(',').any(|tag| {
+            let tag = tag.trim();
+            tag == "*" || tag.trim_start_matches("W/") == file.etag
+        }),
+        None => request(header::IF_MODIFIED_SINCE)
+            .and_then(parse_http_date)
+            .map_or(false, |since| file.modified.duration_since(UNIX_EPOCH).map_or(true, |m| m.as_secs() <= since)),
+    };
+    if not_modified {
+        return builder.status(StatusCode::NOT_MODIFIED).body(Body::empty()).unwrap();
+    }
+
+    // If-Range: a stale validator means the whole file, not a piece of it.
+    let range_allowed = request(header::IF_RANGE).map_or(true, |v| v == file.etag || v == file.last_modified);
+    let range = if range_allowed { request(header::RANGE).and_then(|r| parse_range(r, file.len)) } else { None };
+    let (status, start, end) = match range {
+        Some(Ok((start, end))) => (StatusCode::PARTIAL_CONTENT, start, end),
+        Some(Err(())) => {
+            return builder
+                .status(StatusCode::RANGE_NOT_SATISFIABLE)
+                .header(header::CONTENT_RANGE, format!("bytes */{}", file.len))
+                .body(Body::empty())
+                .unwrap();
+        }
+        None => (StatusCode::OK, 0, file.len),
+    };
+
+    let mut builder = builder
+        .status(status)
+        .header(header::CONTENT_TYPE, file.content_type)
+        .header(header::CONTENT_LENGTH, end - start);
+    if status == StatusCode::PARTIAL_CONTENT {
+        builder = builder.header(header::CONTENT_RANGE, format!("bytes {}-{}/{}", start, end - 1, file.len));
+    }
+    if head {
+        return builder.body(Body::empty()).unwrap();
+    }
+    if let Some(data) = &file.data {
+        return builder.body(Body::from(data.slice(start as usize..end as usize))).unwrap();
+    }
+
+    let Ok(mut handle) = tokio::fs::File::open(&file.path).await else {
+        return Response::builder().status(StatusCode::NOT_FOUND).body(Body::from("Not Found")).unwrap();
+    };
+    if start > 0 && handle.seek(std::io::SeekFrom::Start(start)).await.is_err() {
+        return Response::builder().status(StatusCode::INTERNAL_SERVER_ERROR).body(Body::empty()).unwrap();
+    }
+    let chunks = stream::unfold((handle, end - start), |(mut handle, remaining)| async move {
+        if remaining == 0 {
+            return None;
+        }
+        let mut buffer = vec![0u8; STREAM_CHUNK.min(remaining as usize)];
+        match handle.read(&mut buffer).await {
+            Ok(0) => None,
+            Ok(n) => {
+                buffer.truncate(n);
+                Some((Ok::<Bytes, std::io::Error>(Bytes::from(buffer)), (handle, remaining - n as u64)))
+            }
+            Err(e) => Some((Err(e), (handle, 0))),
+        }
+    });
+    builder.body(Body::wrap_stream(chunks)).unwrap()
+}
+
+/// Parses a single "bytes=" range into [start, end), Err when it cannot be
+/// satisfied. Malformed and multi-range headers are ignored (None): the whole
+/// file goes out, which RFC 9110 allows.
+fn parse_range(value: &str, len: u64) -> Option<Result<(u64, u64), ()>> {
+    let spec = value.strip_prefix("bytes=")?;
+    if spec.contains(',') {
+        return None;
+    }
+    let (first, last) = spec.split_once('-')?;
+    let (first, last) = (first.trim(), last.trim());
+    let range = if first.is_empty() {
+        let suffix: u64 = last.parse().ok()?;
+        (len.saturating_sub(suffix), len)
+    } else {
+        let start: u64 = first.parse().ok()?;
+        let end = if last.is_empty() { len } else { last.parse::<u64>().ok()?.saturating_add(1).min(len) };
+        (start, end)
+    };
+    if range.0 >= range.1 {
+        return Some(Err(()));
+    }
+    Some(Ok(range))
+}
+
+fn content_type(path: &Path) -> &'static str {
+    let extension = path.extension().and_then(|e| e.to_str()).unwrap_or("").to_ascii_lowercase();
+    match extension.as_str() {
+        "html" | "htm" => "text/html; charset=utf-8",
+        "css" => "text/css; charset=utf-8",
+        "js" | "mjs" => "text/javascript; charset=utf-8",
+        "json" => "application/json",
+        "txt" | "fsk" => "text/plain; charset=utf-8",
+        "svg" => "image/svg+xml",
+        "png" => "image/png",
+        "jpg" | "jpeg" => "image/jpeg",
+        "gif" => "image/gif",
+        "webp" => "image/webp",
+        "ico" => "image/x-icon",
+        "woff" => "font/woff",
+        "woff2" => "font/woff2",
+        "wasm" => "application/wasm",
+        "pdf" => "application/pdf",
+        "mp4" => "video/mp4",
+        _ => "application/octet-stream",
+    }
+}
+
+const DAYS: [&str; 7] = ["Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"];
+const MONTHS: [&str; 12] = ["Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"];
+
+/// IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") for a Unix time.
+fn http_date(seconds: u64) -> String {
+    let days = seconds / 86400;
+    let rem = seconds % 86400;
+    // Civil-from-days (Howard Hinnant), valid for any date after 1970.
+    let z = days as i64 + 719468;
+    let era = z.div_euclid(146097);
+    let doe = z - era * 146097;
+    let yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    let doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    let mp = (5 * doy + 2) / 153;
+    let day = doy - (153 * mp + 2) / 5 + 1;
+    let month = if mp < 10 { mp + 3 } else { mp - 9 };
+    let year = yoe + era * 400 + if month <= 2 { 1 } else { 0 };
+    format!(
+        "{}, {:02} {} {} {:02}:{:02}:{:02} GMT",
+        DAYS[(days % 7) as usize], day, MONTHS[(month - 1) as usize], year,
+        rem / 3600, rem / 60 % 60, rem % 60
+    )
+}
+
+/// Inverse of http_date; other date formats are ignored (None).
+fn parse_http_date(text: &str) -> Option<u64> {
+    let parts: Vec<&str> = text.split_whitespace().collect();
+    if parts.len() != 6 || parts[5] != "GMT" {
+        return None;
+    }
+    let day: i64 = parts[1].parse().ok()?;
+    let month = MONTHS.iter().position(|m| *m == parts[2])? as i64 + 1;
+    let year: i64 = parts[3].parse().ok()?;
+    let time: Vec<u64> = parts[4].split(':').map(|p| p.parse().ok()).collect::<Option<_>>()?;
+    if time.len() != 3 || year < 1970 {
+        return None;
+    }
+    // Days-from-civil, the inverse of the conversion in http_date.
+    let y = if month <= 2 { year - 1 } else { year };
+    let era = y.div_euclid(400);
+    let yoe = y - era * 400;
+    let mp = if month > 2 { month - 3 } else { month + 9 };
+    let doy = (153 * mp + 2) / 5 + day - 1;
+    let doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    let days = (era * 146097 + doe - 719468) as u64;
+    Some(days * 86400 + time[0] * 3600 + time[1] * 60 + time[2])
+}
+
+#[no_mangle]
+pub extern "C" fn fsk_static_new() -> *mut c_void {
+    Box::into_raw(Box::new(StaticFiles::default())) as *mut c_void
+}
+
+/// Frees mounts that were not handed to fsk_start_server.
+#[no_mangle]
+pub extern "C" fn fsk_static_free(files: *mut c_void) {
+    if !files.is_null() {
+        unsafe { drop(Box::from_raw(files as *mut StaticFiles)) };
+    }
+}
+
+/// Mounts `dir` at URL `prefix`. On failure returns a message to free with
+/// fsk_free_string, otherwise null.
+#[no_mangle]
+pub extern "C" fn fsk_static_add(files: *mut c_void, prefix: *const c_char, dir: *const c_char) -> *mut c_char {
+    let files = unsafe { &mut *(files as *mut StaticFiles) };
+    let prefix = unsafe { CStr::from_ptr(prefix).to_string_lossy() };
+    let dir = unsafe { CStr::from_ptr(dir).to_string_lossy() };
+    match files.add(&prefix, &dir) {
+        Ok(()) => std::ptr::null_mut(),
+        Err(message) => CString::new(message).unwrap_or_default().into_raw(),
+    }
+}
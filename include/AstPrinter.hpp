@@ -206,6 +206,12 @@ public:
     std::cout << ")";
   }
 
+  void visitSpawnExpr(Spawn &expr) override {
+    std::cout << "(spawn ";
+    expr.call->accept(*this);
+    std::cout << ")";
+  }
+
   void visitFunctionExpr(FunctionExpr &expr) override {
     std::cout << "(fn args: ";
     for (const auto &param : expr.params) {
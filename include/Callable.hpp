@@ -76,6 +76,7 @@ struct FSKClass : public Callable,
   std::shared_ptr<FSKClass> superclass;
   std::string name;
   std::map<std::string, std::shared_ptr<Callable>> methods;
+  std::map<std::string, Value> statics; // Class-level members (Promise.all, ...)
 
   FSKClass(std::string name, std::shared_ptr<FSKClass> superclass,
            std::map<std::string, std::shared_ptr<Callable>> methods)
@@ -93,8 +94,50 @@ struct FSKInstance : public std::enable_shared_from_this<FSKInstance> {
   std::map<std::string, Value> fields;
 
   FSKInstance(std::shared_ptr<FSKClass> klass) : klass(klass) {}
+  virtual ~FSKInstance() = default;
 
-  Value get(Token name);
-  void set(Token name, Value value);
+  // Virtual so native types can serve fixed fields from C++ members.
+  virtual Value get(Token name);
+  virtual void set(Token name, Value value);
   std::string toString() { return klass->name + " instance"; }
+};
+
+// Native promise: settlement state lives in C++ instead of the fields map.
+// Reactions run as microtasks on the owning interpreter's EventLoop.
+struct FSKPromise : public FSKInstance {
+  enum class State { Pending, Fulfilled, Rejected };
+
+  struct Reaction {
+    std::shared_ptr<Callable> onFulfilled;
+    std::shared_ptr<Callable> onRejected;
+    std::shared_ptr<Callable> onFinally;
+    std::shared_ptr<FSKPromise> derived; // May be null when the result is unused
+  };
+
+  State state = State::Pending;
+  Value value;
+  std::vector<Reaction> reactions;
+
+  FSKPromise(std::shared_ptr<FSKClass> klass) : FSKInstance(klass) {}
+
+  void resolve(Interpreter &interpreter, Value result);
+  void reject(Interpreter &interpreter, Value reason);
+  void addReaction(Interpreter &interpreter, Reaction reaction);
+  std::shared_ptr<FSKPromise> then(Interpreter &interpreter,
+                                   std::shared_ptr<Callable> onFulfilled,
+                                   std::shared_ptr<Callable> onRejected,
+                                   std::shared_ptr<Callable> onFinally = nullptr);
+  Value wait(Interpreter &interpreter);
+
+private:
+  void settle(Interpreter &interpreter, State newState, Value result);
+  void schedule(Interpreter &interpreter, Reaction reaction);
+};
+
+struct FSKPromiseClass : public FSKClass {
+  FSKPromiseClass(std::map<std::string, std::shared_ptr<Callable>> methods)
+      : FSKClass("Promise", nullptr, methods) {}
+
+  int arity() override { return 1; }
+  Value call(Interpreter &interpreter, std::vector<Value> arguments) override;
 };
\ No newline at end of file
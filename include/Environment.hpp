@@ -1,5 +1,7 @@
 #pragma once
 #include "Token.hpp"
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -13,7 +15,15 @@ public:
   Environment(std::shared_ptr<Environment> enclosing) : enclosing(enclosing) {}
 
   void define(std::string name, Value value) { 
-      values[name] = value; 
+      factories.erase(name);
+      Value &slot = values[name];
+      if (holdsFunction(slot) || holdsFunction(value)) functionRevision++;
+      slot = value; 
+  }
+
+  // The value is built by `factory` the first time the name is looked up.
+  void defineLazy(std::string name, std::function<Value()> factory) {
+      factories[name] = std::move(factory);
   }
 
   Value get(Token name) { return get(name.lexeme); }
@@ -23,6 +33,13 @@ public:
       return values[name];
     }
 
+    auto lazy = factories.find(name);
+    if (lazy != factories.end()) {
+      auto factory = std::move(lazy->second);
+      factories.erase(lazy);
+      return values[name] = factory();
+    }
+
     if (enclosing != nullptr)
       return enclosing->get(name);
 
@@ -30,8 +47,10 @@ public:
   }
 
   void assign(Token name, Value value) {
-    if (values.count(name.lexeme)) {
-      values[name.lexeme] = value;
+    if (values.count(name.lexeme) || factories.erase(name.lexeme)) {
+      Value &slot = values[name.lexeme];
+      if (holdsFunction(slot) || holdsFunction(value)) functionRevision++;
+      slot = value;
       return;
     }
 
@@ -44,8 +63,18 @@ public:
   }
 
   std::shared_ptr<Environment> getEnclosing() { return enclosing; }
+  void setEnclosing(std::shared_ptr<Environment> env) { enclosing = env; }
+  const std::map<std::string, Value> &getValues() const { return values; }
+  // Changes whenever a binding here gains or loses a function, so callers can
+  // cache what they derive from this scope's functions (spawn does).
+  uint64_t getFunctionRevision() const { return functionRevision; }
 
 private:
+  static bool holdsFunction(const Value &value) { return std::holds_alternative<std::shared_ptr<Callable>>(value); }
+
+
   std::shared_ptr<Environment> enclosing;
   std::map<std::string, Value> values;
+  std::map<std::string, std::function<Value()>> factories;
+  uint64_t functionRevision = 0;
 };
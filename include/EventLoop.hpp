@@ -9,6 +9,8 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <cstdint>
+#include <cstdio>
 
 struct TimerTask {
     int id;
@@ -24,16 +26,58 @@ struct TimerTask {
 
 class EventLoop {
 public:
+    // Turn durations (task or timer callback plus its microtasks) are bucketed
+    // by these upper bounds in ms; the last bucket catches everything slower.
+    static constexpr int HistogramBuckets = 6;
+    static constexpr double HistogramBoundsMs[HistogramBuckets - 1] = {0.1, 1, 10, 100, 1000};
+
+    struct Stats {
+        double lastLagMs = 0;
+        double maxLagMs = 0;
+        double totalLagMs = 0;
+        uint64_t timersFired = 0;
+        uint64_t tasksRun = 0;
+        uint64_t microtasksRun = 0;
+        double totalTaskMs = 0;
+        double maxTaskMs = 0;
+        uint64_t histogram[HistogramBuckets] = {};
+        size_t queueDepth = 0;
+        size_t maxQueueDepth = 0;
+        int activeWork = 0;
+    };
+
+    // Backlog as other threads see it (the HTTP server's admission control),
+    // read without the lock.
+    struct Load {
+        size_t queueDepth = 0;
+        std::chrono::steady_clock::duration oldestWait{0}; // age of the task next in line
+    };
+
     EventLoop() : stop(false), nextTimerId(1) {}
 
     void post(std::function<void()> task) {
+        auto now = std::chrono::steady_clock::now();
         {
             std::lock_guard<std::mutex> lock(mutex);
-            tasks.push(std::move(task));
+            if (tasks.empty()) oldestPostedAt = now.time_since_epoch().count();
+            tasks.push({std::move(task), now});
+            queued = tasks.size();
+            if (tasks.size() > counters.maxQueueDepth) counters.maxQueueDepth = tasks.size();
         }
         cv.notify_one();
     }
 
+    Load load() const {
+        Load load;
+        load.queueDepth = queued.load(std::memory_order_relaxed);
+        auto oldest = oldestPostedAt.load(std::memory_order_relaxed);
+        if (load.queueDepth > 0 && oldest != 0) {
+            auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+            if (now > oldest) load.oldestWait = std::chrono::steady_clock::duration(now - oldest);
+        }
+        return load;
+    }
+
     int setTimeout(std::function<void()> callback, std::chrono::milliseconds delay) {
         int id;
         {
@@ -61,7 +105,29 @@ public:
         cancelledTimerIds.insert(id);
     }
 
+    // Microtasks are only queued from the loop thread (promise reactions),
+    // so they skip the mutex. They are drained after every macrotask.
+    void queueMicrotask(std::function<void()> task) {
+        microtasks.push(std::move(task));
+    }
+
+    bool runMicrotasks() {
+        bool ran = false;
+        while (!microtasks.empty()) {
+            auto task = std::move(microtasks.front());
+            microtasks.pop();
+            task();
+            counters.microtasksRun++;
+            ran = true;
+        }
+        return ran;
+    }
+
+    bool hasMicrotasks() const { return !microtasks.empty(); }
+
     bool processOne(bool wait) {
+        if (runMicrotasks()) return true;
+
         std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(mutex);
@@ -77,7 +143,11 @@ public:
                 }
 
                 lock.unlock();
+                recordLag(now - t.executeAt);
+                auto started = std::chrono::steady_clock::now();
                 t.callback();
+                runMicrotasks();
+                recordTurn(started);
                 lock.lock();
 
                 if (t.repeat && !cancelledTimerIds.count(t.id)) {
@@ -89,8 +159,10 @@ public:
             }
 
             if (!tasks.empty()) {
-                task = std::move(tasks.front());
+                task = std::move(tasks.front().run);
                 tasks.pop();
+                queued = tasks.size();
+                oldestPostedAt = tasks.empty() ? 0 : tasks.front().postedAt.time_since_epoch().count();
             } else {
                 if (!wait) return false;
 
@@ -108,7 +180,10 @@ public:
         }
 
         if (task) {
+            auto started = std::chrono::steady_clock::now();
             task();
+            runMicrotasks();
+            recordTurn(started);
             return true;
         }
         return false;
@@ -127,6 +202,31 @@ public:
         cv.notify_all();
     }
 
+    // Snapshot of the loop counters. Call from the loop thread.
+    Stats stats() {
+        Stats snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            snapshot = counters;
+            snapshot.queueDepth = tasks.size();
+        }
+        snapshot.activeWork = activeWorkCount;
+        return snapshot;
+    }
+
+    // Nothing queued, scheduled or outstanding. Startup snapshots require it.
+    bool idle() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tasks.empty() && microtasks.empty() && timers.empty() && activeWorkCount == 0;
+    }
+
+    // Print a one-line stats summary to stderr at most every `interval`
+    // (checked between turns, so an idle loop stays silent). Zero disables.
+    void setStatsDump(std::chrono::milliseconds interval) {
+        dumpInterval = interval;
+        lastDump = std::chrono::steady_clock::now();
+    }
+
     void incrementWorkCount() { activeWorkCount++; }
     void decrementWorkCount() { 
         activeWorkCount--; 
@@ -134,7 +234,51 @@ public:
     }
 
 private:
-    std::queue<std::function<void()>> tasks;
+    void recordLag(std::chrono::steady_clock::duration lag) {
+        double ms = std::chrono::duration<double, std::milli>(lag).count();
+        counters.lastLagMs = ms;
+        counters.totalLagMs += ms;
+        if (ms > counters.maxLagMs) counters.maxLagMs = ms;
+        counters.timersFired++;
+    }
+
+    void recordTurn(std::chrono::steady_clock::time_point started) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - started).count();
+        counters.tasksRun++;
+        counters.totalTaskMs += ms;
+        if (ms > counters.maxTaskMs) counters.maxTaskMs = ms;
+        int bucket = 0;
+        while (bucket < HistogramBuckets - 1 && ms >= HistogramBoundsMs[bucket]) bucket++;
+        counters.histogram[bucket]++;
+
+        if (dumpInterval.count() > 0 && now - lastDump >= dumpInterval) {
+            lastDump = now;
+            dumpStats();
+        }
+    }
+
+    void dumpStats() {
+        Stats s = stats();
+        std::fprintf(stderr,
+                     "[loop] lag=%.2fms max=%.2fms queue=%zu max=%zu tasks=%llu avg=%.3fms max=%.2fms active=%d hist=[",
+                     s.lastLagMs, s.maxLagMs, s.queueDepth, s.maxQueueDepth,
+                     (unsigned long long)s.tasksRun, s.tasksRun ? s.totalTaskMs / s.tasksRun : 0.0,
+                     s.maxTaskMs, s.activeWork);
+        for (int i = 0; i < HistogramBuckets; i++) {
+            std::fprintf(stderr, i ? ",%llu" : "%llu", (unsigned long long)s.histogram[i]);
+        }
+        std::fprintf(stderr, "]\n");
+    }
+
+    struct Task {
+        std::function<void()> run;
+        std::chrono::steady_clock::time_point postedAt;
+    };
+    std::queue<Task> tasks;
+    std::atomic<size_t> queued{0};
+    std::atomic<std::chrono::steady_clock::rep> oldestPostedAt{0}; // 0 while the queue is empty
+    std::queue<std::function<void()>> microtasks;
     std::priority_queue<TimerTask, std::vector<TimerTask>, std::greater<TimerTask>> timers;
     std::set<int> cancelledTimerIds;
     int nextTimerId;
@@ -142,4 +286,7 @@ private:
     std::condition_variable cv;
     std::atomic<bool> stop;
     std::atomic<int> activeWorkCount{0};
+    Stats counters;
+    std::chrono::milliseconds dumpInterval{0};
+    std::chrono::steady_clock::time_point lastDump;
 };
@@ -26,6 +26,7 @@ struct Set;
 struct This;
 struct Super;
 struct Await;
+struct Spawn;
 struct Array;
 struct IndexExpr;
 struct IndexSet;
@@ -55,6 +56,7 @@ struct ExprVisitor {
   virtual void visitThisExpr(This &expr) = 0;
   virtual void visitSuperExpr(Super &expr) = 0;
   virtual void visitAwaitExpr(Await &expr) = 0;
+  virtual void visitSpawnExpr(Spawn &expr) = 0;
   virtual void visitArrayExpr(Array &expr) = 0;
   virtual void visitIndexExpr(IndexExpr &expr) = 0;
   virtual void visitIndexSetExpr(IndexSet &expr) = 0;
@@ -170,6 +172,15 @@ struct Await : Expr {
   void accept(ExprVisitor &visitor) override { visitor.visitAwaitExpr(*this); }
 };
 
+// `spawn f(args)`: runs the call as a fiber and yields its join handle.
+struct Spawn : Expr {
+  Token keyword;
+  std::shared_ptr<Call> call;
+  Spawn(Token keyword, std::shared_ptr<Call> call)
+      : keyword(keyword), call(call) {}
+  void accept(ExprVisitor &visitor) override { visitor.visitSpawnExpr(*this); }
+};
+
 struct Array : Expr {
   struct Element {
       std::shared_ptr<Expr> expr;
@@ -201,6 +212,7 @@ struct IndexSet : Expr {
 struct FunctionExpr : Expr {
   std::vector<Parameter> params;
   std::vector<std::shared_ptr<Stmt>> body;
+  std::shared_ptr<struct Function> function; // Built once by the parser, shared by every closure
   FunctionExpr(std::vector<Parameter> params, std::vector<std::shared_ptr<Stmt>> body)
       : params(params), body(body) {}
   void accept(ExprVisitor &visitor) override { visitor.visitFunctionExpr(*this); }
@@ -210,6 +222,7 @@ struct ArrowFunction : Expr {
   std::vector<Parameter> params;
   std::vector<std::shared_ptr<Stmt>> body;
   bool isExpressionBody;
+  std::shared_ptr<struct Function> function; // Built once by the parser, shared by every closure
   ArrowFunction(std::vector<Parameter> params, std::vector<std::shared_ptr<Stmt>> body, bool isExpressionBody)
       : params(params), body(body), isExpressionBody(isExpressionBody) {}
   void accept(ExprVisitor &visitor) override { visitor.visitArrowFunctionExpr(*this); }
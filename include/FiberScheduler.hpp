@@ -0,0 +1,173 @@
+#pragma once
+#include "Callable.hpp"
+#include "StructuredClone.hpp"
+#include "Utils.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FiberTask; // a started fiber: its own stack and saved interpreter state
+
+// Fibers and threads waiting for some shared state to change (a channel, a join).
+// A fiber suspends and its thread goes on with other fibers; any other caller
+// blocks on the condition variable.
+class FiberWaitList {
+public:
+    // Returns once `ready()` holds; it is tried again after every notifyAll().
+    void waitUntil(const std::function<bool()> &ready);
+    void notifyAll();
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t version = 0;
+    std::vector<std::shared_ptr<FiberTask>> fibers;
+};
+
+// Result slot shared by a spawned fiber and its join handle.
+struct FiberState {
+    std::mutex mutex;
+    bool done = false;
+    bool ok = false;
+    ClonedMessage result;
+    FiberWaitList joiners;
+
+    void finish(bool ok, ClonedMessage result);
+    bool isDone();
+    // Returns once the fiber finished. On a scheduler thread a fiber still queued
+    // is run right here; one already running elsewhere is waited for suspended.
+    void wait();
+};
+
+// Top-level functions of the spawning script, re-bound into each scheduler
+// thread's interpreter so fibers can call helpers and spawn recursively.
+using FiberFunctions = std::map<std::string, std::shared_ptr<Function>>;
+
+// M:N scheduler behind `spawn f(args)`. OS threads (one per core, FSK_FIBER_THREADS
+// to override) each own a single interpreter; new fibers are queued on per-thread
+// deques and idle threads steal from the front of busy ones.
+// Each started fiber runs on a stack of its own (8 MB reserved, only backed as it
+// is touched). A fiber blocking in join or on a channel is suspended: its thread
+// saves the interpreter state and runs other fibers, and the fiber resumes on that
+// same thread once woken, so a blocked fiber costs a stack, not an OS thread or an
+// interpreter. Other blocking calls (sleep, sync I/O, awaiting a promise) still
+// hold the thread. The web build has no context switching: there a fiber runs to
+// completion and its blocking waits hold the thread.
+// Only a real cycle, two fibers joining each other, deadlocks. Arguments, captured
+// values and results cross as structured clones, so a fiber never shares mutable
+// state with its spawner.
+class FiberScheduler {
+public:
+    struct Fiber {
+        std::shared_ptr<Function> function;
+        std::shared_ptr<const FiberFunctions> functions; // top-level, bound into globals
+        FiberFunctions closures;                         // functions the closure captured
+        std::vector<std::pair<std::string, ClonedMessage>> captures; // its other locals
+        std::vector<std::pair<std::string, ClonedMessage>> globals;  // top-level values it reads
+        FiberFunctions helpers; // top-level functions it reaches, re-bound over `globals`
+        ClonedMessage args;
+        std::shared_ptr<FiberState> state;
+    };
+
+    struct Stats {
+        size_t threads;
+        size_t parked; // fibers suspended in join or on a channel
+        size_t queued;
+        uint64_t spawned;
+        uint64_t completed;
+        uint64_t stolen;
+    };
+
+    static FiberScheduler &shared();
+
+    void spawn(Fiber fiber);
+    Stats stats();
+
+    // On a scheduler thread, takes the fiber behind `state` off its deque and runs
+    // it inline. False if it already started, or off the scheduler.
+    static bool runQueued(const FiberState *state);
+
+private:
+    friend class FiberWaitList;
+    friend struct FiberTask;
+
+    explicit FiberScheduler(size_t threads);
+
+    struct Worker {
+        std::deque<Fiber> fibers;
+        std::mutex mutex;
+        std::deque<std::shared_ptr<FiberTask>> resumed; // woken fibers of this thread, under wakeMutex
+    };
+
+    bool take(size_t self, Fiber &fiber);
+    void run(Fiber &fiber);
+    void start(Fiber fiber);
+    void workerLoop(size_t self);
+
+    // The fiber running on this thread (null off the scheduler), and the switches
+    // away from it and back.
+    static std::shared_ptr<FiberTask> current();
+    static void suspend();
+    static void resume(std::shared_ptr<FiberTask> task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    size_t pending = 0;
+    size_t suspended = 0;
+
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<uint64_t> spawned{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> stolen{0};
+
+    static inline thread_local FiberScheduler *currentScheduler = nullptr;
+    static inline thread_local size_t currentWorker = 0;
+    static inline thread_local Interpreter *currentInterpreter = nullptr;
+    static inline thread_local FiberTask *currentTask = nullptr;
+    static inline thread_local std::shared_ptr<const FiberFunctions> currentBound;
+};
+
+// Bounded channel shared by fibers, workers and the main thread. Values are
+// structured clones; the channel itself is passed by reference when sent.
+struct ChannelState {
+    explicit ChannelState(size_t capacity) : queue(capacity) {}
+
+    ThreadSafeQueue<ClonedMessage> queue;
+    FiberWaitList waiters; // senders and receivers alike, woken on every change
+
+    // Both wait (suspended, when called from a fiber).
+    // send returns false once closed; recv returns nullopt when closed and drained.
+    bool send(ClonedMessage message);
+    std::optional<ClonedMessage> recv();
+    std::optional<ClonedMessage> tryRecv();
+    void close();
+};
+
+struct FSKFiberHandle : FSKInstance {
+    std::shared_ptr<FiberState> state;
+    bool joined = false;
+    Value result;
+
+    FSKFiberHandle(std::shared_ptr<FSKClass> klass, std::shared_ptr<FiberState> state)
+        : FSKInstance(klass), state(state) {}
+};
+
+struct FSKChannel : FSKInstance {
+    std::shared_ptr<ChannelState> channel;
+
+    FSKChannel(std::shared_ptr<FSKClass> klass, std::shared_ptr<ChannelState> channel)
+        : FSKInstance(klass), channel(channel) {}
+};
+
+std::shared_ptr<FSKFiberHandle> makeFiberHandle(std::shared_ptr<FiberState> state);
+std::shared_ptr<FSKChannel> makeChannel(std::shared_ptr<ChannelState> channel);
@@ -1,7 +1,72 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 
+// `state` of fsk_on_http_body, matching fsk-core's BODY_* constants.
+enum FskBodyState : int32_t { FskBodyData = 0, FskBodyEnd = 1, FskBodyAborted = 2 };
+
+// FskWsOptions::overflow, matching fsk-core's WS_OVERFLOW_* constants.
+enum FskWsOverflow : uint32_t { FskWsDropOldest = 0, FskWsDisconnect = 1, FskWsBlock = 2 };
+
 extern "C" {
-    void fsk_on_http_request(uint64_t req_id, const char* method, const char* path, const char* body, void* context);
-    void fsk_on_ws_message(uint32_t ws_id, const char* message, void* context);
+    // Name/value pair (response headers, route params).
+    struct FskHeader {
+        const char* name;
+        const char* value;
+    };
+
+    // Mirrors fsk-core's FskRequest; pointers are only valid during the callback.
+    struct FskRequest {
+        uint64_t id;
+        const char* method;
+        const char* path;
+        const uint8_t* body;      // empty when streaming: chunks come through fsk_on_http_body
+        size_t body_len;
+        bool streaming;
+        int32_t route;            // matched FSK.route id, -1 without a match
+        const FskHeader* params;
+        size_t param_count;
+        const uint32_t* middleware; // FSK.use ids covering the path, in order
+        size_t middleware_count;
+    };
+
+    // Mirrors fsk-core's FskBenchOptions (`fsk bench-http`).
+    struct FskBenchOptions {
+        uint16_t port;
+        const char* method;
+        const char* path;
+        const char* content_type;
+        const char* body;
+        size_t body_len;
+        uint32_t connections;
+        uint64_t duration_ms;
+        uint64_t warmup_ms;
+    };
+
+    // Mirrors fsk-core's FskLoopLoad: an interpreter's event loop backlog.
+    struct FskLoopLoad {
+        uint64_t queue_depth;
+        uint64_t lag_us; // wait of the oldest queued task
+    };
+
+    // Mirrors fsk-core's FskWsMessage; `data` is only valid during the callback.
+    struct FskWsMessage {
+        const uint8_t* data;
+        size_t len;
+        bool binary;
+    };
+
+    // Mirrors fsk-core's FskWsOptions (WS.listen's third argument).
+    struct FskWsOptions {
+        uint32_t max_queue;       // frames waiting per socket, 0 for no limit
+        uint32_t overflow;        // FskWsOverflow
+        uint64_t block_timeout_ms;
+        uint32_t max_batch;       // inbound messages per fsk_on_ws_message call
+    };
+
+    void fsk_on_http_request(const FskRequest* request, void* context);
+    void fsk_http_loop_load(void* context, FskLoopLoad* out);
+    void fsk_on_http_body(uint64_t req_id, const uint8_t* data, size_t len, int32_t state, void* context);
+    void fsk_on_http_drain(uint64_t req_id, size_t bytes, bool written, void* context);
+    void fsk_on_ws_message(uint32_t ws_id, const FskWsMessage* messages, size_t count, void* context);
 }
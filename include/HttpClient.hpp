@@ -0,0 +1,128 @@
+#pragma once
+#ifndef __EMSCRIPTEN__
+#include <curl/curl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Keep-alive HTTP client behind the HTTP module, one per interpreter. Easy
+// handles are pooled and reset between requests instead of being created and
+// cleaned up each time, and all of them share one CURLSH for the DNS cache and
+// TLS sessions. Open connections are not in it (libcurl cannot share them
+// between threads): they stay with the pooled handle that opened them for
+// blocking requests, and with the multi handle for submit(). A request to a
+// host seen before skips the lookup and the TLS handshake, and the TCP connect
+// when its handle or the multi handle still holds one. Safe to use from
+// several threads.
+//
+// submit() runs requests without blocking the caller: one I/O thread per
+// client drives every transfer on a curl_multi handle and calls each
+// completion from that thread. Both paths share the maxPerHost slots: async
+// requests over the limit wait in a queue on the I/O thread.
+class HttpClient {
+public:
+    struct Options {
+        long maxPerHost = 8;    // requests in flight to one scheme://host:port; more wait
+        long maxIdle = 32;      // pooled handles and cached connections kept
+        long timeoutMs = 10000; // whole request, unless the request sets its own
+        bool keepAlive = true;  // false: a new handle and connection per request
+    };
+
+    struct Request {
+        std::string method = "GET";
+        std::string url;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string body;
+        long timeoutMs = 0; // 0: Options::timeoutMs
+    };
+
+    struct Response {
+        bool ok = false; // a response arrived, whatever its status
+        std::string error;
+        long status = 0;
+        std::vector<std::pair<std::string, std::string>> headers; // names lower-cased
+        std::string body;
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t failures = 0;
+        uint64_t connections = 0; // opened; requests minus this went over a reused one
+        uint64_t handles = 0;     // easy handles created
+        size_t idle = 0;
+        size_t pending = 0;       // submitted and not completed yet
+    };
+
+    // One request in progress, for callers that drive the handle themselves
+    // (curl_multi). begin() takes a handle from the pool and points it at
+    // `request` and `response`; finish() fills in the outcome and returns it.
+    struct Transfer {
+        Request request;
+        Response response;
+        curl_slist *headerList = nullptr;
+        char errorBuffer[CURL_ERROR_SIZE] = {};
+    };
+
+    HttpClient();
+    explicit HttpClient(Options options);
+    ~HttpClient();
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    void configure(const Options &options);
+    Options options();
+    Stats stats();
+
+    // Blocking request; waits first if its host already has maxPerHost in flight.
+    Response perform(Request request);
+
+    using Completion = std::function<void(Response)>;
+
+    // Starts `request` on the I/O thread; `done` runs there once it completes
+    // or fails. Completions still pending when the client is destroyed are dropped.
+    void submit(Request request, Completion done);
+
+    CURL *begin(Transfer &transfer);
+    void finish(CURL *handle, Transfer &transfer, CURLcode code);
+
+    // "scheme://host:port" of a URL, the unit of maxPerHost.
+    static std::string hostOf(const std::string &url);
+
+private:
+    void acquireSlot(const std::string &host);
+    bool tryAcquireSlot(const std::string &host);
+    void releaseSlot(const std::string &host);
+
+    static void lockShare(CURL *, curl_lock_data data, curl_lock_access, void *client);
+    static void unlockShare(CURL *, curl_lock_data data, void *client);
+
+    struct Async {
+        std::string host;
+        Transfer transfer;
+        Completion done;
+    };
+    void ioLoop();
+
+    CURLSH *share;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+    CURLM *multi = nullptr; // created with the I/O thread, used only there (and by curl_multi_wakeup)
+    std::thread ioThread;
+
+    std::mutex mutex; // everything below
+    std::condition_variable slotFree;
+    Options settings;
+    std::vector<CURL *> idle;
+    std::map<std::string, long> inFlight;
+    Stats counters;
+    std::vector<std::unique_ptr<Async>> submitted; // waiting for the I/O thread to pick them up
+    bool stopping = false;
+};
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+#include "Callable.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Response side of an FSK.listen request. Status and headers are plain members;
+// send/json/status/header/cache/write/end/onDrain are methods of the class, shared by
+// every instance. Bodies are length-delimited, so binary strings and SharedBuffers go out intact.
+struct FSKHttpResponse : FSKInstance {
+    // Bytes a stream may have waiting for the client before write() returns false.
+    static constexpr size_t HighWater = 64 * 1024;
+
+    uint64_t id = 0;
+    int statusCode = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool sent = false;      // status and headers are out
+    bool streaming = false; // body goes out through write()/end()
+    bool ended = false;
+    bool closed = false;    // client went away during a stream, or it was aborted
+    size_t queued = 0;      // bytes written that the client has not taken yet
+    bool draining = false;  // a write() returned false: onDrain runs once queued is 0
+    std::shared_ptr<Callable> onDrain;
+
+    explicit FSKHttpResponse(std::shared_ptr<FSKClass> klass) : FSKInstance(klass) {}
+
+    Value get(Token name) override;
+    void setHeader(const std::string &name, const std::string &value);
+    // Answers the request once; later calls are ignored.
+    void send(std::string_view body);
+    // Queues a chunk, sending status and headers first if needed, and returns at
+    // once. False once the client is gone, or while more than HighWater bytes wait
+    // for it: the chunk is queued all the same, but the script should wait for onDrain.
+    bool write(std::string_view chunk);
+    void end();
+    // Cuts a stream short, so the client sees a truncated transfer rather than a
+    // complete body.
+    void abort();
+    // fsk-core handed `bytes` to the client, or dropped them with the stream.
+    void drained(Interpreter &interp, size_t bytes, bool written);
+};
+
+// Request handed to the handler as `req`. The method, path and body strings are
+// moved in from the server callback, never copied into the fields map.
+//
+// Bodies over the server's buffer size stream instead: `req.streaming` is true,
+// `req.body` stays empty and chunks reach `req.onData(cb)`, then `req.onEnd(cb)`
+// (or `req.onError(cb)` if the upload was cut or went over maxBodySize). Chunks
+// that arrive before onData is registered wait here; the server stops reading
+// the client until they are consumed. Buffered bodies go through the same
+// callbacks as a single chunk, so handlers can use onData either way.
+struct FSKHttpRequest : FSKInstance {
+    uint64_t id = 0;
+    std::string method;
+    std::string path;
+    std::string body;
+    std::shared_ptr<FSKHttpResponse> response;
+    // Route parameters extracted by the router; `req.params` builds its object on first use.
+    std::vector<std::pair<std::string, std::string>> params;
+    Value paramsObject = std::monostate{};
+
+    bool streaming = false;
+    bool bodyEnded = false;
+    bool aborted = false;
+    std::deque<std::string> pendingChunks;
+    std::shared_ptr<Callable> onData;
+    std::shared_ptr<Callable> onEnd;
+    std::shared_ptr<Callable> onError;
+
+    explicit FSKHttpRequest(std::shared_ptr<FSKClass> klass) : FSKInstance(klass) {}
+
+    Value get(Token name) override;
+    void set(Token name, Value value) override;
+
+    void pushChunk(Interpreter &interp, std::string chunk);
+    void finishBody(Interpreter &interp, bool aborted);
+    // Runs whatever the registered callbacks can take now.
+    void flushBody(Interpreter &interp);
+};
+
+// Routes and middleware registered with FSK.route / FSK.use. fsk-core does the
+// matching and hands back ids that index these vectors; every isolate runs the
+// same script, so the ids agree across isolates.
+struct HttpRoutes {
+    struct Route {
+        std::string method;
+        std::string pattern;
+        std::shared_ptr<Callable> handler;
+    };
+    struct Middleware {
+        std::string prefix;
+        std::shared_ptr<Callable> handler;
+    };
+    std::vector<Route> routes;
+    std::vector<Middleware> middleware;
+    // FSK.static mounts (URL prefix, directory), served by fsk-core alone.
+    std::vector<std::pair<std::string, std::string>> statics;
+
+    bool empty() const { return routes.empty() && middleware.empty() && statics.empty(); }
+
+    // Calls each middleware as (req, res, next), then the route's handler, or
+    // `fallback` when route is -1 (404 without one). A middleware that doesn't
+    // call next() ends the chain.
+    void dispatch(Interpreter &interp, std::shared_ptr<FSKHttpRequest> req, int route,
+                  const std::vector<uint32_t> &chain, std::shared_ptr<Callable> fallback);
+};
+
+// Per-isolate free lists of Request/Response objects. acquire() hands out a
+// recycled pair when one is available; the pair goes back to the pool when the
+// script drops its last reference (possibly long after the handler returned).
+// A response dropped without being sent answers 500 so the client is not left
+// waiting. Only used from the owning interpreter's thread.
+class HttpPool {
+public:
+    static constexpr size_t MaxFree = 256;
+
+    HttpPool();
+    ~HttpPool();
+    HttpPool(const HttpPool &) = delete;
+    HttpPool &operator=(const HttpPool &) = delete;
+
+    std::shared_ptr<FSKHttpRequest> acquire(uint64_t id, std::string method, std::string path, std::string body,
+                                            bool streaming = false);
+
+    // Requests whose body is still streaming in, by id.
+    std::unordered_map<uint64_t, std::weak_ptr<FSKHttpRequest>> uploads;
+    // Streaming responses with chunks still on their way to the client, by id.
+    std::unordered_map<uint64_t, std::weak_ptr<FSKHttpResponse>> streams;
+
+private:
+    struct FreeLists {
+        std::vector<FSKHttpRequest *> requests;
+        std::vector<FSKHttpResponse *> responses;
+    };
+    std::shared_ptr<FreeLists> free;
+
+    std::shared_ptr<FSKHttpResponse> acquireResponse(uint64_t id);
+};
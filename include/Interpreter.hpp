@@ -10,15 +10,27 @@
 #include <thread>
 #include "Utils.hpp"
 #include "EventLoop.hpp"
+#include "StructuredClone.hpp"
+#include "HttpObjects.hpp"
 #include <raylib.h>
 
+struct FSKClass;
+struct FSKPromise;
+class HttpClient;
 
 class Interpreter : public ExprVisitor, public StmtVisitor {
 public:
-  Interpreter();
+  // withPrelude=false skips std/prelude.fsk (snapshot restore, or loadPrelude() later).
+  explicit Interpreter(bool withPrelude = true);
+  void loadPrelude();
   void interpret(std::vector<std::shared_ptr<Stmt>> statements, bool runEventLoop = true, bool replMode = false);
+  // Prints an uncaught error (and the call stack) the way a failing top-level statement does.
+  void reportError(const std::string &message);
   
   std::shared_ptr<EventLoop> eventLoop;
+  std::shared_ptr<FSKClass> promiseClass;
+
+  std::shared_ptr<FSKPromise> makePromise();
 
   void visitExpressionStmt(Expression &stmt) override;
   void visitPrintStmt(Print &stmt) override;
@@ -49,6 +61,7 @@ public:
   void visitThisExpr(This &expr) override;
   void visitSuperExpr(Super &expr) override;
   void visitAwaitExpr(Await &expr) override;
+  void visitSpawnExpr(Spawn &expr) override;
   void visitArrayExpr(Array &expr) override;
   void visitIndexExpr(IndexExpr &expr) override;
   void visitIndexSetExpr(IndexSet &expr) override;
@@ -71,6 +84,16 @@ public:
   Value evaluate(std::shared_ptr<Expr> expr);
   void execute(std::shared_ptr<Stmt> stmt);
 
+  // Lexes and parses a source unit. With recordSources the text is kept and its
+  // functions are tagged with the unit index, so a snapshot can re-parse them.
+  std::vector<std::shared_ptr<Stmt>> parseSource(const std::string &source);
+  bool recordSources = false;
+  std::vector<std::string> sources;
+  bool snapshotting = false; // running `fsk snapshot`: FSK.snapshotting() is true
+
+  // Native modules built so far, by global name (snapshot writers map them back to IDs).
+  std::map<std::string, Value> nativeModules;
+
   std::shared_ptr<Environment> globals;
   std::shared_ptr<Environment> environment;
   Value lastValue;
@@ -80,29 +103,94 @@ private:
 
   bool isTruthy(Value value);
   bool isEqual(Value a, Value b);
+  void getProperty(Value object, Get &expr); // visitGetExpr on an evaluated object
+
+  // Native module factories, registered with Environment::defineLazy.
+  Value makeFskModule();
+  Value makeWsModule();
+  Value makeFfiModule();
+  Value makeConsoleModule();
+  Value makeSqlModule();
+  Value makeSystemModule();
+  Value makeVmModule();
+  Value makeJsonModule();
+  Value makeAudioModule();
+  Value makeGraphicsModule();
+  Value makeMathModule();
+  Value makeCryptoModule();
+  Value makeDateModule();
+  Value makeFsModule();
+  Value makeWorkerModule();
+  Value makeTaskModule();
+  Value makeAtomicsModule();
+  Value makeRegexModule();
+  Value makeHttpModule();
 
 public:
   int dbIdCounter = 1;
   std::map<int, void*> databases; 
 
+  // HTTP module's keep-alive client (see HttpClient.hpp), created on first use.
+  std::shared_ptr<HttpClient> httpClient;
+
   int wsIdCounter = 1;
   std::map<int, std::shared_ptr<void>> sockets;
 
+  // WS.listen: messages handed over by fsk-core and not delivered yet. One
+  // loop task drains whatever piled up, however many sockets it came from.
+  struct WsInbox {
+      struct Message {
+          uint32_t wsId;
+          std::string bytes;
+          bool binary;
+      };
+      std::mutex mutex;
+      std::vector<Message> messages;
+      bool scheduled = false;
+  };
+  WsInbox wsInbox;
+  bool wsBatch = false; // handler takes (ws, [messages]) per socket and drain
+
   int fsWatcherId = 1;
   std::map<int, int> fsWatchers;
 
   struct WorkerResource {
       std::shared_ptr<std::thread> thread;
-      std::shared_ptr<ThreadSafeQueue<std::string>> incoming; 
-      std::shared_ptr<ThreadSafeQueue<std::string>> outgoing; 
+      std::shared_ptr<ThreadSafeQueue<ClonedMessage>> incoming; 
+      std::shared_ptr<ThreadSafeQueue<ClonedMessage>> outgoing; 
+      // Main side on a full queue: refuse the message (false) or wait (true). The
+      // worker side always waits; with both waiting, a main loop stuck on a full
+      // `incoming` and a worker stuck on a full `outgoing` would never wake.
+      bool blocking = false;
   };
   
   int workerIdCounter = 1;
   std::map<int, std::shared_ptr<WorkerResource>> workers;
   
   bool isWorker = false;
-  std::shared_ptr<ThreadSafeQueue<std::string>> workerIncoming;
-  std::shared_ptr<ThreadSafeQueue<std::string>> workerOutgoing;
+  std::shared_ptr<ThreadSafeQueue<ClonedMessage>> workerIncoming;
+  std::shared_ptr<ThreadSafeQueue<ClonedMessage>> workerOutgoing;
+
+  // FSK.listen(port, handler, {isolates: N}) runs the script in N interpreters;
+  // each one's listen call registers it here before the server starts.
+  struct IsolateGroup {
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::vector<Interpreter *> members;
+      int settled = 0;      // secondaries that reached listen or ended their top-level run without it
+      bool serving = false; // the port is bound; members joining now are turned away
+  };
+  int isolateId = 0;
+  std::shared_ptr<Callable> httpHandler; // set by FSK.listen, called for every request
+  HttpPool httpPool;
+  HttpRoutes httpRoutes; // FSK.route / FSK.use, compiled into fsk-core's router at listen
+  std::shared_ptr<IsolateGroup> isolateGroup;
+  static inline int defaultIsolates = 1; // `--isolates N` on the command line
+
+  // Top-level functions last shipped with `spawn`; reused while unchanged so
+  // scheduler threads only re-bind them when the script defines new ones.
+  std::shared_ptr<const std::map<std::string, std::shared_ptr<Function>>> spawnFunctions;
+  uint64_t spawnFunctionsRevision = 0; // globals' function revision they were read at
 
   std::vector<Sound> sounds;
   std::vector<Texture2D> textures;
@@ -10,6 +10,9 @@ public:
   Parser(std::vector<Token> tokens);
   std::vector<std::shared_ptr<Stmt>> parse();
 
+  // Every function declaration, lambda and arrow, in source order (Function::id).
+  std::vector<std::shared_ptr<Function>> functions;
+
 private:
   std::vector<Token> tokens;
   int current = 0;
@@ -17,6 +20,7 @@ private:
   std::shared_ptr<Stmt> declaration();
   std::shared_ptr<Stmt> classDeclaration();
   std::shared_ptr<Stmt> function(std::string kind, bool isAsync = false);
+  std::shared_ptr<Function> declare(std::shared_ptr<Function> function);
   std::shared_ptr<Stmt> varDeclaration();
   std::shared_ptr<Stmt> constDeclaration();
   std::shared_ptr<Stmt> importStatement();
@@ -0,0 +1,68 @@
+#pragma once
+#include "Callable.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// One refcounted allocation shared by every interpreter that holds a
+// SharedBuffer over it. Workers receive the same memory through postMessage;
+// nothing is copied. Waiters for Atomics.wait/notify are tracked per memory.
+struct SharedMemory {
+    explicit SharedMemory(size_t byteLength);
+    ~SharedMemory();
+
+    uint8_t *bytes;
+    size_t byteLength;
+
+    struct Waiter {
+        size_t byteOffset;
+        bool notified = false;
+    };
+    std::mutex waitMutex;
+    std::condition_variable waitCv;
+    std::list<Waiter *> waiters;
+};
+
+struct FSKSharedBuffer : FSKInstance {
+    std::shared_ptr<SharedMemory> memory;
+
+    FSKSharedBuffer(std::shared_ptr<FSKClass> klass, std::shared_ptr<SharedMemory> memory);
+};
+
+// Typed window over a SharedBuffer. Element reads and writes are relaxed atomics,
+// so racing workers see torn-free values; Atomics.* gives ordering guarantees.
+struct FSKTypedView : FSKInstance {
+    enum class Kind { F64, I32, U8 };
+
+    std::shared_ptr<SharedMemory> memory;
+    Kind kind;
+    size_t byteOffset;
+    size_t length;
+
+    FSKTypedView(std::shared_ptr<FSKClass> klass, std::shared_ptr<SharedMemory> memory,
+                 Kind kind, size_t byteOffset, size_t length);
+
+    static size_t elementSize(Kind kind);
+    static const char *kindName(Kind kind);
+
+    double load(size_t index) const;
+    void store(size_t index, double value);
+
+    // Integer views only (i32/u8). Each returns the previous value.
+    double fetchAdd(size_t index, double delta);
+    double exchange(size_t index, double value);
+    double compareExchange(size_t index, double expected, double replacement);
+
+    // "ok", "not-equal" or "timed-out", like Atomics.wait. timeoutMs < 0 waits forever.
+    std::string wait(size_t index, double expected, double timeoutMs);
+    int notify(size_t index, int count);
+
+    void checkIndex(size_t index) const;
+};
+
+std::shared_ptr<FSKSharedBuffer> makeSharedBuffer(std::shared_ptr<SharedMemory> memory);
+std::shared_ptr<FSKTypedView> makeTypedView(std::shared_ptr<SharedMemory> memory, FSKTypedView::Kind kind,
+                                            size_t byteOffset, size_t length);
@@ -0,0 +1,22 @@
+#pragma once
+#include "Token.hpp"
+#include <map>
+#include <string>
+
+class Interpreter;
+
+// Startup snapshots: `fsk snapshot app.fsk -o app.snap`, then `fsk --snapshot app.snap`.
+//
+// A snapshot stores the source units the interpreter parsed (prelude, script,
+// imports) and the global heap after initialization: environments, closures,
+// classes, instances, arrays and primitives, with sharing and cycles preserved.
+// Restoring re-parses the units without running them, finds each function again
+// by (unit, index) and rebuilds the heap. Natives are stored by ID, the global
+// path they are reachable from ("print", "Math.sin"), and re-bound to the
+// restoring interpreter's own. Promises, handles and other native state cannot
+// be captured.
+
+// `builtins` are the interpreter's globals right after construction, before any
+// script ran; together with Interpreter::nativeModules they define the native IDs.
+void writeSnapshot(Interpreter &interp, const std::map<std::string, Value> &builtins, const std::string &path);
+void restoreSnapshot(Interpreter &interp, const std::string &path);
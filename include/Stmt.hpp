@@ -108,6 +108,10 @@ struct Function : Stmt {
   std::vector<std::shared_ptr<Stmt>> body;
   bool isAsync;
   std::string returnType;
+  // Source unit and position among that unit's functions (Parser::functions);
+  // lets a startup snapshot find the declaration again by re-parsing. -1 = unknown.
+  int unit = -1;
+  int id = -1;
 
   Function(Token name, std::vector<Parameter> params,
            std::vector<std::shared_ptr<Stmt>> body, bool isAsync,
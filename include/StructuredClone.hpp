@@ -0,0 +1,40 @@
+#pragma once
+#include "Token.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SharedMemory;
+struct ChannelState;
+
+// Structured-clone wire format for values crossing interpreter threads
+// (postMessage, workerPostMessage, Task, Worker.pool).
+//
+// Values are encoded into a compact tagged byte string: numbers, strings, bools,
+// nil, arrays and objects, nested and with shared/cyclic references preserved.
+// Strings of LargeString bytes or more travel out of band so they are moved
+// instead of re-copied into the buffer. With transfer=true, arrays holding only
+// primitives hand their element storage over wholesale and are left empty in the
+// sender. SharedBuffers and their views are passed by reference to the same
+// memory, and Channels by reference to the same queue. Functions cannot be cloned.
+struct ClonedMessage {
+    static constexpr size_t LargeString = 4096;
+
+    std::string data;
+    std::vector<std::string> strings;
+    std::vector<std::vector<Value>> arrays;
+    std::vector<std::shared_ptr<SharedMemory>> shared;
+    std::vector<std::shared_ptr<ChannelState>> channels;
+
+    ClonedMessage() = default;
+    ClonedMessage(ClonedMessage &&) = default;
+    ClonedMessage &operator=(ClonedMessage &&) = default;
+    ClonedMessage(const ClonedMessage &) = delete;
+    ClonedMessage &operator=(const ClonedMessage &) = delete;
+
+    static ClonedMessage fromValue(Value value, bool transfer = false);
+
+    // Rebuilds the value on the receiving thread. Moves the out-of-band
+    // buffers out, so it can only be called once.
+    Value toValue();
+};
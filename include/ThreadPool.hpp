@@ -0,0 +1,118 @@
+#pragma once
+#include <functional>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdlib>
+#include <string>
+
+// Process-wide pool for short blocking natives (fetch, ...). Long-lived work
+// (Worker, Task) gets its own thread so it never holds a slot others wait for.
+// Threads are spawned lazily up to maxThreads; jobs beyond maxQueue are refused
+// so callers can fail fast instead of piling up OS threads.
+class ThreadPool {
+public:
+    struct Stats {
+        size_t threads;
+        size_t maxThreads;
+        size_t active;
+        size_t queued;
+        size_t maxQueue;
+        size_t completed;
+        size_t rejected;
+    };
+
+    static ThreadPool &shared() {
+        // Leaked on purpose: detached workers may still run during static destruction.
+        static ThreadPool *pool = new ThreadPool(envSize("FSK_IO_THREADS", defaultThreads()),
+                                                 envSize("FSK_IO_QUEUE", 1024));
+        return *pool;
+    }
+
+    ThreadPool(size_t maxThreads, size_t maxQueue)
+        : maxThreads(maxThreads ? maxThreads : 1), maxQueue(maxQueue) {}
+
+    bool submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.size() >= maxQueue) {
+                rejected++;
+                return false;
+            }
+            jobs.push(std::move(job));
+            // Sleeping threads count as idle until they wake: in a burst, one of
+            // them must not stand in for every queued job.
+            if (jobs.size() > idle && threads < maxThreads) {
+                threads++;
+                std::thread([this]() { workerLoop(); }).detach();
+            }
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    void configure(size_t newMaxThreads, size_t newMaxQueue) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (newMaxThreads) maxThreads = newMaxThreads;
+            if (newMaxQueue) maxQueue = newMaxQueue;
+        }
+        cv.notify_all();
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {threads, maxThreads, active, jobs.size(), maxQueue, completed, rejected};
+    }
+
+private:
+    static size_t defaultThreads() {
+        size_t hw = std::thread::hardware_concurrency();
+        return hw > 4 ? hw : 4;
+    }
+
+    static size_t envSize(const char *name, size_t fallback) {
+        const char *value = std::getenv(name);
+        if (!value) return fallback;
+        try {
+            long parsed = std::stol(value);
+            return parsed > 0 ? (size_t)parsed : fallback;
+        } catch (...) {
+            return fallback;
+        }
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            idle++;
+            cv.wait(lock, [this] { return !jobs.empty() || threads > maxThreads; });
+            idle--;
+            if (threads > maxThreads) {
+                threads--;
+                return;
+            }
+
+            auto job = std::move(jobs.front());
+            jobs.pop();
+            active++;
+            lock.unlock();
+            try { job(); } catch (...) {}
+            lock.lock();
+            active--;
+            completed++;
+        }
+    }
+
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t maxThreads;
+    size_t maxQueue;
+    size_t threads = 0;
+    size_t idle = 0;
+    size_t active = 0;
+    size_t completed = 0;
+    size_t rejected = 0;
+};
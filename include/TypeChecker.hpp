@@ -31,6 +31,7 @@ public:
     void visitTemplateLiteralExpr(TemplateLiteral &expr) override;
     void visitArrowFunctionExpr(ArrowFunction &expr) override;
     void visitAwaitExpr(Await &expr) override;
+    void visitSpawnExpr(Spawn &expr) override;
 
     void visitExpressionStmt(Expression &stmt) override;
     void visitPrintStmt(Print &stmt) override;
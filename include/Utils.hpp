@@ -1,48 +1,127 @@
 #pragma once
 #include <queue>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 #include <optional>
+#include <vector>
+#include <cstddef>
 
+// MPMC queue used between interpreter threads. Items are moved in and out, never
+// copied. With a non-zero capacity push() blocks while the queue is full (backpressure)
+// and tryPush() refuses instead. close() wakes every blocked producer and consumer.
 template <typename T>
 class ThreadSafeQueue {
 private:
     std::queue<T> queue;
     std::mutex mutex;
-    std::condition_variable cond;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    size_t limit; // 0 = unbounded
     bool closed = false;
 
+    bool full() const { return limit != 0 && queue.size() >= limit; }
+
 public:
-    void push(T item) {
+    explicit ThreadSafeQueue(size_t capacity = 0) : limit(capacity) {}
+
+    // Waits for room; returns false if the queue was closed.
+    bool push(T item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return !full() || closed; });
+            if (closed) return false;
+            queue.push(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Never waits. On failure (full or closed) `item` is left untouched.
+    bool tryPush(T &item) {
         {
             std::lock_guard<std::mutex> lock(mutex);
-            queue.push(item);
+            if (closed || full()) return false;
+            queue.push(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Waits up to `timeout` for room; on failure `item` is left untouched.
+    bool tryPush(T &item, std::chrono::milliseconds timeout) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait_for(lock, timeout, [this] { return !full() || closed; });
+            if (closed || full()) return false;
+            queue.push(std::move(item));
         }
-        cond.notify_one();
+        notEmpty.notify_one();
+        return true;
     }
 
     std::optional<T> pop(bool block = true) {
-        std::unique_lock<std::mutex> lock(mutex);
-        if (!block) {
+        std::optional<T> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (block) notEmpty.wait(lock, [this] { return !queue.empty() || closed; });
+            if (queue.empty()) return std::nullopt;
+            item.emplace(std::move(queue.front()));
+            queue.pop();
+        }
+        notFull.notify_one();
+        return item;
+    }
+
+    // Like pop(true) but gives up after `timeout`.
+    std::optional<T> popFor(std::chrono::milliseconds timeout) {
+        std::optional<T> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait_for(lock, timeout, [this] { return !queue.empty() || closed; });
             if (queue.empty()) return std::nullopt;
-            T item = queue.front();
+            item.emplace(std::move(queue.front()));
             queue.pop();
-            return item;
         }
-        
-        cond.wait(lock, [this] { return !queue.empty() || closed; });
-        if (queue.empty() && closed) return std::nullopt;
-        
-        T item = queue.front();
-        queue.pop();
+        notFull.notify_one();
         return item;
     }
 
+    // Takes up to `max` items under a single lock. With block=true waits for the first one.
+    std::vector<T> popBatch(size_t max, bool block = false) {
+        std::vector<T> items;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (block) notEmpty.wait(lock, [this] { return !queue.empty() || closed; });
+            while (!queue.empty() && items.size() < max) {
+                items.push_back(std::move(queue.front()));
+                queue.pop();
+            }
+        }
+        if (!items.empty()) notFull.notify_all();
+        return items;
+    }
+
+    std::vector<T> popAll() { return popBatch(static_cast<size_t>(-1)); }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    size_t capacity() const { return limit; }
+
+    bool isClosed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+
     void close() {
         {
             std::lock_guard<std::mutex> lock(mutex);
             closed = true;
         }
-        cond.notify_all();
+        notEmpty.notify_all();
+        notFull.notify_all();
     }
 };
@@ -0,0 +1,65 @@
+#pragma once
+#include "StructuredClone.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pool of pre-warmed worker interpreters for Worker.pool(script, n).
+// Each member loads the script once, then serves jobs by calling the script's
+// global onJob(data). Arguments and results travel as ClonedMessage. Jobs are
+// spread round-robin over per-member deques and idle members steal from the
+// back of busy members' deques.
+class WorkerPool {
+public:
+    struct Job {
+        ClonedMessage payload;
+        // Runs on the member thread: ok=false carries the error value.
+        std::function<void(bool ok, ClonedMessage result)> done;
+    };
+
+    struct Stats {
+        size_t size;
+        size_t idle;
+        size_t queued;
+        uint64_t completed;
+        uint64_t stolen;
+    };
+
+    WorkerPool(std::string scriptPath, size_t size);
+    ~WorkerPool();
+
+    // Returns false once close() has been called.
+    bool submit(Job job);
+    void close();
+    Stats stats();
+
+private:
+    struct Member {
+        std::deque<Job> jobs;
+        std::mutex mutex;
+    };
+
+    bool take(size_t self, Job &job);
+    void memberLoop(size_t self);
+
+    std::string scriptPath;
+    std::vector<std::unique_ptr<Member>> members;
+    std::vector<std::thread> threads;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    size_t pending = 0;
+    bool closed = false;
+
+    std::atomic<size_t> nextMember{0};
+    std::atomic<size_t> idle{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> stolen{0};
+};
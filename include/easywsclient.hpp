@@ -35,6 +35,8 @@ class WebSocket {
     virtual void sendPing() = 0;
     virtual void close() = 0;
     virtual readyStateValues getReadyState() const = 0;
+    // During a dispatch: whether the message being delivered came in binary frames.
+    virtual bool isBinaryMessage() const { return false; }
 
     template<class Callable>
     void dispatch(Callable callable)
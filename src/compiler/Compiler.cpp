@@ -372,6 +372,7 @@ void Compiler::visitFunctionExpr(FunctionExpr &expr) {}
 void Compiler::visitTemplateLiteralExpr(TemplateLiteral &expr) {}
 void Compiler::visitArrowFunctionExpr(ArrowFunction &expr) {}
 void Compiler::visitAwaitExpr(Await &expr) {}
+void Compiler::visitSpawnExpr(Spawn &expr) {}
 void Compiler::visitConstStmt(Const &stmt) {}
 void Compiler::visitClassStmt(Class &stmt) {}
 void Compiler::visitForStmt(For &stmt) {}
@@ -179,6 +179,7 @@ void TypeChecker::visitFunctionExpr(FunctionExpr &expr) { lastType = "function";
 void TypeChecker::visitTemplateLiteralExpr(TemplateLiteral &expr) { lastType = "string"; }
 void TypeChecker::visitArrowFunctionExpr(ArrowFunction &expr) { lastType = "function"; }
 void TypeChecker::visitAwaitExpr(Await &expr) { expressionType(expr.expression); lastType = "any"; }
+void TypeChecker::visitSpawnExpr(Spawn &expr) { expressionType(expr.call); lastType = "any"; }
 void TypeChecker::visitConstStmt(Const &stmt) { expressionType(stmt.initializer); if (auto v = std::dynamic_pointer_cast<Variable>(stmt.pattern)) define(v->name.lexeme, "any"); }
 void TypeChecker::visitClassStmt(Class &stmt) { define(stmt.name.lexeme, "class"); }
 void TypeChecker::visitForStmt(For &stmt) { stmt.body->accept(*this); }
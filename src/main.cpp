@@ -3,6 +3,7 @@
 */
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -15,6 +16,7 @@
 #include "Parser.hpp"
 #include "Interpreter.hpp"
 #include "TypeChecker.hpp"
+#include "Snapshot.hpp"
 
 namespace fs = std::filesystem;
 
@@ -68,6 +70,67 @@ void runFile(int argc, char *argv[]) {
   interpreter.interpret(statements);
 }
 
+// fsk snapshot app.fsk [-o app.snap]: run the script's initialization (prelude,
+// imports, top level) without the event loop, then save the resulting heap.
+void snapshotFile(int argc, char *argv[]) {
+  std::string path = argv[1];
+  std::string output = std::filesystem::path(path).replace_extension(".snap").string();
+  std::vector<char *> scriptArgs = {argv[0], argv[1]};
+  for (int i = 2; i < argc; i++) {
+    if (std::string(argv[i]) == "-o" && i + 1 < argc) output = argv[++i];
+    else scriptArgs.push_back(argv[i]);
+  }
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Could not open file: " << path << std::endl;
+    exit(1);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+
+  Interpreter interpreter(false);
+  interpreter.setArgs((int)scriptArgs.size(), scriptArgs.data());
+  std::map<std::string, Value> builtins = interpreter.globals->getValues();
+  interpreter.recordSources = true;
+  interpreter.snapshotting = true;
+  interpreter.loadPrelude();
+
+  std::vector<std::shared_ptr<Stmt>> statements = interpreter.parseSource(buffer.str());
+  TypeChecker typeChecker;
+  typeChecker.check(statements);
+  interpreter.interpret(statements, false);
+
+  try {
+    writeSnapshot(interpreter, builtins, output);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    exit(1);
+  }
+  std::cout << "Snapshot written to " << output << std::endl;
+}
+
+// fsk --snapshot app.snap [args]: restore the heap, then call main() if the
+// script defines one and run the event loop.
+void runSnapshot(int argc, char *argv[]) {
+  Interpreter interpreter(false);
+  interpreter.setArgs(argc, argv);
+  try {
+    restoreSnapshot(interpreter, argv[1]);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    exit(1);
+  }
+
+  std::vector<std::shared_ptr<Stmt>> statements;
+  try {
+    if (std::holds_alternative<std::shared_ptr<Callable>>(interpreter.globals->get("main"))) {
+      statements = interpreter.parseSource("main();");
+    }
+  } catch (const std::runtime_error &) {}
+  interpreter.interpret(statements);
+}
+
 
 const char* MINIMAL_HTML_TEMPLATE = R"(<!DOCTYPE html>
 <html>
@@ -336,7 +399,7 @@ void handleWebBuild() {
         }
     }
 
-    std::string cmd = cmdPrefix + "emcc " + srcPrefix + "src/main.cpp " + srcPrefix + "src/lexer/Lexer.cpp " + srcPrefix + "src/parser/Parser.cpp " + srcPrefix + "src/runtime/Interpreter.cpp " + srcPrefix + "src/runtime/Callable.cpp " +
+    std::string cmd = cmdPrefix + "emcc " + srcPrefix + "src/main.cpp " + srcPrefix + "src/lexer/Lexer.cpp " + srcPrefix + "src/parser/Parser.cpp " + srcPrefix + "src/runtime/Interpreter.cpp " + srcPrefix + "src/runtime/Callable.cpp " + srcPrefix + "src/runtime/WorkerPool.cpp " + srcPrefix + "src/runtime/StructuredClone.cpp " + srcPrefix + "src/runtime/SharedBuffer.cpp " + srcPrefix + "src/runtime/FiberScheduler.cpp " + srcPrefix + "src/runtime/Snapshot.cpp " + srcPrefix + "src/runtime/HttpObjects.cpp " +
                       includePrefix + " -std=c++20 -O3 -w "
                       "-s WASM=1 "
                       "-s SINGLE_FILE=1 "
@@ -603,7 +666,286 @@ void handleInstall() {
 }
 #endif
 
+#ifndef __EMSCRIPTEN__
+#include <chrono>
+#include <thread>
+#include "json.hpp"
+#include "HttpCallback.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <sys/wait.h>
+#endif
+
+extern "C" {
+    char* fsk_bench_http(const FskBenchOptions* options);
+    char* fsk_bench_ids(uint32_t threads, uint64_t requests);
+    void fsk_free_string(char* s);
+}
+
+static bool portAccepts(int port) {
+    int s = (int)socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = connect(s, (sockaddr *)&addr, sizeof(addr)) == 0;
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+    return ok;
+}
+
+// The server under test: this same binary running the script, with its output
+// sent to stderr so it doesn't mix with the report.
+struct BenchServer {
+#ifdef _WIN32
+    PROCESS_INFORMATION process{};
+#else
+    pid_t pid = -1;
+#endif
+
+    bool start(const std::vector<std::string> &args) {
+#ifdef _WIN32
+        std::string commandLine;
+        for (const auto &arg : args) commandLine += "\"" + arg + "\" ";
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdOutput = startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        return CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &process);
+#else
+        pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            dup2(2, 1);
+            std::vector<char *> argv;
+            for (const auto &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+            argv.push_back(nullptr);
+            // argv[0] may be a bare "fsk" found through PATH: re-exec this binary.
+#ifdef __linux__
+            execv("/proc/self/exe", argv.data());
+#endif
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        return true;
+#endif
+    }
+
+    bool running() {
+#ifdef _WIN32
+        return WaitForSingleObject(process.hProcess, 0) == WAIT_TIMEOUT;
+#else
+        return pid > 0 && waitpid(pid, nullptr, WNOHANG) == 0;
+#endif
+    }
+
+    void stop() {
+#ifdef _WIN32
+        if (!process.hProcess) return;
+        TerminateProcess(process.hProcess, 0);
+        WaitForSingleObject(process.hProcess, INFINITE);
+        CloseHandle(process.hProcess);
+        CloseHandle(process.hThread);
+        process = {};
+#else
+        if (pid <= 0) return;
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+#endif
+    }
+};
+
+// fsk bench-http [script.fsk [script args]] [options]: starts the script, waits
+// for its port, then replays one request over keep-alive connections and
+// reports requests/s and latency percentiles. Without a script, the server
+// already listening on --port is measured.
+int handleBenchHttp(int argc, char *argv[]) {
+    std::vector<std::string> serverArgs = {argv[0]};
+    int port = 8080, connections = 64;
+    double duration = 10, warmup = 1;
+    std::string method = "GET", path = "/", body, contentType;
+    bool json = false;
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--port" && hasValue) port = std::stoi(argv[++i]);
+            else if ((arg == "--connections" || arg == "-c") && hasValue) connections = std::stoi(argv[++i]);
+            else if ((arg == "--duration" || arg == "-d") && hasValue) duration = std::stod(argv[++i]);
+            else if (arg == "--warmup" && hasValue) warmup = std::stod(argv[++i]);
+            else if ((arg == "--method" || arg == "-X") && hasValue) method = argv[++i];
+            else if (arg == "--path" && hasValue) path = argv[++i];
+            else if (arg == "--content-type" && hasValue) contentType = argv[++i];
+            else if (arg == "--body" && hasValue) {
+                body = argv[++i];
+                // --body @file sends the file's contents.
+                if (body.size() > 1 && body[0] == '@') {
+                    std::ifstream file(body.substr(1), std::ios::binary);
+                    if (!file) {
+                        std::cerr << "Could not open file: " << body.substr(1) << std::endl;
+                        return 1;
+                    }
+                    body.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                }
+                if (method == "GET") method = "POST";
+            }
+            else if (arg == "--json") json = true;
+            else if (arg.rfind("--", 0) == 0) {
+                std::cerr << "Unknown bench-http option: " << arg << std::endl;
+                return 1;
+            }
+            else serverArgs.push_back(arg);
+        }
+    } catch (...) {
+        std::cerr << "Invalid bench-http option value." << std::endl;
+        return 1;
+    }
+    if (!body.empty() && contentType.empty()) {
+        contentType = (body[0] == '{' || body[0] == '[') ? "application/json" : "text/plain";
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    BenchServer server;
+    if (serverArgs.size() > 1) {
+        if (portAccepts(port)) {
+            std::cerr << "Port " << port << " is already in use." << std::endl;
+            return 1;
+        }
+        if (Interpreter::defaultIsolates > 1) {
+            serverArgs.push_back("--isolates");
+            serverArgs.push_back(std::to_string(Interpreter::defaultIsolates));
+        }
+        if (!server.start(serverArgs)) {
+            std::cerr << "Could not start " << serverArgs[1] << std::endl;
+            return 1;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!portAccepts(port)) {
+            if (!server.running() || std::chrono::steady_clock::now() > deadline) {
+                std::cerr << serverArgs[1] << " is not listening on port " << port << "." << std::endl;
+                server.stop();
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    } else if (!portAccepts(port)) {
+        std::cerr << "Nothing is listening on port " << port << "." << std::endl;
+        return 1;
+    }
+
+    if (!json) {
+        std::cout << "Running " << duration << "s test @ http://127.0.0.1:" << port << path << " (" << method << ", "
+                  << connections << " connections, " << warmup << "s warmup)" << std::endl;
+    }
+    FskBenchOptions options{(uint16_t)port, method.c_str(), path.c_str(), contentType.c_str(), body.data(), body.size(),
+                            (uint32_t)std::max(1, connections), (uint64_t)(duration * 1000), (uint64_t)(warmup * 1000)};
+    char *raw = fsk_bench_http(&options);
+    std::string text(raw);
+    fsk_free_string(raw);
+    server.stop();
+
+    if (json) {
+        std::cout << text << std::endl;
+        return 0;
+    }
+    auto report = nlohmann::json::parse(text);
+    auto latency = report["latency_us"];
+    auto ms = [](const nlohmann::json &us) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << us.get<double>() / 1000.0 << "ms";
+        return out.str();
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Requests/sec:  " << report["rps"].get<double>() << std::endl;
+    std::cout << "  Requests:      " << report["requests"].get<uint64_t>() << " (" << report["errors"].get<uint64_t>()
+              << " errors)" << std::endl;
+    std::cout << "  Transfer:      " << report["bytes"].get<double>() / (1024 * 1024) << " MB" << std::endl;
+    std::cout << "  Latency:       p50 " << ms(latency["p50"]) << "  p90 " << ms(latency["p90"]) << "  p99 "
+              << ms(latency["p99"]) << "  p99.9 " << ms(latency["p999"]) << "  max " << ms(latency["max"]) << std::endl;
+    std::cout << "  Status:       ";
+    for (auto &[status, count] : report["status"].items()) std::cout << " " << status << " x" << count.get<uint64_t>();
+    std::cout << std::endl;
+    return report["requests"].get<uint64_t>() > 0 ? 0 : 1;
+}
+
+// fsk bench-ids [-t threads] [-n requests] [--json]: the id allocation and
+// pending-table traffic of every HTTP request, run by several threads at once
+// against the old locked counter and table and against the atomic counter and
+// sharded table the server uses. Without -t, sweeps 1 to 64 threads.
+int handleBenchIds(int argc, char *argv[]) {
+    std::vector<int> threadCounts = {1, 2, 4, 8, 16, 32, 64};
+    long long requests = 4000000;
+    bool json = false;
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if ((arg == "--threads" || arg == "-t") && hasValue) threadCounts = {std::stoi(argv[++i])};
+            else if ((arg == "--requests" || arg == "-n") && hasValue) requests = std::stoll(argv[++i]);
+            else if (arg == "--json") json = true;
+            else {
+                std::cerr << "Unknown bench-ids option: " << arg << std::endl;
+                return 1;
+            }
+        }
+    } catch (...) {
+        std::cerr << "Invalid bench-ids option value." << std::endl;
+        return 1;
+    }
+
+    if (!json) {
+        std::cout << "Id lifecycle (allocate, insert, remove), " << requests << " requests per run, "
+                  << std::thread::hardware_concurrency() << " cores" << std::endl;
+        std::cout << "  threads   locked ns/req   sharded ns/req   speedup" << std::endl;
+    }
+    for (int threads : threadCounts) {
+        char *raw = fsk_bench_ids((uint32_t)std::max(1, threads), (uint64_t)std::max(1LL, requests));
+        std::string text(raw);
+        fsk_free_string(raw);
+        if (json) {
+            std::cout << text << std::endl;
+            continue;
+        }
+        auto report = nlohmann::json::parse(text);
+        double locked = report["locked_ns"].get<double>(), sharded = report["sharded_ns"].get<double>();
+        std::cout << std::fixed << std::setprecision(1) << "  " << std::setw(7) << report["threads"].get<int>()
+                  << std::setw(16) << locked << std::setw(17) << sharded << std::setw(9) << std::setprecision(2)
+                  << locked / sharded << "x" << std::endl;
+    }
+    return 0;
+}
+#endif
+
 int main(int argc, char *argv[]) {
+  // `--isolates N` anywhere on the command line: how many interpreters FSK.listen serves from.
+  std::vector<char *> args;
+  for (int i = 0; i < argc; i++) {
+    if (std::string(argv[i]) == "--isolates" && i + 1 < argc) {
+      try {
+        Interpreter::defaultIsolates = std::stoi(argv[++i]);
+      } catch (...) {
+        std::cerr << "Invalid --isolates value. Using 1." << std::endl;
+      }
+      continue;
+    }
+    args.push_back(argv[i]);
+  }
+  argc = (int)args.size();
+  argv = args.data();
+
   if (argc >= 2) {
     std::string arg = argv[1];
     if (arg == "--version" || arg == "-v") {
@@ -621,15 +963,40 @@ int main(int argc, char *argv[]) {
       std::cout << "  webinit    Initialize a web project" << std::endl;
       std::cout << "  build      Build web project" << std::endl;
       std::cout << "  start      Start web server" << std::endl;
+      std::cout << "  start <file> [--isolates N]  Serve a Fsk app from N interpreters" << std::endl;
+      std::cout << "  bench-http [file] [--port N] [--path P] [--method M] [--body B|@file] [-c N] [-d secs] [--warmup secs] [--json]" << std::endl;
+      std::cout << "             Load a Fsk server on localhost; report requests/s and p50/p99/p99.9 latency" << std::endl;
+      std::cout << "  bench-ids [-t threads] [-n requests] [--json]" << std::endl;
+      std::cout << "             Contention of the server's request-id tables: locked vs sharded" << std::endl;
+      std::cout << "  snapshot <file> [-o out.snap]  Save the heap after the script's initialization" << std::endl;
+      std::cout << "  --snapshot <file.snap>        Start from a snapshot, then call main()" << std::endl;
       std::cout << "  <file>     Run Fsk script" << std::endl;
       return 0;
     }
     
+    if (arg == "snapshot" && argc >= 3) {
+      snapshotFile(argc - 1, argv + 1);
+      return 0;
+    }
+    if (arg == "--snapshot" && argc >= 3) {
+      // Keep argv[0] so FSK.arg(0) is still the binary.
+      std::vector<char *> snapArgs = {argv[0]};
+      for (int i = 2; i < argc; i++) snapArgs.push_back(argv[i]);
+      runSnapshot((int)snapArgs.size(), snapArgs.data());
+      return 0;
+    }
+
 #ifndef __EMSCRIPTEN__
     if (arg == "install") { handleInstall(); return 0; }
     if (arg == "webinit") { handleWebInit(); return 0; }
     if (arg == "build") { handleWebBuild(); return 0; }
+    if (arg == "bench-http") return handleBenchHttp(argc, argv);
+    if (arg == "bench-ids") return handleBenchIds(argc, argv);
     if (arg == "start") { 
+        if (argc >= 3 && std::string(argv[2]).ends_with(".fsk")) {
+            runFile(argc - 1, argv + 1);
+            return 0;
+        }
         int port = 8080;
         if (argc >= 3) {
             try {
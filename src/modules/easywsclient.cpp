@@ -141,6 +141,7 @@ class _RealWebSocket : public easywsclient::WebSocket
     std::vector<uint8_t> rxbuf;
     std::vector<uint8_t> txbuf;
     std::vector<uint8_t> receivedData;
+    bool receivedBinary = false;
 
     socket_t sockfd;
     readyStateValues readyState;
@@ -184,6 +185,10 @@ class _RealWebSocket : public easywsclient::WebSocket
       return readyState;
     }
 
+    bool isBinaryMessage() const {
+      return receivedBinary;
+    }
+
     void poll(int timeout) { 
         if (readyState == CLOSED) {
             if (timeout > 0) {
@@ -332,6 +337,7 @@ class _RealWebSocket : public easywsclient::WebSocket
                 || ws.opcode == wsheader_type::CONTINUATION
             ) {
                 if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { rxbuf[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
+                if (ws.opcode != wsheader_type::CONTINUATION) receivedBinary = ws.opcode == wsheader_type::BINARY_FRAME;
                 receivedData.insert(receivedData.end(), rxbuf.begin()+ws.header_size, rxbuf.begin()+ws.header_size+(size_t)ws.N);
                 if (ws.fin) {
                     callable((const std::vector<uint8_t>) receivedData);
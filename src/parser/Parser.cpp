@@ -85,8 +85,14 @@ std::shared_ptr<Stmt> Parser::function(std::string kind, bool isAsync) {
 
   consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body.");
   std::vector<std::shared_ptr<Stmt>> body = block();
-  return std::make_shared<Function>(name, parameters, body, isAsync,
-                                    returnType);
+  return declare(std::make_shared<Function>(name, parameters, body, isAsync,
+                                            returnType));
+}
+
+std::shared_ptr<Function> Parser::declare(std::shared_ptr<Function> function) {
+  function->id = (int)functions.size();
+  functions.push_back(function);
+  return function;
 }
 
 std::shared_ptr<Stmt> Parser::varDeclaration() {
@@ -454,6 +460,15 @@ std::shared_ptr<Expr> Parser::unary() {
     return std::make_shared<Await>(keyword, expression);
   }
 
+  if (match({TokenType::SPAWN})) {
+    Token keyword = previous();
+    auto call = std::dynamic_pointer_cast<Call>(this->call());
+    if (!call) {
+      throw std::runtime_error("Expect a function call after 'spawn' at line " + std::to_string(keyword.line));
+    }
+    return std::make_shared<Spawn>(keyword, call);
+  }
+
   return call();
 }
 
@@ -464,8 +479,10 @@ std::shared_ptr<Expr> Parser::call() {
       expr = finishCall(expr);
     } else if (match({TokenType::DOT, TokenType::QUESTION_DOT})) {
       bool isOptional = previous().type == TokenType::QUESTION_DOT;
-      Token name =
-          consume(TokenType::IDENTIFIER, "Expect property name after member access.");
+      // 'catch' is a keyword but also a valid member name (promise.catch).
+      Token name = check(TokenType::CATCH)
+          ? advance()
+          : consume(TokenType::IDENTIFIER, "Expect property name after member access.");
       expr = std::make_shared<Get>(expr, name, isOptional);
     } else if (match({TokenType::LEFT_BRACKET})) {
       std::shared_ptr<Expr> index = expression();
@@ -556,7 +573,9 @@ std::shared_ptr<Expr> Parser::primary() {
         Token returnKeyword(TokenType::RETURN, "return", std::monostate{}, previous().line);
         body.push_back(std::make_shared<Return>(returnKeyword, expression()));
       }
-      return std::make_shared<ArrowFunction>(parameters, body, isExpressionBody);
+      auto arrow = std::make_shared<ArrowFunction>(parameters, body, isExpressionBody);
+      arrow->function = declare(std::make_shared<Function>(Token(TokenType::IDENTIFIER, "", std::monostate{}, 0), parameters, body, false));
+      return arrow;
     }
     return std::make_shared<Variable>(name);
   }
@@ -581,7 +600,9 @@ std::shared_ptr<Expr> Parser::primary() {
     consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
     consume(TokenType::LEFT_BRACE, "Expect '{' before lambda body.");
     std::vector<std::shared_ptr<Stmt>> body = block();
-    return std::make_shared<FunctionExpr>(parameters, body);
+    auto lambda = std::make_shared<FunctionExpr>(parameters, body);
+    lambda->function = declare(std::make_shared<Function>(Token(TokenType::IDENTIFIER, "", std::monostate{}, 0), parameters, body, false));
+    return lambda;
   }
 
   if (match({TokenType::LEFT_BRACE})) {
@@ -657,7 +678,9 @@ std::shared_ptr<Expr> Parser::primary() {
         Token returnKeyword(TokenType::RETURN, "return", std::monostate{}, previous().line);
         body.push_back(std::make_shared<Return>(returnKeyword, expression()));
       }
-      return std::make_shared<ArrowFunction>(parameters, body, isExpressionBody);
+      auto arrow = std::make_shared<ArrowFunction>(parameters, body, isExpressionBody);
+      arrow->function = declare(std::make_shared<Function>(Token(TokenType::IDENTIFIER, "", std::monostate{}, 0), parameters, body, false));
+      return arrow;
     }
   }
 
@@ -104,4 +104,133 @@ Value FunctionCallable::call(Interpreter &interpreter, std::vector<Value> argume
         return returnValue.value;
     }
     return Value(std::monostate{});
-}
\ No newline at end of file
+}
+void FSKPromise::resolve(Interpreter &interpreter, Value result) {
+  if (state != State::Pending)
+    return;
+
+  if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&result)) {
+    if (auto other = std::dynamic_pointer_cast<FSKPromise>(*inst)) {
+      if (other.get() == this) {
+        settle(interpreter, State::Rejected,
+               Value(std::string("Promise cannot resolve to itself.")));
+        return;
+      }
+      // Adopt the other promise's outcome once it settles.
+      auto self = std::static_pointer_cast<FSKPromise>(shared_from_this());
+      other->addReaction(interpreter, {nullptr, nullptr, nullptr, self});
+      return;
+    }
+  }
+  settle(interpreter, State::Fulfilled, result);
+}
+
+void FSKPromise::reject(Interpreter &interpreter, Value reason) {
+  if (state != State::Pending)
+    return;
+  settle(interpreter, State::Rejected, reason);
+}
+
+void FSKPromise::settle(Interpreter &interpreter, State newState, Value result) {
+  state = newState;
+  value = result;
+  std::vector<Reaction> pending;
+  pending.swap(reactions);
+  for (auto &reaction : pending) {
+    schedule(interpreter, std::move(reaction));
+  }
+}
+
+void FSKPromise::addReaction(Interpreter &interpreter, Reaction reaction) {
+  if (state == State::Pending) {
+    reactions.push_back(std::move(reaction));
+  } else {
+    schedule(interpreter, std::move(reaction));
+  }
+}
+
+std::shared_ptr<FSKPromise> FSKPromise::then(Interpreter &interpreter,
+                                             std::shared_ptr<Callable> onFulfilled,
+                                             std::shared_ptr<Callable> onRejected,
+                                             std::shared_ptr<Callable> onFinally) {
+  auto derived = std::make_shared<FSKPromise>(klass);
+  addReaction(interpreter, {onFulfilled, onRejected, onFinally, derived});
+  return derived;
+}
+
+void FSKPromise::schedule(Interpreter &interpreter, Reaction reaction) {
+  auto self = std::static_pointer_cast<FSKPromise>(shared_from_this());
+  interpreter.eventLoop->queueMicrotask([&interpreter, self, reaction]() {
+    bool fulfilled = self->state == State::Fulfilled;
+    auto derived = reaction.derived;
+    try {
+      if (reaction.onFinally) {
+        reaction.onFinally->call(interpreter, {});
+      } else {
+        auto handler = fulfilled ? reaction.onFulfilled : reaction.onRejected;
+        if (handler) {
+          Value result = handler->call(interpreter, {self->value});
+          if (derived)
+            derived->resolve(interpreter, result);
+          return;
+        }
+      }
+      // No handler (or finally): pass the outcome through unchanged.
+      if (derived) {
+        if (fulfilled)
+          derived->resolve(interpreter, self->value);
+        else
+          derived->reject(interpreter, self->value);
+      }
+    } catch (FSKException &error) {
+      if (derived)
+        derived->reject(interpreter, error.value);
+    } catch (const std::runtime_error &error) {
+      if (derived)
+        derived->reject(interpreter, Value(std::string(error.what())));
+    }
+  });
+}
+
+Value FSKPromise::wait(Interpreter &interpreter) {
+  while (state == State::Pending) {
+    if (!interpreter.eventLoop->processOne(true)) {
+      break;
+    }
+  }
+
+  if (state == State::Rejected) {
+    throw std::runtime_error("Promise rejected: " + Interpreter::stringify(value));
+  }
+  return value;
+}
+
+Value FSKPromiseClass::call(Interpreter &interpreter, std::vector<Value> arguments) {
+  auto promise = std::make_shared<FSKPromise>(
+      std::static_pointer_cast<FSKClass>(shared_from_this()));
+
+  if (!arguments.empty() && std::holds_alternative<std::shared_ptr<Callable>>(arguments[0])) {
+    auto executor = std::get<std::shared_ptr<Callable>>(arguments[0]);
+
+    auto resolveFn = std::make_shared<NativeFunction>(
+        -1, [promise](Interpreter &interp, std::vector<Value> args) -> Value {
+          promise->resolve(interp, args.empty() ? Value(std::monostate{}) : args[0]);
+          return Value(std::monostate{});
+        });
+    auto rejectFn = std::make_shared<NativeFunction>(
+        -1, [promise](Interpreter &interp, std::vector<Value> args) -> Value {
+          promise->reject(interp, args.empty() ? Value(std::monostate{}) : args[0]);
+          return Value(std::monostate{});
+        });
+
+    try {
+      executor->call(interpreter, {Value(std::static_pointer_cast<Callable>(resolveFn)),
+                                   Value(std::static_pointer_cast<Callable>(rejectFn))});
+    } catch (FSKException &error) {
+      promise->reject(interpreter, error.value);
+    } catch (const std::runtime_error &error) {
+      promise->reject(interpreter, Value(std::string(error.what())));
+    }
+  }
+  return Value(std::static_pointer_cast<FSKInstance>(promise));
+}
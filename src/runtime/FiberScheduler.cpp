@@ -0,0 +1,513 @@
+#include "FiberScheduler.hpp"
+#include "Interpreter.hpp"
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define FSK_FIBER_CONTEXTS 1
+#elif !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#define FSK_FIBER_CONTEXTS 1
+#else
+#define FSK_FIBER_CONTEXTS 0
+#endif
+
+#if FSK_FIBER_CONTEXTS && !defined(_MSC_VER)
+#include <cxxabi.h>
+// The Itanium C++ ABI keeps the exceptions being handled in a per-thread list
+// (__cxa_eh_globals). A fiber switched out inside a catch block takes its part
+// of that list along, so another fiber's catch on the same thread cannot unwind it.
+struct EhState {
+    void *caught = nullptr;
+    unsigned int uncaught = 0;
+};
+static void swapEhState(EhState &saved) {
+    std::swap(*reinterpret_cast<EhState *>(abi::__cxa_get_globals()), saved);
+}
+#else
+struct EhState {};
+static void swapEhState(EhState &) {}
+#endif
+
+static const size_t fiberStackSize = 8 * 1024 * 1024;
+
+#if defined(_WIN32)
+static thread_local void *loopContext = nullptr; // the scheduler loop, as a Windows fiber
+#elif FSK_FIBER_CONTEXTS
+static thread_local ucontext_t loopContext;
+#endif
+
+// A started fiber. Runs on its own stack; while switched out it keeps the
+// interpreter state (scope, call stack, exceptions in flight) it left off with.
+struct FiberTask : std::enable_shared_from_this<FiberTask> {
+    FiberScheduler *scheduler = nullptr;
+    size_t worker = 0; // the thread it started on, and resumes on
+    FiberScheduler::Fiber fiber;
+    bool finished = false;
+
+    std::shared_ptr<Environment> environment;
+    std::vector<std::string> callStack;
+    Value lastValue;
+    EhState eh;
+
+#if defined(_WIN32)
+    void *context = nullptr;
+#elif FSK_FIBER_CONTEXTS
+    ucontext_t context;
+    void *stack = nullptr;
+#endif
+
+    ~FiberTask() {
+#if defined(_WIN32)
+        if (context) DeleteFiber(context);
+#elif FSK_FIBER_CONTEXTS
+        if (stack) munmap(stack, fiberStackSize);
+#endif
+    }
+
+    // Sets up the stack and the context that starts in main(). False if the
+    // system refused the memory.
+    bool allocate();
+    static void main();
+
+    void switchIn() {
+        swapInterpreterState();
+        swapEhState(eh);
+        FiberScheduler::currentTask = this;
+#if defined(_WIN32)
+        SwitchToFiber(context);
+#elif FSK_FIBER_CONTEXTS
+        swapcontext(&loopContext, &context);
+#endif
+        FiberScheduler::currentTask = nullptr;
+        swapEhState(eh);
+        swapInterpreterState();
+    }
+
+    void switchOut() {
+#if defined(_WIN32)
+        SwitchToFiber(loopContext);
+#elif FSK_FIBER_CONTEXTS
+        swapcontext(&context, &loopContext);
+#endif
+    }
+
+    void swapInterpreterState() {
+        Interpreter &interp = *FiberScheduler::currentInterpreter;
+        std::swap(interp.environment, environment);
+        std::swap(interp.callStack, callStack);
+        std::swap(interp.lastValue, lastValue);
+    }
+};
+
+#if defined(_WIN32)
+static void CALLBACK fiberEntry(void *) { FiberTask::main(); }
+
+bool FiberTask::allocate() {
+    context = CreateFiberEx(0, fiberStackSize, FIBER_FLAG_FLOAT_SWITCH, fiberEntry, nullptr);
+    return context != nullptr;
+}
+#elif FSK_FIBER_CONTEXTS
+bool FiberTask::allocate() {
+    // Reserved, not committed: pages are only backed once the fiber touches them.
+    stack = mmap(nullptr, fiberStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (stack == MAP_FAILED) {
+        stack = nullptr;
+        return false;
+    }
+    // Guard page at the low end: an overflow faults instead of running into other memory.
+    mprotect(stack, (size_t)sysconf(_SC_PAGESIZE), PROT_NONE);
+    getcontext(&context);
+    context.uc_stack.ss_sp = stack;
+    context.uc_stack.ss_size = fiberStackSize;
+    context.uc_link = nullptr;
+    makecontext(&context, &FiberTask::main, 0);
+    return true;
+}
+#endif
+
+void FiberTask::main() {
+    FiberTask *task = FiberScheduler::currentTask;
+    task->scheduler->run(task->fiber);
+    task->finished = true;
+    task->switchOut(); // for good: a finished task is never switched back in
+}
+
+void FiberWaitList::waitUntil(const std::function<bool()> &ready) {
+    auto fiber = FiberScheduler::current();
+    while (true) {
+        uint64_t seen;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            seen = version;
+        }
+        if (ready()) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        if (version != seen) continue; // changed while we looked: look again
+        if (fiber) {
+            fibers.push_back(fiber);
+            lock.unlock();
+            FiberScheduler::suspend();
+        } else {
+            cv.wait(lock, [&] { return version != seen; });
+        }
+    }
+}
+
+void FiberWaitList::notifyAll() {
+    std::vector<std::shared_ptr<FiberTask>> woken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        version++;
+        woken.swap(fibers);
+    }
+    cv.notify_all();
+    for (auto &fiber : woken) FiberScheduler::resume(std::move(fiber));
+}
+
+void FiberState::finish(bool ok, ClonedMessage result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->ok = ok;
+        this->result = std::move(result);
+        done = true;
+    }
+    joiners.notifyAll();
+}
+
+bool FiberState::isDone() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done;
+}
+
+void FiberState::wait() {
+    if (isDone()) return;
+    // Still queued: run it here rather than wait for it.
+    if (FiberScheduler::runQueued(this)) return;
+    joiners.waitUntil([this] { return isDone(); });
+}
+
+FiberScheduler &FiberScheduler::shared() {
+    // Leaked on purpose: scheduler threads run until process exit.
+    static FiberScheduler *scheduler = [] {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        if (const char *env = std::getenv("FSK_FIBER_THREADS")) {
+            int n = std::atoi(env);
+            if (n > 0) threads = (size_t)n;
+        }
+        return new FiberScheduler(threads);
+    }();
+    return *scheduler;
+}
+
+FiberScheduler::FiberScheduler(size_t threads) {
+    for (size_t i = 0; i < threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        std::thread([this, i]() { workerLoop(i); }).detach();
+    }
+}
+
+void FiberScheduler::spawn(Fiber fiber) {
+    // A fiber spawning fibers keeps them local; others are spread round-robin.
+    size_t target = currentScheduler == this ? currentWorker : nextWorker++ % workers.size();
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex);
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->fibers.push_back(std::move(fiber));
+        pending++;
+    }
+    spawned++;
+    wake.notify_one();
+}
+
+FiberScheduler::Stats FiberScheduler::stats() {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    return {workers.size(), suspended, pending, spawned.load(), completed.load(), stolen.load()};
+}
+
+bool FiberScheduler::runQueued(const FiberState *state) {
+    FiberScheduler *self = currentScheduler;
+    if (!self) return false;
+    Fiber fiber;
+    bool found = false;
+    // Our own deque first, newest end first: that is where a fresh child sits.
+    for (size_t offset = 0; !found && offset < self->workers.size(); offset++) {
+        auto &worker = *self->workers[(currentWorker + offset) % self->workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        for (auto it = worker.fibers.rbegin(); it != worker.fibers.rend(); ++it) {
+            if (it->state.get() == state) {
+                fiber = std::move(*it);
+                worker.fibers.erase(std::next(it).base());
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found) return false;
+    {
+        std::lock_guard<std::mutex> lock(self->wakeMutex);
+        self->pending--;
+    }
+    self->run(fiber);
+    return true;
+}
+
+std::shared_ptr<FiberTask> FiberScheduler::current() {
+    return currentTask ? currentTask->shared_from_this() : nullptr;
+}
+
+void FiberScheduler::suspend() {
+    FiberTask *task = currentTask;
+    {
+        std::lock_guard<std::mutex> lock(task->scheduler->wakeMutex);
+        task->scheduler->suspended++;
+    }
+    task->switchOut();
+}
+
+// Back onto the deque of the thread it started on: its stack and interpreter are there.
+void FiberScheduler::resume(std::shared_ptr<FiberTask> task) {
+    FiberScheduler *self = task->scheduler;
+    {
+        std::lock_guard<std::mutex> lock(self->wakeMutex);
+        self->workers[task->worker]->resumed.push_back(std::move(task));
+    }
+    self->wake.notify_all();
+}
+
+// Own fibers come off the back (newest, still hot in cache); stolen ones off the
+// front of the victim's deque, where the oldest and usually largest work sits.
+bool FiberScheduler::take(size_t self, Fiber &fiber) {
+    bool found = false;
+    {
+        auto &own = *workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.fibers.empty()) {
+            fiber = std::move(own.fibers.back());
+            own.fibers.pop_back();
+            found = true;
+        }
+    }
+    for (size_t offset = 1; !found && offset < workers.size(); offset++) {
+        auto &victim = *workers[(self + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.fibers.empty()) {
+            fiber = std::move(victim.fibers.front());
+            victim.fibers.pop_front();
+            stolen++;
+            found = true;
+        }
+    }
+    if (!found) return false;
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    pending--;
+    return true;
+}
+
+void FiberScheduler::run(Fiber &fiber) {
+    Interpreter &interp = *currentInterpreter;
+    if (fiber.functions && fiber.functions != currentBound) {
+        for (auto &[name, declaration] : *fiber.functions) {
+            interp.globals->define(name, Value(std::static_pointer_cast<Callable>(
+                                             std::make_shared<FunctionCallable>(declaration, interp.globals))));
+        }
+        currentBound = fiber.functions;
+    }
+
+    bool ok = false;
+    Value result;
+    size_t depth = interp.callStack.size();
+    try {
+        std::vector<Value> arguments;
+        Value args = fiber.args.toValue();
+        if (auto arr = std::get_if<std::shared_ptr<FSKArray>>(&args)) arguments = (*arr)->elements;
+        // The spawner's captured values, as copies: top-level ones in a scope over
+        // globals, with the top-level functions that may read them bound on top...
+        auto closure = interp.globals;
+        if (!fiber.globals.empty()) {
+            closure = std::make_shared<Environment>(interp.globals);
+            for (auto &[name, value] : fiber.globals) closure->define(name, value.toValue());
+            for (auto &[name, declaration] : fiber.helpers) {
+                closure->define(name, Value(std::static_pointer_cast<Callable>(std::make_shared<FunctionCallable>(declaration, closure))));
+            }
+        }
+        // ...and locals in a scope of their own.
+        if (!fiber.captures.empty() || !fiber.closures.empty()) {
+            closure = std::make_shared<Environment>(closure);
+            for (auto &[name, value] : fiber.captures) closure->define(name, value.toValue());
+            for (auto &[name, declaration] : fiber.closures) {
+                closure->define(name, Value(std::static_pointer_cast<Callable>(std::make_shared<FunctionCallable>(declaration, closure))));
+            }
+        }
+        FunctionCallable callable(fiber.function, closure);
+        result = callable.call(interp, arguments);
+        if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&result)) {
+            if (auto promise = std::dynamic_pointer_cast<FSKPromise>(*inst)) {
+                result = promise->wait(interp);
+            }
+        }
+        ok = true;
+    } catch (const FSKException &e) {
+        result = e.value;
+    } catch (const std::runtime_error &e) {
+        result = Value(std::string(e.what()));
+    }
+    interp.callStack.resize(depth);
+
+    ClonedMessage reply;
+    try {
+        reply = ClonedMessage::fromValue(std::move(result));
+    } catch (const std::runtime_error &e) {
+        ok = false;
+        reply = ClonedMessage::fromValue(Value(std::string(e.what())));
+    }
+    completed++;
+    fiber.state->finish(ok, std::move(reply));
+}
+
+// Runs a fresh fiber on a stack of its own, or (web build) right here.
+void FiberScheduler::start(Fiber fiber) {
+#if FSK_FIBER_CONTEXTS
+    auto task = std::make_shared<FiberTask>();
+    if (!task->allocate()) {
+        completed++;
+        fiber.state->finish(false, ClonedMessage::fromValue(Value(std::string("spawn : mémoire insuffisante pour la pile de la fibre."))));
+        return;
+    }
+    task->scheduler = this;
+    task->worker = currentWorker;
+    task->fiber = std::move(fiber);
+    task->environment = currentInterpreter->globals;
+    task->switchIn();
+#else
+    run(fiber);
+#endif
+}
+
+void FiberScheduler::workerLoop(size_t self) {
+    currentScheduler = this;
+    currentWorker = self;
+    Interpreter interp;
+    currentInterpreter = &interp;
+#if defined(_WIN32)
+    loopContext = ConvertThreadToFiber(nullptr);
+#endif
+
+    while (true) {
+        std::shared_ptr<FiberTask> task;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            auto &resumed = workers[self]->resumed;
+            wake.wait(lock, [&] { return pending > 0 || !resumed.empty(); });
+            // Woken fibers before new ones: they already hold a stack.
+            if (!resumed.empty()) {
+                task = std::move(resumed.front());
+                resumed.pop_front();
+                suspended--;
+            }
+        }
+        if (task) {
+            task->switchIn();
+            continue;
+        }
+        Fiber fiber;
+        if (take(self, fiber)) start(std::move(fiber));
+    }
+}
+
+bool ChannelState::send(ClonedMessage message) {
+    bool sent = false;
+    waiters.waitUntil([&] {
+        if (queue.tryPush(message)) return sent = true;
+        return queue.isClosed();
+    });
+    if (sent) waiters.notifyAll();
+    return sent;
+}
+
+std::optional<ClonedMessage> ChannelState::recv() {
+    std::optional<ClonedMessage> message;
+    waiters.waitUntil([&] {
+        if ((message = queue.pop(false))) return true;
+        if (!queue.isClosed()) return false;
+        message = queue.pop(false); // a send may have landed just before the close
+        return true;
+    });
+    if (message) waiters.notifyAll();
+    return message;
+}
+
+std::optional<ClonedMessage> ChannelState::tryRecv() {
+    auto message = queue.pop(false);
+    if (message) waiters.notifyAll();
+    return message;
+}
+
+void ChannelState::close() {
+    queue.close();
+    waiters.notifyAll();
+}
+
+static Value joinFiber(std::shared_ptr<FSKInstance> self) {
+    auto handle = std::dynamic_pointer_cast<FSKFiberHandle>(self);
+    if (!handle) throw std::runtime_error("Méthode Fiber appelée sur un autre objet.");
+    if (!handle->joined) {
+        handle->state->wait();
+        handle->result = handle->state->result.toValue();
+        handle->joined = true;
+    }
+    if (!handle->state->ok) throw FSKException(handle->result);
+    return handle->result;
+}
+
+std::shared_ptr<FSKFiberHandle> makeFiberHandle(std::shared_ptr<FiberState> state) {
+    static auto klass = std::make_shared<FSKClass>("Fiber", nullptr, std::map<std::string, std::shared_ptr<Callable>>{
+        {"join", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            return joinFiber(self);
+        }), nullptr))},
+        // `await spawn f()` goes through wait().
+        {"wait", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            return joinFiber(self);
+        }), nullptr))},
+        {"done", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            auto handle = std::dynamic_pointer_cast<FSKFiberHandle>(self);
+            return Value(handle && handle->state->isDone());
+        }), nullptr))},
+    });
+    return std::make_shared<FSKFiberHandle>(klass, state);
+}
+
+static std::shared_ptr<ChannelState> channelOf(std::shared_ptr<FSKInstance> self) {
+    auto channel = std::dynamic_pointer_cast<FSKChannel>(self);
+    if (!channel) throw std::runtime_error("Méthode Channel appelée sur un autre objet.");
+    return channel->channel;
+}
+
+std::shared_ptr<FSKChannel> makeChannel(std::shared_ptr<ChannelState> channel) {
+    static auto klass = std::make_shared<FSKClass>("Channel", nullptr, std::map<std::string, std::shared_ptr<Callable>>{
+        {"send", std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            return Value(channelOf(self)->send(ClonedMessage::fromValue(args[0])));
+        }), nullptr))},
+        {"recv", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            auto message = channelOf(self)->recv();
+            return message ? message->toValue() : Value(std::monostate{});
+        }), nullptr))},
+        {"tryRecv", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            auto message = channelOf(self)->tryRecv();
+            return message ? message->toValue() : Value(std::monostate{});
+        }), nullptr))},
+        {"close", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            channelOf(self)->close();
+            return Value(std::monostate{});
+        }), nullptr))},
+        {"size", std::shared_ptr<NativeFunction>(new NativeFunction(0, NativeMethodCallback([](Interpreter &, std::vector<Value>, std::shared_ptr<FSKInstance> self) -> Value {
+            return Value((double)channelOf(self)->queue.size());
+        }), nullptr))},
+    });
+    return std::make_shared<FSKChannel>(klass, channel);
+}
@@ -0,0 +1,313 @@
+#include "HttpClient.hpp"
+#ifndef __EMSCRIPTEN__
+#include <algorithm>
+#include <cctype>
+
+static size_t appendBody(char *data, size_t size, size_t count, void *transfer) {
+    static_cast<HttpClient::Transfer *>(transfer)->response.body.append(data, size * count);
+    return size * count;
+}
+
+static size_t appendHeader(char *data, size_t size, size_t count, void *transfer) {
+    auto &response = static_cast<HttpClient::Transfer *>(transfer)->response;
+    std::string line(data, size * count);
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+    if (line.rfind("HTTP/", 0) == 0) {
+        // A new status line (redirect, 100 Continue): only the last response counts.
+        response.headers.clear();
+        return size * count;
+    }
+    auto colon = line.find(':');
+    if (colon == std::string::npos) return size * count;
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    size_t start = line.find_first_not_of(" \t", colon + 1);
+    response.headers.emplace_back(std::move(name), start == std::string::npos ? "" : line.substr(start));
+    return size * count;
+}
+
+HttpClient::HttpClient() : HttpClient(Options()) {}
+
+HttpClient::HttpClient(Options options) : settings(options) {
+    static std::once_flag globalInit;
+    std::call_once(globalInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &HttpClient::lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &HttpClient::unlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+HttpClient::~HttpClient() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    if (ioThread.joinable()) {
+        curl_multi_wakeup(multi);
+        ioThread.join();
+        curl_multi_cleanup(multi);
+    }
+    for (CURL *handle : idle) curl_easy_cleanup(handle);
+    curl_share_cleanup(share);
+}
+
+void HttpClient::lockShare(CURL *, curl_lock_data data, curl_lock_access, void *client) {
+    static_cast<HttpClient *>(client)->shareLocks[data].lock();
+}
+
+void HttpClient::unlockShare(CURL *, curl_lock_data data, void *client) {
+    static_cast<HttpClient *>(client)->shareLocks[data].unlock();
+}
+
+void HttpClient::configure(const Options &options) {
+    std::lock_guard<std::mutex> lock(mutex);
+    settings = options;
+    while ((long)idle.size() > settings.maxIdle) {
+        curl_easy_cleanup(idle.back());
+        idle.pop_back();
+    }
+    slotFree.notify_all();
+    if (multi) curl_multi_wakeup(multi);
+}
+
+HttpClient::Options HttpClient::options() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings;
+}
+
+HttpClient::Stats HttpClient::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats snapshot = counters;
+    snapshot.idle = idle.size();
+    return snapshot;
+}
+
+std::string HttpClient::hostOf(const std::string &url) {
+    std::string host;
+    CURLU *parsed = curl_url();
+    if (curl_url_set(parsed, CURLUPART_URL, url.c_str(), CURLU_DEFAULT_SCHEME) == CURLUE_OK) {
+        char *scheme = nullptr, *name = nullptr, *port = nullptr;
+        curl_url_get(parsed, CURLUPART_SCHEME, &scheme, 0);
+        curl_url_get(parsed, CURLUPART_HOST, &name, 0);
+        curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT);
+        if (scheme && name) host = std::string(scheme) + "://" + name + ":" + (port ? port : "");
+        curl_free(scheme);
+        curl_free(name);
+        curl_free(port);
+    }
+    curl_url_cleanup(parsed);
+    return host.empty() ? url : host;
+}
+
+void HttpClient::acquireSlot(const std::string &host) {
+    std::unique_lock<std::mutex> lock(mutex);
+    slotFree.wait(lock, [&] { return settings.maxPerHost <= 0 || inFlight[host] < settings.maxPerHost; });
+    inFlight[host]++;
+}
+
+bool HttpClient::tryAcquireSlot(const std::string &host) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (settings.maxPerHost > 0 && inFlight[host] >= settings.maxPerHost) return false;
+    inFlight[host]++;
+    return true;
+}
+
+void HttpClient::releaseSlot(const std::string &host) {
+    CURLM *waiting = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--inFlight[host] <= 0) inFlight.erase(host);
+        waiting = multi;
+    }
+    slotFree.notify_all();
+    // Async requests queued for this host are on the I/O thread, asleep in curl_multi_poll.
+    if (waiting) curl_multi_wakeup(waiting);
+}
+
+CURL *HttpClient::begin(Transfer &transfer) {
+    Options options;
+    CURL *handle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        options = settings;
+        if (options.keepAlive && !idle.empty()) {
+            handle = idle.back();
+            idle.pop_back();
+        }
+    }
+    if (handle) {
+        // Forgets the previous request's options; the share and its connections stay.
+        curl_easy_reset(handle);
+    } else {
+        handle = curl_easy_init();
+        if (!handle) return nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.handles++;
+    }
+
+    const Request &request = transfer.request;
+    curl_easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, "FSK-Language/1.0");
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, request.timeoutMs > 0 ? request.timeoutMs : options.timeoutMs);
+    curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, transfer.errorBuffer);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &appendBody);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &appendHeader);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer);
+    if (options.keepAlive) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share);
+        curl_easy_setopt(handle, CURLOPT_MAXCONNECTS, options.maxIdle);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    } else {
+        curl_easy_setopt(handle, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(handle, CURLOPT_FORBID_REUSE, 1L);
+    }
+
+    if (request.method == "GET") {
+        curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+    } else if (request.method == "HEAD") {
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+    } else {
+        if (request.method != "POST") curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+        if (request.method == "POST" || !request.body.empty()) {
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request.body.size());
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request.body.data());
+        }
+    }
+
+    curl_slist_free_all(transfer.headerList);
+    transfer.headerList = nullptr;
+    for (const auto &[name, value] : request.headers) {
+        transfer.headerList = curl_slist_append(transfer.headerList, (name + ": " + value).c_str());
+    }
+    if (transfer.headerList) curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer.headerList);
+    return handle;
+}
+
+void HttpClient::finish(CURL *handle, Transfer &transfer, CURLcode code) {
+    auto &response = transfer.response;
+    long connects = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    response.ok = code == CURLE_OK;
+    if (!response.ok) response.error = transfer.errorBuffer[0] ? transfer.errorBuffer : curl_easy_strerror(code);
+    curl_slist_free_all(transfer.headerList);
+    transfer.headerList = nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.requests++;
+    if (!response.ok) counters.failures++;
+    counters.connections += connects;
+    if (settings.keepAlive && (long)idle.size() < settings.maxIdle) {
+        idle.push_back(handle);
+    } else {
+        curl_easy_cleanup(handle);
+    }
+}
+
+HttpClient::Response HttpClient::perform(Request request) {
+    Transfer transfer;
+    transfer.request = std::move(request);
+    std::string host = hostOf(transfer.request.url);
+    acquireSlot(host);
+    CURL *handle = begin(transfer);
+    if (!handle) {
+        releaseSlot(host);
+        transfer.response.error = "curl_easy_init failed";
+        return transfer.response;
+    }
+    CURLcode code = curl_easy_perform(handle);
+    finish(handle, transfer, code);
+    releaseSlot(host);
+    return std::move(transfer.response);
+}
+
+void HttpClient::submit(Request request, Completion done) {
+    auto async = std::make_unique<Async>();
+    async->host = hostOf(request.url);
+    async->transfer.request = std::move(request);
+    async->done = std::move(done);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ioThread.joinable()) {
+        multi = curl_multi_init();
+        curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, settings.maxIdle);
+        ioThread = std::thread([this] { ioLoop(); });
+    }
+    submitted.push_back(std::move(async));
+    counters.pending++;
+    curl_multi_wakeup(multi);
+}
+
+void HttpClient::ioLoop() {
+    std::map<CURL *, std::unique_ptr<Async>> running;
+    std::vector<std::unique_ptr<Async>> waiting; // host at maxPerHost
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) break;
+            for (auto &async : submitted) waiting.push_back(std::move(async));
+            submitted.clear();
+        }
+        std::vector<std::unique_ptr<Async>> blocked;
+        for (auto &async : waiting) {
+            if (!tryAcquireSlot(async->host)) {
+                blocked.push_back(std::move(async));
+                continue;
+            }
+            CURL *handle = begin(async->transfer);
+            if (!handle) {
+                releaseSlot(async->host);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    counters.pending--;
+                }
+                async->transfer.response.error = "curl_easy_init failed";
+                async->done(std::move(async->transfer.response));
+                continue;
+            }
+            curl_multi_add_handle(multi, handle);
+            running[handle] = std::move(async);
+        }
+        waiting.swap(blocked);
+
+        int active = 0;
+        curl_multi_perform(multi, &active);
+        bool freed = false;
+        int queued = 0;
+        while (CURLMsg *message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) continue;
+            CURL *handle = message->easy_handle;
+            CURLcode code = message->data.result;
+            curl_multi_remove_handle(multi, handle);
+            auto it = running.find(handle);
+            if (it == running.end()) continue;
+            auto async = std::move(it->second);
+            running.erase(it);
+            finish(handle, async->transfer, code);
+            releaseSlot(async->host);
+            freed = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                counters.pending--;
+            }
+            async->done(std::move(async->transfer.response));
+        }
+        // A finished transfer frees its host's slot for a waiting one right away.
+        if (freed && !waiting.empty()) continue;
+
+        // Sleeps until a socket is ready, a curl timeout expires or submit() wakes it.
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    for (auto &[handle, async] : running) {
+        curl_multi_remove_handle(multi, handle);
+        curl_slist_free_all(async->transfer.headerList);
+        curl_easy_cleanup(handle);
+    }
+}
+#endif
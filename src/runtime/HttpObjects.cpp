@@ -0,0 +1,482 @@
+#include "HttpObjects.hpp"
+#include "HttpCallback.hpp"
+#include "Interpreter.hpp"
+#include "SharedBuffer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#ifndef __EMSCRIPTEN__
+extern "C" {
+    void fsk_http_respond_full(uint64_t req_id, uint16_t status, const FskHeader* headers, size_t header_count, const uint8_t* body, size_t body_len);
+    bool fsk_http_respond_stream(uint64_t req_id, uint16_t status, const FskHeader* headers, size_t header_count);
+    bool fsk_http_write(uint64_t req_id, const uint8_t* data, size_t len);
+    void fsk_http_end(uint64_t req_id);
+    void fsk_http_abort(uint64_t req_id);
+    void fsk_http_body_ack(uint64_t req_id);
+    bool fsk_http_cache(uint64_t req_id, uint64_t ttl_ms, uint64_t stale_ms, const char* vary);
+}
+
+static std::vector<FskHeader> headerList(const std::vector<std::pair<std::string, std::string>> &headers) {
+    std::vector<FskHeader> list;
+    list.reserve(headers.size());
+    for (auto &header : headers) list.push_back({header.first.c_str(), header.second.c_str()});
+    return list;
+}
+#endif
+
+void FSKHttpResponse::setHeader(const std::string &name, const std::string &value) {
+    for (auto &header : headers) {
+        if (header.first == name) {
+            header.second = value;
+            return;
+        }
+    }
+    headers.emplace_back(name, value);
+}
+
+void FSKHttpResponse::send(std::string_view body) {
+    if (sent) return;
+    sent = true;
+#ifndef __EMSCRIPTEN__
+    auto list = headerList(headers);
+    fsk_http_respond_full(id, (uint16_t)statusCode, list.data(), list.size(),
+                          reinterpret_cast<const uint8_t *>(body.data()), body.size());
+#endif
+}
+
+bool FSKHttpResponse::write(std::string_view chunk) {
+    if (ended) throw std::runtime_error("write après end() sur la réponse.");
+    if (sent && !streaming) throw std::runtime_error("Réponse déjà envoyée avec send().");
+#ifndef __EMSCRIPTEN__
+    if (!sent) {
+        sent = true;
+        streaming = true;
+        auto list = headerList(headers);
+        closed = !fsk_http_respond_stream(id, (uint16_t)statusCode, list.data(), list.size());
+    }
+    if (closed) return false;
+    if (!chunk.empty()) {
+        closed = !fsk_http_write(id, reinterpret_cast<const uint8_t *>(chunk.data()), chunk.size());
+        if (closed) return false;
+        queued += chunk.size();
+    }
+    if (queued <= HighWater) return true;
+    draining = true;
+    return false;
+#else
+    return false;
+#endif
+}
+
+void FSKHttpResponse::end() {
+    if (!sent) {
+        send("");
+    } else if (streaming && !ended) {
+#ifndef __EMSCRIPTEN__
+        fsk_http_end(id);
+#endif
+    }
+    ended = true;
+    if (queued == 0) onDrain = nullptr;
+}
+
+void FSKHttpResponse::abort() {
+    if (streaming && !ended) {
+#ifndef __EMSCRIPTEN__
+        fsk_http_abort(id);
+#endif
+        closed = true;
+    }
+    ended = true;
+}
+
+void FSKHttpResponse::drained(Interpreter &interp, size_t bytes, bool written) {
+    queued -= std::min(queued, bytes);
+    if (!written) closed = true;
+    if (draining && (queued == 0 || closed)) {
+        draining = false;
+        if (auto callback = onDrain) callback->call(interp, {});
+    }
+    // Nothing more will come: don't keep the callback (it usually captures `res`).
+    if (closed || (ended && queued == 0)) onDrain = nullptr;
+}
+
+Value FSKHttpResponse::get(Token name) {
+    const std::string &key = name.lexeme;
+    if (key == "id") return Value((double)id);
+    if (key == "statusCode") return Value((double)statusCode);
+    if (key == "sent") return Value(sent);
+    if (key == "ended") return Value(ended);
+    if (key == "closed") return Value(closed);
+    if (key == "pending") return Value((double)queued);
+    return FSKInstance::get(name);
+}
+
+Value FSKHttpRequest::get(Token name) {
+    const std::string &key = name.lexeme;
+    if (key == "method") return Value(method);
+    if (key == "path") return Value(path);
+    if (key == "body") return Value(body);
+    if (key == "id") return Value((double)id);
+    if (key == "res") return Value(std::static_pointer_cast<FSKInstance>(response));
+    if (key == "streaming") return Value(streaming);
+    if (key == "params") {
+        if (std::holds_alternative<std::monostate>(paramsObject)) {
+            static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+            auto object = std::make_shared<FSKInstance>(objClass);
+            for (auto &param : params) object->fields[param.first] = Value(param.second);
+            paramsObject = Value(object);
+        }
+        return paramsObject;
+    }
+    return FSKInstance::get(name);
+}
+
+void FSKHttpRequest::set(Token name, Value value) {
+    if (auto text = std::get_if<std::string>(&value)) {
+        if (name.lexeme == "method") { method = *text; return; }
+        if (name.lexeme == "path") { path = *text; return; }
+        if (name.lexeme == "body") { body = *text; return; }
+    }
+    FSKInstance::set(name, value);
+}
+
+void FSKHttpRequest::pushChunk(Interpreter &interp, std::string chunk) {
+    pendingChunks.push_back(std::move(chunk));
+    flushBody(interp);
+}
+
+void FSKHttpRequest::finishBody(Interpreter &interp, bool aborted) {
+    bodyEnded = true;
+    this->aborted = aborted;
+    if (aborted) pendingChunks.clear(); // The server already stopped waiting for acks
+    flushBody(interp);
+}
+
+void FSKHttpRequest::flushBody(Interpreter &interp) {
+    auto self = shared_from_this(); // A callback may drop the script's last reference
+    while (onData && !pendingChunks.empty()) {
+        std::string chunk = std::move(pendingChunks.front());
+        pendingChunks.pop_front();
+#ifndef __EMSCRIPTEN__
+        if (streaming) fsk_http_body_ack(id);
+#endif
+        auto callback = onData;
+        callback->call(interp, {Value(std::move(chunk))});
+    }
+    if (!bodyEnded || !pendingChunks.empty()) return;
+    // The body is complete: the end callback runs once and none is kept
+    // afterwards, since they usually capture `req` itself.
+    auto callback = aborted ? onError : onEnd;
+    onData = nullptr;
+    onEnd = nullptr;
+    onError = nullptr;
+    if (!callback) return;
+    if (aborted) {
+        callback->call(interp, {Value(std::string("Corps de requête interrompu ou trop grand."))});
+    } else {
+        callback->call(interp, {});
+    }
+}
+
+// Request methods answer through the request's response, so `req.send(...)`
+// keeps working for single-argument handlers.
+static std::shared_ptr<FSKHttpResponse> responseOf(std::shared_ptr<FSKInstance> self) {
+    if (auto res = std::dynamic_pointer_cast<FSKHttpResponse>(self)) return res;
+    if (auto req = std::dynamic_pointer_cast<FSKHttpRequest>(self)) return req->response;
+    throw std::runtime_error("Méthode Response appelée sur un autre objet.");
+}
+
+// Bytes of a send/write/end argument: strings as they are (binary-safe),
+// SharedBuffers and typed views by their raw memory, anything else stringified.
+static std::string_view bodyOf(const std::vector<Value> &args, std::string &scratch) {
+    if (args.empty() || std::holds_alternative<std::monostate>(args[0])) return {};
+    if (auto text = std::get_if<std::string>(&args[0])) return *text;
+    if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&args[0])) {
+        if (auto buffer = std::dynamic_pointer_cast<FSKSharedBuffer>(*inst)) {
+            return {reinterpret_cast<const char *>(buffer->memory->bytes), buffer->memory->byteLength};
+        }
+        if (auto view = std::dynamic_pointer_cast<FSKTypedView>(*inst)) {
+            return {reinterpret_cast<const char *>(view->memory->bytes + view->byteOffset),
+                    view->length * FSKTypedView::elementSize(view->kind)};
+        }
+    }
+    scratch = Interpreter::stringify(args[0]);
+    return scratch;
+}
+
+// Writes through the response and, while bytes are queued, lists it so
+// fsk_on_http_drain can find it.
+static bool writeChunk(Interpreter &interp, std::shared_ptr<FSKHttpResponse> res, std::string_view chunk) {
+    bool ok = res->write(chunk);
+    if (res->queued > 0) interp.httpPool.streams.try_emplace(res->id, res);
+    return ok;
+}
+
+static std::map<std::string, std::shared_ptr<Callable>> responseMethods() {
+    return {
+        {"send", std::shared_ptr<NativeFunction>(new NativeFunction(-1, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            std::string scratch;
+            responseOf(self)->send(bodyOf(args, scratch));
+            return Value(std::monostate{});
+        }), nullptr))},
+        {"write", std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            std::string scratch;
+            return Value(writeChunk(interp, responseOf(self), bodyOf(args, scratch)));
+        }), nullptr))},
+        {"end", std::shared_ptr<NativeFunction>(new NativeFunction(-1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            auto res = responseOf(self);
+            std::string scratch;
+            auto chunk = bodyOf(args, scratch);
+            if (!res->sent) {
+                res->send(chunk);
+            } else if (!chunk.empty()) {
+                writeChunk(interp, res, chunk);
+            }
+            res->end();
+            return Value(std::monostate{});
+        }), nullptr))},
+        // res.onDrain(cb): after a write() returned false, cb runs once everything
+        // queued has gone out, or the client went away (then res.closed is true).
+        {"onDrain", std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            if (!std::holds_alternative<std::shared_ptr<Callable>>(args[0])) {
+                throw std::runtime_error("onDrain attend une fonction.");
+            }
+            responseOf(self)->onDrain = std::get<std::shared_ptr<Callable>>(args[0]);
+            return Value(self);
+        }), nullptr))},
+        {"json", std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            auto res = responseOf(self);
+            res->setHeader("Content-Type", "application/json");
+            res->send(interp.jsonStringify(args[0]));
+            return Value(std::monostate{});
+        }), nullptr))},
+        {"status", std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            if (!std::holds_alternative<double>(args[0])) {
+                throw std::runtime_error("status attend un code HTTP (nombre).");
+            }
+            int code = (int)std::get<double>(args[0]);
+            if (code < 100 || code > 999) throw std::runtime_error("Code HTTP invalide: " + std::to_string(code));
+            responseOf(self)->statusCode = code;
+            return Value(self);
+        }), nullptr))},
+        // res.cache(ttlMs, varyKeys, staleMs): the server keeps this answer (GET, 200)
+        // and replays it for ttlMs without calling the handler, keyed by path, query
+        // and the request headers in varyKeys. For staleMs more it still goes out while
+        // one request refreshes it. varyKeys and staleMs are optional. Replays skip
+        // FSK.use middleware, and requests carrying Authorization or Cookie are
+        // neither answered from nor stored in the cache.
+        {"cache", std::shared_ptr<NativeFunction>(new NativeFunction(-1, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            if (args.empty() || !std::holds_alternative<double>(args[0])) {
+                throw std::runtime_error("cache attend une durée en millisecondes (nombre).");
+            }
+            auto res = responseOf(self);
+            if (res->sent) throw std::runtime_error("cache() après l'envoi de la réponse.");
+            std::string vary;
+            if (args.size() > 1) {
+                auto add = [&](const Value &key) {
+                    if (!std::holds_alternative<std::string>(key)) throw std::runtime_error("cache attend des noms d'en-têtes (string).");
+                    if (!vary.empty()) vary += ",";
+                    vary += std::get<std::string>(key);
+                };
+                if (auto list = std::get_if<std::shared_ptr<FSKArray>>(&args[1])) {
+                    for (auto &key : (*list)->elements) add(key);
+                } else if (!std::holds_alternative<std::monostate>(args[1])) {
+                    add(args[1]);
+                }
+            }
+            double stale = 0;
+            if (args.size() > 2 && std::holds_alternative<double>(args[2])) stale = std::get<double>(args[2]);
+#ifndef __EMSCRIPTEN__
+            fsk_http_cache(res->id, (uint64_t)std::max(0.0, std::get<double>(args[0])), (uint64_t)std::max(0.0, stale), vary.c_str());
+#endif
+            return Value(self);
+        }), nullptr))},
+        {"header", std::shared_ptr<NativeFunction>(new NativeFunction(2, NativeMethodCallback([](Interpreter &, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            if (!std::holds_alternative<std::string>(args[0])) {
+                throw std::runtime_error("header attend un nom (string).");
+            }
+            auto value = std::holds_alternative<std::string>(args[1]) ? std::get<std::string>(args[1]) : Interpreter::stringify(args[1]);
+            responseOf(self)->setHeader(std::get<std::string>(args[0]), value);
+            return Value(self);
+        }), nullptr))},
+    };
+}
+
+static std::shared_ptr<FSKHttpRequest> requestOf(std::shared_ptr<FSKInstance> self) {
+    auto req = std::dynamic_pointer_cast<FSKHttpRequest>(self);
+    if (!req) throw std::runtime_error("Méthode Request appelée sur un autre objet.");
+    return req;
+}
+
+static std::shared_ptr<Callable> callbackArg(const Value &value, const char *method) {
+    if (!std::holds_alternative<std::shared_ptr<Callable>>(value)) {
+        throw std::runtime_error(std::string(method) + " attend une fonction.");
+    }
+    return std::get<std::shared_ptr<Callable>>(value);
+}
+
+// Delivery starts from the event loop, after the handler returns, so onData,
+// onEnd and onError can be registered in any order.
+static void scheduleFlush(Interpreter &interp, std::shared_ptr<FSKHttpRequest> req) {
+    interp.eventLoop->post([&interp, req]() { req->flushBody(interp); });
+}
+
+static std::shared_ptr<FSKClass> requestClass() {
+    static auto klass = [] {
+        auto methods = responseMethods();
+        methods["onData"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            auto req = requestOf(self);
+            auto callback = callbackArg(args[0], "onData");
+            // A buffered body is handed over as a single chunk.
+            if (!req->streaming && !req->onData && !req->body.empty()) req->pendingChunks.push_back(req->body);
+            req->onData = callback;
+            scheduleFlush(interp, req);
+            return Value(self);
+        }), nullptr));
+        methods["onEnd"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            auto req = requestOf(self);
+            req->onEnd = callbackArg(args[0], "onEnd");
+            scheduleFlush(interp, req);
+            return Value(self);
+        }), nullptr));
+        methods["onError"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+            auto req = requestOf(self);
+            req->onError = callbackArg(args[0], "onError");
+            scheduleFlush(interp, req);
+            return Value(self);
+        }), nullptr));
+        return std::make_shared<FSKClass>("Request", nullptr, methods);
+    }();
+    return klass;
+}
+
+static std::shared_ptr<FSKClass> responseClass() {
+    static auto klass = std::make_shared<FSKClass>("Response", nullptr, responseMethods());
+    return klass;
+}
+
+static void runChain(Interpreter &interp, std::shared_ptr<std::vector<std::shared_ptr<Callable>>> chain,
+                     size_t index, Value req, Value res) {
+    auto handler = (*chain)[index];
+    if (index + 1 == chain->size()) {
+        handler->call(interp, {req, res});
+        return;
+    }
+    auto next = std::make_shared<NativeFunction>(0, [chain, index, req, res](Interpreter &interp, std::vector<Value>) -> Value {
+        runChain(interp, chain, index + 1, req, res);
+        return Value(std::monostate{});
+    });
+    handler->call(interp, {req, res, Value(std::static_pointer_cast<Callable>(next))});
+}
+
+void HttpRoutes::dispatch(Interpreter &interp, std::shared_ptr<FSKHttpRequest> req, int route,
+                          const std::vector<uint32_t> &chain, std::shared_ptr<Callable> fallback) {
+    std::shared_ptr<Callable> handler = route >= 0 && (size_t)route < routes.size() ? routes[route].handler : fallback;
+    if (!handler) {
+        req->response->statusCode = 404;
+        req->response->send("Not Found");
+        return;
+    }
+    Value reqValue(std::static_pointer_cast<FSKInstance>(req));
+    Value resValue(std::static_pointer_cast<FSKInstance>(req->response));
+    if (chain.empty()) {
+        handler->call(interp, {reqValue, resValue});
+        return;
+    }
+    auto handlers = std::make_shared<std::vector<std::shared_ptr<Callable>>>();
+    for (uint32_t id : chain) {
+        if (id < middleware.size()) handlers->push_back(middleware[id].handler);
+    }
+    handlers->push_back(handler);
+    runChain(interp, handlers, 0, reqValue, resValue);
+}
+
+HttpPool::HttpPool() : free(std::make_shared<FreeLists>()) {}
+
+HttpPool::~HttpPool() {
+    for (auto *req : free->requests) delete req;
+    for (auto *res : free->responses) delete res;
+}
+
+std::shared_ptr<FSKHttpResponse> HttpPool::acquireResponse(uint64_t id) {
+    FSKHttpResponse *res;
+    if (!free->responses.empty()) {
+        res = free->responses.back();
+        free->responses.pop_back();
+    } else {
+        res = new FSKHttpResponse(responseClass());
+    }
+    res->id = id;
+    std::weak_ptr<FreeLists> pool = free;
+    return std::shared_ptr<FSKHttpResponse>(res, [pool](FSKHttpResponse *res) {
+        if (!res->sent) {
+            res->statusCode = 500;
+            res->send("Internal Server Error");
+        } else if (!res->ended) {
+            res->abort(); // An abandoned stream must not pass for a complete body
+        }
+        auto lists = pool.lock();
+        if (!lists || lists->responses.size() >= MaxFree) {
+            delete res;
+            return;
+        }
+        res->statusCode = 200;
+        res->headers.clear();
+        res->sent = false;
+        res->streaming = false;
+        res->ended = false;
+        res->closed = false;
+        res->queued = 0;
+        res->draining = false;
+        res->onDrain = nullptr;
+        res->fields.clear();
+        lists->responses.push_back(res);
+    });
+}
+
+std::shared_ptr<FSKHttpRequest> HttpPool::acquire(uint64_t id, std::string method, std::string path, std::string body,
+                                                  bool streaming) {
+    FSKHttpRequest *req;
+    if (!free->requests.empty()) {
+        req = free->requests.back();
+        free->requests.pop_back();
+    } else {
+        req = new FSKHttpRequest(requestClass());
+    }
+    req->id = id;
+    req->method = std::move(method);
+    req->path = std::move(path);
+    req->body = std::move(body);
+    req->streaming = streaming;
+    req->bodyEnded = !streaming;
+    req->response = acquireResponse(id);
+    std::weak_ptr<FreeLists> pool = free;
+    auto shared = std::shared_ptr<FSKHttpRequest>(req, [pool](FSKHttpRequest *req) {
+        req->response.reset();
+#ifndef __EMSCRIPTEN__
+        // Nobody will read the queued chunks: hand their credits back so the
+        // server drains the rest of the upload (later chunks are acked on arrival).
+        if (req->streaming && !req->bodyEnded) {
+            for (size_t i = 0; i < req->pendingChunks.size(); i++) fsk_http_body_ack(req->id);
+        }
+#endif
+        auto lists = pool.lock();
+        if (!lists || lists->requests.size() >= MaxFree) {
+            delete req;
+            return;
+        }
+        std::string().swap(req->body); // Don't keep a large upload alive while pooled
+        req->pendingChunks.clear();
+        req->params.clear();
+        req->paramsObject = Value(std::monostate{});
+        req->onData = nullptr;
+        req->onEnd = nullptr;
+        req->onError = nullptr;
+        req->aborted = false;
+        req->fields.clear();
+        lists->requests.push_back(req);
+    });
+    if (streaming) uploads[id] = shared;
+    return shared;
+}
@@ -7,9 +7,15 @@
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
+#include <deque>
+#include <set>
 #include <thread>
 #include <fstream>
 #include "HttpCallback.hpp"
+#include "ThreadPool.hpp"
+#include "WorkerPool.hpp"
+#include "SharedBuffer.hpp"
+#include "FiberScheduler.hpp"
 #include <iostream>
 #ifdef _WIN32
 #include <winsock2.h>
@@ -52,6 +58,7 @@
 
 #ifndef __EMSCRIPTEN__
 #include <curl/curl.h>
+#include "HttpClient.hpp"
 #include <openssl/ssl.h>
 #include <openssl/sha.h>
 #include <openssl/md5.h>
@@ -67,13 +74,53 @@ extern "C" {
     char* fsk_fetch_blocking(const char* url);
     void fsk_free_string(char* s);
     
-    typedef void (*FskHttpCallback)(uint64_t, const char*, const char*, const char*, void*);
-    void fsk_start_server(uint16_t port, FskHttpCallback callback, void* context);
+    // Server entry points spawn onto fsk-core's shared tokio runtime and return immediately.
+    typedef void (*FskHttpCallback)(const FskRequest*, void*);
+    typedef void (*FskHttpBodyCallback)(uint64_t, const uint8_t*, size_t, int32_t, void*);
+    typedef void (*FskHttpDrainCallback)(uint64_t, size_t, bool, void*);
+    struct FskServerOptions {
+        FskHttpCallback on_request;
+        FskHttpBodyCallback on_body;
+        FskHttpDrainCallback on_drain; // a streamed chunk went out (or was dropped)
+        uint64_t max_body_size;      // 0 = no limit
+        uint64_t buffered_body_size; // larger bodies stream through on_body
+        void* router;                // fsk_router_new(); owned by the server once passed
+        bool fallback;               // unmatched requests reach on_request (route -1) instead of a 404
+        void* static_files;          // fsk_static_new(); owned by the server once passed
+        bool compress;               // gzip/deflate when the client accepts it
+        uint64_t compress_min_size;  // smaller bodies go out as they are
+        uint32_t compress_level;     // 0-9 for bodies seen once; hot ones are cached at 9
+        uint64_t cache_size;         // bytes for res.cache() responses; 0 = off
+        // Admission control: past any of these (0 = no limit) requests get 503 + Retry-After.
+        void (*loop_load)(void*, FskLoopLoad*);
+        uint64_t max_in_flight;      // requests handed to the interpreters and not answered
+        uint64_t max_queue_depth;    // tasks waiting in the chosen isolate's event loop
+        uint64_t max_loop_lag_ms;    // wait of the oldest of them
+        uint32_t retry_after;        // seconds
+    };
+    void* fsk_static_new();
+    void fsk_static_free(void* files);
+    char* fsk_static_add(void* files, const char* prefix, const char* dir);
+    void* fsk_router_new();
+    void fsk_router_free(void* router);
+    char* fsk_router_add(void* router, const char* method, const char* pattern, uint32_t route);
+    void fsk_router_use(void* router, const char* prefix, uint32_t id);
+    void fsk_start_server(uint16_t port, const FskServerOptions* options, void* context);
+    void fsk_start_server_isolates(uint16_t port, const FskServerOptions* options, void* const* contexts, size_t count);
     void fsk_http_respond(uint64_t req_id, uint16_t status, const char* body);
+    void fsk_http_body_ack(uint64_t req_id);
+    uint64_t fsk_http_cache_purge(const char* pattern);
+    char* fsk_http_stats();
 
-    typedef void (*FskWsCallback)(uint32_t, const char*, void*);
-    void fsk_ws_listen(uint16_t port, FskWsCallback callback, void* context);
+    typedef void (*FskWsCallback)(uint32_t, const FskWsMessage*, size_t, void*);
+    void fsk_ws_listen(uint16_t port, const FskWsOptions* options, FskWsCallback callback, void* context);
     void fsk_ws_send(uint32_t ws_id, const char* message);
+    bool fsk_ws_send_bytes(uint32_t ws_id, const uint8_t* data, size_t len, bool binary);
+    bool fsk_ws_join(uint32_t ws_id, const char* room);
+    bool fsk_ws_leave(uint32_t ws_id, const char* room);
+    uint64_t fsk_ws_publish(const char* room, const uint8_t* data, size_t len, bool binary, uint32_t except);
+    uint64_t fsk_ws_room_size(const char* room);
+    char* fsk_ws_stats(uint32_t ws_id);
 
     char* fsk_crypto_sha256(const char* input);
     char* fsk_crypto_md5(const char* input);
@@ -158,6 +205,140 @@ json valueToJson(Value v) {
     return nullptr;
 }
 
+static std::shared_ptr<Callable> callableArg(const std::vector<Value> &args, size_t index) {
+    if (index < args.size()) {
+        if (auto fn = std::get_if<std::shared_ptr<Callable>>(&args[index])) return *fn;
+    }
+    return nullptr;
+}
+
+static std::shared_ptr<FSKPromise> asPromise(const Value &v) {
+    if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&v)) {
+        return std::dynamic_pointer_cast<FSKPromise>(*inst);
+    }
+    return nullptr;
+}
+
+// poll()/workerPoll(max?): drains the queue, or at most `max` messages, under one lock.
+static std::vector<ClonedMessage> popMessages(ThreadSafeQueue<ClonedMessage> &queue, const std::vector<Value> &args) {
+    if (!args.empty() && std::holds_alternative<double>(args[0]) && std::get<double>(args[0]) > 0) {
+        return queue.popBatch((size_t)std::get<double>(args[0]));
+    }
+    return queue.popAll();
+}
+
+// Body shared by Worker.init and Task.run: load the script into a fresh interpreter wired to the queues.
+// Runs a callback the loop scheduled (timer, microtask). Its errors cannot reach
+// the script that scheduled it, so they are reported and the loop goes on.
+static void runCallback(Interpreter &interp, const std::shared_ptr<Callable> &callable) {
+  try {
+    callable->call(interp, {});
+  } catch (const FSKException &error) {
+    interp.reportError("exception non interceptée : " + Interpreter::stringify(error.value));
+  } catch (const std::runtime_error &error) {
+    interp.reportError(error.what());
+  }
+}
+
+static void runWorkerScript(const std::string &scriptPath, std::shared_ptr<Interpreter::WorkerResource> resource) {
+    std::string source;
+    try {
+        std::ifstream t(scriptPath);
+        std::stringstream buffer;
+        buffer << t.rdbuf();
+        source = buffer.str();
+    } catch (...) { return; }
+
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+
+    Interpreter workerInterp;
+    workerInterp.isWorker = true;
+    workerInterp.workerIncoming = resource->incoming;
+    workerInterp.workerOutgoing = resource->outgoing;
+
+    try {
+       workerInterp.interpret(statements);
+    } catch(...) {}
+}
+
+#ifndef __EMSCRIPTEN__
+// Secondary HTTP isolate: re-runs the app script in its own interpreter and event loop.
+// Its FSK.listen call joins `group` instead of binding the port again and counts it
+// as settled right there; one that finishes its top-level statements without
+// reaching listen settles then, so the primary never waits on one that will not join.
+static void runIsolate(std::shared_ptr<Interpreter::IsolateGroup> group, int id, std::vector<std::string> args) {
+    auto settle = [&group](Interpreter *isolate) {
+        {
+            std::lock_guard<std::mutex> lock(group->mutex);
+            auto &members = group->members;
+            if (std::find(members.begin(), members.end(), isolate) == members.end()) group->settled++;
+        }
+        group->ready.notify_all();
+    };
+
+    std::ifstream file(args[1]);
+    if (!file.is_open()) return settle(nullptr);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    std::vector<char *> argv;
+    for (auto &arg : args) argv.push_back(arg.data());
+
+    Interpreter isolate;
+    isolate.setArgs((int)argv.size(), argv.data());
+    isolate.isolateId = id;
+    isolate.isolateGroup = group;
+    try {
+        Lexer lexer(buffer.str());
+        Parser parser(lexer.scanTokens());
+        isolate.interpret(parser.parse(), false);
+    } catch (const FSKException &error) {
+        isolate.reportError("isolate " + std::to_string(id) + " : exception non interceptée : " + Interpreter::stringify(error.value));
+    } catch (const std::runtime_error &error) {
+        isolate.reportError("isolate " + std::to_string(id) + " : " + error.what());
+    }
+    settle(&isolate);
+    isolate.interpret({}); // the loop, with the usual error reporting
+}
+
+// Compiles FSK.route / FSK.use / FSK.static into the fsk-core router and static
+// mounts handed to the server. Throws (freeing both) on an invalid pattern or directory.
+static void buildRouter(Interpreter &interp, FskServerOptions &options) {
+    if (interp.httpRoutes.empty()) return;
+    void *router = fsk_router_new();
+    auto &routes = interp.httpRoutes;
+    for (size_t i = 0; i < routes.routes.size(); i++) {
+        if (char *error = fsk_router_add(router, routes.routes[i].method.c_str(), routes.routes[i].pattern.c_str(), (uint32_t)i)) {
+            std::string message = std::string("Route invalide: ") + error;
+            fsk_free_string(error);
+            fsk_router_free(router);
+            throw std::runtime_error(message);
+        }
+    }
+    for (size_t i = 0; i < routes.middleware.size(); i++) {
+        fsk_router_use(router, routes.middleware[i].prefix.c_str(), (uint32_t)i);
+    }
+    if (!routes.statics.empty()) {
+        void *files = fsk_static_new();
+        for (auto &mount : routes.statics) {
+            if (char *error = fsk_static_add(files, mount.first.c_str(), mount.second.c_str())) {
+                std::string message = std::string("Dossier statique invalide: ") + error;
+                fsk_free_string(error);
+                fsk_static_free(files);
+                fsk_router_free(router);
+                throw std::runtime_error(message);
+            }
+        }
+        options.static_files = files;
+    }
+    options.router = router;
+    options.fallback = interp.httpHandler != nullptr;
+}
+#endif
+
 class LibraryCallable : public Callable {
 public:
     uint64_t libId;
@@ -170,8 +351,11 @@ public:
 
 extern "C" void fsk_vm_run(const uint8_t* bytecode_ptr, size_t bytecode_len, const char* constants_json);
 
-Interpreter::Interpreter() {
+Interpreter::Interpreter(bool withPrelude) {
   eventLoop = std::make_shared<EventLoop>();
+  if (const char *dumpMs = std::getenv("FSK_LOOP_STATS_MS")) {
+    eventLoop->setStatsDump(std::chrono::milliseconds(std::atol(dumpMs)));
+  }
   globals = std::make_shared<Environment>();
   environment = globals;
 
@@ -259,32 +443,6 @@ Interpreter::Interpreter() {
                         return Value(true);
                       }));
 
-  std::map<std::string, std::shared_ptr<Callable>> methods;
-  auto fskClass =
-      std::make_shared<FSKClass>("FSK", nullptr, methods);
-  auto fskInstance = std::make_shared<FSKInstance>(fskClass);
-
-  fskInstance->fields["random"] = std::make_shared<NativeFunction>(
-      2, [](Interpreter &interp, std::vector<Value> args) {
-        if (!std::holds_alternative<double>(args[0]) ||
-            !std::holds_alternative<double>(args[1])) {
-          throw std::runtime_error("random attend (min, max) nombres.");
-        }
-        int min = (int)std::get<double>(args[0]);
-        int max = (int)std::get<double>(args[1]);
-        return Value((double)(min + rand() % (max - min + 1)));
-      });
-
-  fskInstance->fields["exec"] = std::make_shared<NativeFunction>(
-      1, [](Interpreter &interp, std::vector<Value> args) {
-        if (!std::holds_alternative<std::string>(args[0])) {
-          throw std::runtime_error("exec attend une commande (string).");
-        }
-        std::string command = std::get<std::string>(args[0]);
-        int result = std::system(command.c_str());
-        return Value((double)result);
-      });
-
   globals->define("exit", std::make_shared<NativeFunction>(
       0, [](Interpreter &interp, std::vector<Value> args) {
         exit(0);
@@ -313,7 +471,7 @@ Interpreter::Interpreter() {
         auto callable = std::get<std::shared_ptr<Callable>>(args[0]);
         int ms = (int)std::get<double>(args[1]);
         int id = interp.eventLoop->setTimeout([&interp, callable]() {
-            try { callable->call(interp, {}); } catch(...) {}
+            runCallback(interp, callable);
         }, std::chrono::milliseconds(ms));
         return Value((double)id);
       }));
@@ -327,7 +485,7 @@ Interpreter::Interpreter() {
         auto callable = std::get<std::shared_ptr<Callable>>(args[0]);
         int ms = (int)std::get<double>(args[1]);
         int id = interp.eventLoop->setInterval([&interp, callable]() {
-            try { callable->call(interp, {}); } catch(...) {}
+            runCallback(interp, callable);
         }, std::chrono::milliseconds(ms));
         return Value((double)id);
       }));
@@ -350,109 +508,377 @@ Interpreter::Interpreter() {
         return Value(std::monostate{});
       }));
 
-  auto promiseClass = std::make_shared<FSKClass>("Promise", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-  
   std::map<std::string, std::shared_ptr<Callable>> pMethods;
 
-  pMethods["init"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, 
+  pMethods["then"] = std::shared_ptr<NativeFunction>(new NativeFunction(-1, 
       NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
-          if (!self) return Value(std::monostate{});
-          self->fields["state"] = std::string("pending");
-          self->fields["value"] = std::monostate{};
-    
-          if (args.size() > 0 && std::holds_alternative<std::shared_ptr<Callable>>(args[0])) {
-              auto executor = std::get<std::shared_ptr<Callable>>(args[0]);
-              
-              NativeCallback resolve = [self](Interpreter &i, std::vector<Value> a) -> Value {
-                  if (std::holds_alternative<std::string>(self->fields["state"]) && std::get<std::string>(self->fields["state"]) == "pending") {
-                      self->fields["state"] = std::string("resolved");
-                      self->fields["value"] = a.empty() ? Value(std::monostate{}) : a[0];
-                  }
-                  return Value(std::monostate{});
-              };
-              auto resolveFn = std::shared_ptr<NativeFunction>(new NativeFunction(1, resolve));
-    
-              NativeCallback reject = [self](Interpreter &i, std::vector<Value> a) -> Value {
-                  if (std::holds_alternative<std::string>(self->fields["state"]) && std::get<std::string>(self->fields["state"]) == "pending") {
-                      self->fields["state"] = std::string("rejected");
-                      self->fields["value"] = a.empty() ? Value(std::monostate{}) : a[0];
-                  }
-                  return Value(std::monostate{});
-              };
-              auto rejectFn = std::shared_ptr<NativeFunction>(new NativeFunction(1, reject));
-    
-              executor->call(interp, {Value(std::static_pointer_cast<Callable>(resolveFn)), Value(std::static_pointer_cast<Callable>(rejectFn))});
-          }
-          return Value(self);
+          auto promise = std::dynamic_pointer_cast<FSKPromise>(self);
+          if (!promise) return Value(std::monostate{});
+          auto derived = promise->then(interp, callableArg(args, 0), callableArg(args, 1));
+          return Value(std::static_pointer_cast<FSKInstance>(derived));
+      }), nullptr));
+
+  pMethods["catch"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, 
+      NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+          auto promise = std::dynamic_pointer_cast<FSKPromise>(self);
+          if (!promise) return Value(std::monostate{});
+          auto derived = promise->then(interp, nullptr, callableArg(args, 0));
+          return Value(std::static_pointer_cast<FSKInstance>(derived));
+      }), nullptr));
+
+  pMethods["finally"] = std::shared_ptr<NativeFunction>(new NativeFunction(1, 
+      NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+          auto promise = std::dynamic_pointer_cast<FSKPromise>(self);
+          if (!promise) return Value(std::monostate{});
+          auto derived = promise->then(interp, nullptr, nullptr, callableArg(args, 0));
+          return Value(std::static_pointer_cast<FSKInstance>(derived));
       }), nullptr));
 
   pMethods["wait"] = std::shared_ptr<NativeFunction>(new NativeFunction(0, 
       NativeMethodCallback([](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
-           if (!self) return Value(std::monostate{});
-           
-           while (std::get<std::string>(self->fields["state"]) == "pending") {
-               if (!interp.eventLoop->processOne(true)) {
-                   break; 
-               }
-           }
-           
-           if (std::get<std::string>(self->fields["state"]) == "rejected") {
-               throw std::runtime_error("Promise rejected: " + Interpreter::stringify(self->fields["value"]));
-           }
-           return self->fields["value"];
+           auto promise = std::dynamic_pointer_cast<FSKPromise>(self);
+           if (!promise) return Value(std::monostate{});
+           return promise->wait(interp);
       }), nullptr));
 
-  promiseClass->methods = pMethods;
-  globals->define("Promise", promiseClass);
+  promiseClass = std::make_shared<FSKPromiseClass>(pMethods);
+
+  promiseClass->statics["resolve"] = std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+      auto promise = interp.makePromise();
+      promise->resolve(interp, args.empty() ? Value(std::monostate{}) : args[0]);
+      return Value(std::static_pointer_cast<FSKInstance>(promise));
+  });
+
+  promiseClass->statics["reject"] = std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+      auto promise = interp.makePromise();
+      promise->reject(interp, args.empty() ? Value(std::monostate{}) : args[0]);
+      return Value(std::static_pointer_cast<FSKInstance>(promise));
+  });
+
+  // Combinators keep one shared counter per call, so each settlement is O(1).
+  promiseClass->statics["all"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+      if (!std::holds_alternative<std::shared_ptr<FSKArray>>(args[0]))
+          throw std::runtime_error("Promise.all attend un tableau.");
+      auto items = std::get<std::shared_ptr<FSKArray>>(args[0])->elements;
+      auto result = interp.makePromise();
+
+      struct AllState { std::vector<Value> values; size_t remaining; };
+      auto state = std::make_shared<AllState>(AllState{std::vector<Value>(items.size()), items.size()});
+
+      for (size_t i = 0; i < items.size(); i++) {
+          auto promise = asPromise(items[i]);
+          if (!promise) {
+              state->values[i] = items[i];
+              state->remaining--;
+              continue;
+          }
+          auto onFulfilled = std::make_shared<NativeFunction>(1, [state, result, i](Interpreter &interp, std::vector<Value> a) -> Value {
+              state->values[i] = a[0];
+              if (--state->remaining == 0)
+                  result->resolve(interp, Value(std::make_shared<FSKArray>(std::move(state->values))));
+              return Value(std::monostate{});
+          });
+          auto onRejected = std::make_shared<NativeFunction>(1, [result](Interpreter &interp, std::vector<Value> a) -> Value {
+              result->reject(interp, a[0]);
+              return Value(std::monostate{});
+          });
+          promise->addReaction(interp, {onFulfilled, onRejected, nullptr, nullptr});
+      }
+      if (state->remaining == 0)
+          result->resolve(interp, Value(std::make_shared<FSKArray>(std::move(state->values))));
+      return Value(std::static_pointer_cast<FSKInstance>(result));
+  });
+
+  promiseClass->statics["race"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+      if (!std::holds_alternative<std::shared_ptr<FSKArray>>(args[0]))
+          throw std::runtime_error("Promise.race attend un tableau.");
+      auto items = std::get<std::shared_ptr<FSKArray>>(args[0])->elements;
+      auto result = interp.makePromise();
+
+      for (auto &item : items) {
+          auto promise = asPromise(item);
+          if (!promise) {
+              result->resolve(interp, item);
+              break;
+          }
+          promise->addReaction(interp, {nullptr, nullptr, nullptr, result});
+      }
+      return Value(std::static_pointer_cast<FSKInstance>(result));
+  });
+
+  promiseClass->statics["allSettled"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+      if (!std::holds_alternative<std::shared_ptr<FSKArray>>(args[0]))
+          throw std::runtime_error("Promise.allSettled attend un tableau.");
+      auto items = std::get<std::shared_ptr<FSKArray>>(args[0])->elements;
+      auto result = interp.makePromise();
+
+      static auto outcomeClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+      auto outcome = [](bool fulfilled, Value v) -> Value {
+          auto inst = std::make_shared<FSKInstance>(outcomeClass);
+          inst->fields["status"] = std::string(fulfilled ? "fulfilled" : "rejected");
+          inst->fields[fulfilled ? "value" : "reason"] = v;
+          return Value(inst);
+      };
+
+      struct AllState { std::vector<Value> values; size_t remaining; };
+      auto state = std::make_shared<AllState>(AllState{std::vector<Value>(items.size()), items.size()});
+
+      for (size_t i = 0; i < items.size(); i++) {
+          auto promise = asPromise(items[i]);
+          if (!promise) {
+              state->values[i] = outcome(true, items[i]);
+              state->remaining--;
+              continue;
+          }
+          auto settled = [state, result, i, outcome](bool fulfilled) {
+              return std::make_shared<NativeFunction>(1, [state, result, i, outcome, fulfilled](Interpreter &interp, std::vector<Value> a) -> Value {
+                  state->values[i] = outcome(fulfilled, a[0]);
+                  if (--state->remaining == 0)
+                      result->resolve(interp, Value(std::make_shared<FSKArray>(std::move(state->values))));
+                  return Value(std::monostate{});
+              });
+          };
+          promise->addReaction(interp, {settled(true), settled(false), nullptr, nullptr});
+      }
+      if (state->remaining == 0)
+          result->resolve(interp, Value(std::make_shared<FSKArray>(std::move(state->values))));
+      return Value(std::static_pointer_cast<FSKInstance>(result));
+  });
+
+  globals->define("Promise", std::static_pointer_cast<Callable>(promiseClass));
+
+  globals->define("queueMicrotask", std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<std::shared_ptr<Callable>>(args[0])) {
+          throw std::runtime_error("queueMicrotask attend une fonction.");
+        }
+        auto callable = std::get<std::shared_ptr<Callable>>(args[0]);
+        interp.eventLoop->queueMicrotask([&interp, callable]() {
+            runCallback(interp, callable);
+        });
+        return Value(std::monostate{});
+      }));
+
+  // Native modules are built on first access to their global, so a worker or a
+  // short CLI script only pays for the namespaces it actually touches.
+  globals->defineLazy("FSK", [this] { return nativeModules["FSK"] = makeFskModule(); });
+  globals->defineLazy("WS", [this] { return nativeModules["WS"] = makeWsModule(); });
+  globals->defineLazy("FFI", [this] { return nativeModules["FFI"] = makeFfiModule(); });
+  globals->defineLazy("Console", [this] { return nativeModules["Console"] = makeConsoleModule(); });
+  globals->defineLazy("SQL", [this] { return nativeModules["SQL"] = makeSqlModule(); });
+  globals->defineLazy("System", [this] { return nativeModules["System"] = makeSystemModule(); });
+  globals->defineLazy("VM", [this] { return nativeModules["VM"] = makeVmModule(); });
+  globals->defineLazy("JSON", [this] { return nativeModules["JSON"] = makeJsonModule(); });
+  globals->defineLazy("Audio", [this] { return nativeModules["Audio"] = makeAudioModule(); });
+  globals->defineLazy("Graphics", [this] { return nativeModules["Graphics"] = makeGraphicsModule(); });
+  globals->defineLazy("Math", [this] { return nativeModules["Math"] = makeMathModule(); });
+  globals->defineLazy("Crypto", [this] { return nativeModules["Crypto"] = makeCryptoModule(); });
+  globals->defineLazy("Date", [this] { return nativeModules["Date"] = makeDateModule(); });
+  globals->defineLazy("FS", [this] { return nativeModules["FS"] = makeFsModule(); });
+  globals->defineLazy("Worker", [this] { return nativeModules["Worker"] = makeWorkerModule(); });
+  globals->defineLazy("Task", [this] { return nativeModules["Task"] = makeTaskModule(); });
+  globals->defineLazy("Atomics", [this] { return nativeModules["Atomics"] = makeAtomicsModule(); });
+  globals->defineLazy("Regex", [this] { return nativeModules["Regex"] = makeRegexModule(); });
+  globals->defineLazy("HTTP", [this] { return nativeModules["HTTP"] = makeHttpModule(); });
+
+  globals->define("workerPostMessage", std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) {
+      if (args.empty()) throw std::runtime_error("workerPostMessage attend un message.");
+      if (!interp.isWorker || !interp.workerOutgoing) return Value(false);
+      bool transfer = args.size() > 1 && std::holds_alternative<bool>(args[1]) && std::get<bool>(args[1]);
+      auto message = ClonedMessage::fromValue(std::move(args[0]), transfer);
+      return Value(interp.workerOutgoing->push(std::move(message))); // waits for the main loop to poll
+  }));
+
+  globals->define("workerPoll", std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!interp.isWorker || !interp.workerIncoming) return Value(std::make_shared<FSKArray>(std::vector<Value>{}));
+      std::vector<Value> msgs;
+      for (auto &msg : popMessages(*interp.workerIncoming, args)) {
+          msgs.push_back(msg.toValue());
+      }
+      return Value(std::make_shared<FSKArray>(msgs));
+  }));
+
+  globals->define("SharedBuffer", std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0]) || std::get<double>(args[0]) < 0) {
+          throw std::runtime_error("SharedBuffer attend une taille en octets.");
+      }
+      auto memory = std::make_shared<SharedMemory>((size_t)std::get<double>(args[0]));
+      return Value(std::static_pointer_cast<FSKInstance>(makeSharedBuffer(memory)));
+  }));
+
+  globals->define("Channel", std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) {
+      size_t capacity = 0;
+      if (!args.empty() && std::holds_alternative<double>(args[0]) && std::get<double>(args[0]) > 0) {
+          capacity = (size_t)std::get<double>(args[0]);
+      }
+      return Value(std::static_pointer_cast<FSKInstance>(makeChannel(std::make_shared<ChannelState>(capacity))));
+  }));
+
+  if (withPrelude) loadPrelude();
+}
+
+void Interpreter::loadPrelude() {
+  std::vector<std::string> searchPaths = {
+      "std/prelude.fsk",
+      "../std/prelude.fsk",
+      "/usr/local/lib/fsk/std/prelude.fsk",
+      "C:/Fsk/std/prelude.fsk" 
+  };
+  for (const auto &path : searchPaths) {
+    std::ifstream file(path);
+    if (file.is_open()) {
+      std::stringstream buffer;
+      buffer << file.rdbuf();
+      std::vector<std::shared_ptr<Stmt>> statements = parseSource(buffer.str());
+      try {
+        interpret(statements);
+      } catch (...) {
+      }
+      break;
+    }
+  }
+}
+
+Value Interpreter::makeFskModule() {
+  std::map<std::string, std::shared_ptr<Callable>> methods;
+  auto fskClass =
+      std::make_shared<FSKClass>("FSK", nullptr, methods);
+  auto fskInstance = std::make_shared<FSKInstance>(fskClass);
+
+  fskInstance->fields["random"] = std::make_shared<NativeFunction>(
+      2, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<double>(args[0]) ||
+            !std::holds_alternative<double>(args[1])) {
+          throw std::runtime_error("random attend (min, max) nombres.");
+        }
+        int min = (int)std::get<double>(args[0]);
+        int max = (int)std::get<double>(args[1]);
+        return Value((double)(min + rand() % (max - min + 1)));
+      });
+
+  fskInstance->fields["exec"] = std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<std::string>(args[0])) {
+          throw std::runtime_error("exec attend une commande (string).");
+        }
+        std::string command = std::get<std::string>(args[0]);
+        int result = std::system(command.c_str());
+        return Value((double)result);
+      });
 
   fskInstance->fields["fetch"] = std::make_shared<NativeFunction>(
-      1, std::function<Value(Interpreter &, std::vector<Value>)>(
-             [=](Interpreter &interp, std::vector<Value> args) -> Value {
-               if (!std::holds_alternative<std::string>(args[0])) {
-                 throw std::runtime_error("fetch attend une URL.");
-               }
-               std::string url = std::get<std::string>(args[0]);
-
-                // Explicit function construction using alias
-                NativeCallback execFunc = 
-                    [url, &interp](Interpreter &i, std::vector<Value> ea) -> Value {
-                         auto resolve = ea[0];
-                         auto reject = ea[1];
-                         auto evLoop = i.eventLoop;
-                         
-                         evLoop->incrementWorkCount();
-                         std::thread([evLoop, url, resolve, reject, &interp]() {
-                             char *result = fsk_fetch_blocking(url.c_str());
-                             if (result) {
-                                std::string body_res(result);
-                                fsk_free_string(result);
-                                
-                                evLoop->post([&interp, resolve, reject, body_res, evLoop]() {
-                                    if (auto r = std::get_if<std::shared_ptr<Callable>>(&resolve)) {
-                                        (*r)->call(interp, {Value(body_res)});
-                                    }
-                                    evLoop->decrementWorkCount();
-                                });
-                             } else {
-                                evLoop->post([&interp, resolve, reject, evLoop]() {
-                                    if (auto r = std::get_if<std::shared_ptr<Callable>>(&reject)) {
-                                        (*r)->call(interp, {Value(std::string("Fetch failed"))});
-                                    }
-                                    evLoop->decrementWorkCount();
-                                });
-                             }
-                         }).detach();
-                         return Value(std::monostate{}); 
-                    };
-
-                 auto executor = std::shared_ptr<NativeFunction>(new NativeFunction(2, execFunc));
-
-                 auto Promise = interp.globals->get("Promise");
-                 if (auto cls = std::get_if<std::shared_ptr<Callable>>(&Promise)) {
-                     return (*cls)->call(interp, {Value(std::static_pointer_cast<Callable>(executor))});
-                 }
-                 return Value(std::monostate{});
-             }));
+      1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+        if (!std::holds_alternative<std::string>(args[0])) {
+          throw std::runtime_error("fetch attend une URL.");
+        }
+        std::string url = std::get<std::string>(args[0]);
+
+        auto promise = interp.makePromise();
+        auto evLoop = interp.eventLoop;
+
+        evLoop->incrementWorkCount();
+        bool queued = ThreadPool::shared().submit([evLoop, url, promise, &interp]() {
+            char *result = fsk_fetch_blocking(url.c_str());
+            if (result) {
+               std::string body_res(result);
+               fsk_free_string(result);
+
+               evLoop->post([&interp, promise, body_res, evLoop]() {
+                   promise->resolve(interp, Value(body_res));
+                   evLoop->decrementWorkCount();
+               });
+            } else {
+               evLoop->post([&interp, promise, evLoop]() {
+                   promise->reject(interp, Value(std::string("Fetch failed")));
+                   evLoop->decrementWorkCount();
+               });
+            }
+        });
+        if (!queued) {
+            evLoop->decrementWorkCount();
+            promise->reject(interp, Value(std::string("Fetch failed: I/O pool saturated")));
+        }
+
+        return Value(std::static_pointer_cast<FSKInstance>(promise));
+      });
+
+  fskInstance->fields["ioStats"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+        auto stats = ThreadPool::shared().stats();
+        auto obj = std::make_shared<FSKInstance>(objClass);
+        obj->fields["threads"] = Value((double)stats.threads);
+        obj->fields["maxThreads"] = Value((double)stats.maxThreads);
+        obj->fields["active"] = Value((double)stats.active);
+        obj->fields["queued"] = Value((double)stats.queued);
+        obj->fields["maxQueue"] = Value((double)stats.maxQueue);
+        obj->fields["completed"] = Value((double)stats.completed);
+        obj->fields["rejected"] = Value((double)stats.rejected);
+        return Value(obj);
+      });
+
+  fskInstance->fields["fiberStats"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+        auto stats = FiberScheduler::shared().stats();
+        auto obj = std::make_shared<FSKInstance>(objClass);
+        obj->fields["threads"] = Value((double)stats.threads);
+        obj->fields["parked"] = Value((double)stats.parked);
+        obj->fields["queued"] = Value((double)stats.queued);
+        obj->fields["spawned"] = Value((double)stats.spawned);
+        obj->fields["completed"] = Value((double)stats.completed);
+        obj->fields["stolen"] = Value((double)stats.stolen);
+        return Value(obj);
+      });
+
+  fskInstance->fields["loopStats"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+        auto stats = interp.eventLoop->stats();
+        auto obj = std::make_shared<FSKInstance>(objClass);
+        obj->fields["lagMs"] = Value(stats.lastLagMs);
+        obj->fields["maxLagMs"] = Value(stats.maxLagMs);
+        obj->fields["avgLagMs"] = Value(stats.timersFired ? stats.totalLagMs / stats.timersFired : 0.0);
+        obj->fields["timersFired"] = Value((double)stats.timersFired);
+        obj->fields["queueDepth"] = Value((double)stats.queueDepth);
+        obj->fields["maxQueueDepth"] = Value((double)stats.maxQueueDepth);
+        obj->fields["queueWaitMs"] = Value(std::chrono::duration<double, std::milli>(interp.eventLoop->load().oldestWait).count());
+        obj->fields["tasks"] = Value((double)stats.tasksRun);
+        obj->fields["microtasks"] = Value((double)stats.microtasksRun);
+        obj->fields["avgTaskMs"] = Value(stats.tasksRun ? stats.totalTaskMs / stats.tasksRun : 0.0);
+        obj->fields["maxTaskMs"] = Value(stats.maxTaskMs);
+        obj->fields["activeWork"] = Value((double)stats.activeWork);
+
+        std::vector<Value> bounds;
+        std::vector<Value> histogram;
+        for (int i = 0; i < EventLoop::HistogramBuckets; i++) {
+            if (i < EventLoop::HistogramBuckets - 1) bounds.push_back(Value(EventLoop::HistogramBoundsMs[i]));
+            histogram.push_back(Value((double)stats.histogram[i]));
+        }
+        obj->fields["histogramBoundsMs"] = Value(std::make_shared<FSKArray>(bounds));
+        obj->fields["histogram"] = Value(std::make_shared<FSKArray>(histogram));
+        return Value(obj);
+      });
+
+  fskInstance->fields["loopStatsDump"] = std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<double>(args[0])) {
+          throw std::runtime_error("loopStatsDump attend un intervalle en millisecondes (0 pour couper).");
+        }
+        interp.eventLoop->setStatsDump(std::chrono::milliseconds((long long)std::get<double>(args[0])));
+        return Value(true);
+      });
+
+  fskInstance->fields["ioPool"] = std::make_shared<NativeFunction>(
+      2, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<double>(args[0]) || !std::holds_alternative<double>(args[1])) {
+          throw std::runtime_error("ioPool attend (threads, queue) en nombres.");
+        }
+        double threads = std::get<double>(args[0]);
+        double queue = std::get<double>(args[1]);
+        ThreadPool::shared().configure(threads > 0 ? (size_t)threads : 0, queue > 0 ? (size_t)queue : 0);
+        return Value(true);
+      });
 
 #ifdef __EMSCRIPTEN__
    fskInstance->fields["startServer"] = std::make_shared<NativeFunction>(
@@ -491,6 +917,13 @@ Interpreter::Interpreter() {
       0, [](Interpreter &interp, std::vector<Value> args) {
         return Value(std::string("1.1.0"));
       });
+
+  // True while `fsk snapshot` runs the script's initialization: scripts skip
+  // their entry point then and let the restored process call main().
+  fskInstance->fields["snapshotting"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        return Value(interp.snapshotting);
+      });
   
   fskInstance->fields["sleep"] = std::make_shared<NativeFunction>(
       1, [](Interpreter &interp, std::vector<Value> args) {
@@ -508,25 +941,173 @@ Interpreter::Interpreter() {
 
 #ifndef __EMSCRIPTEN__
   fskInstance->fields["listen"] = std::make_shared<NativeFunction>(
-      2, [](Interpreter &interp, std::vector<Value> args) {
-        if (!std::holds_alternative<double>(args[0])) {
+      -1, [](Interpreter &interp, std::vector<Value> args) {
+        if (args.empty() || !std::holds_alternative<double>(args[0])) {
           throw std::runtime_error("listen attend un port (nombre).");
         }
         int port = (int)std::get<double>(args[0]);
 
-        if (!std::holds_alternative<std::shared_ptr<Callable>>(args[1])) {
+        // With routes registered the handler is optional and only sees what no route matched.
+        bool hasHandler = args.size() > 1 && std::holds_alternative<std::shared_ptr<Callable>>(args[1]);
+        if (!hasHandler && interp.httpRoutes.empty()) {
            throw std::runtime_error("listen attend une fonction handler.");
         }
-        
-        interp.globals->define("onHttpRequest", args[1]);
+
+        if (hasHandler) {
+            interp.globals->define("onHttpRequest", args[1]);
+            interp.httpHandler = std::get<std::shared_ptr<Callable>>(args[1]);
+        }
+
+        // Bodies up to bodyBufferSize arrive whole in req.body, larger ones stream
+        // (req.onData); over maxBodySize they are refused with 413. Responses from
+        // compressMinSize bytes are compressed unless `compress: false`. res.cache()
+        // keeps up to cacheSize bytes of responses. With maxInFlight, maxQueueDepth or
+        // maxLoopLag (ms) set, requests past them are answered 503 with Retry-After
+        // (retryAfter seconds) before reaching the script.
+        FskServerOptions options{fsk_on_http_request, fsk_on_http_body, fsk_on_http_drain, 0, 1024 * 1024, nullptr, true, nullptr, true, 1024, 1,
+                                 32 * 1024 * 1024, fsk_http_loop_load, 0, 0, 0, 1};
+        // Secondary isolate: its copy of the script reached listen, so it can take requests.
+        // One that gets there after the port is bound has no share of the traffic and
+        // returns false without holding its loop open.
+        if (interp.isolateGroup && interp.isolateId > 0) {
+            std::lock_guard<std::mutex> lock(interp.isolateGroup->mutex);
+            if (interp.isolateGroup->serving) {
+                std::cerr << "[FSK] isolate " << interp.isolateId << " reached listen after the server started, ignored." << std::endl;
+                return Value(false);
+            }
+            auto &members = interp.isolateGroup->members;
+            if (std::find(members.begin(), members.end(), &interp) != members.end()) return Value(true);
+            members.push_back(&interp);
+            interp.isolateGroup->settled++;
+            interp.isolateGroup->ready.notify_all();
+            interp.eventLoop->incrementWorkCount();
+            return Value(true);
+        }
+        buildRouter(interp, options); // may throw: before the loop is held open
         interp.eventLoop->incrementWorkCount();
 
-        std::thread([port, &interp]() {
-            fsk_start_server((uint16_t)port, fsk_on_http_request, &interp);
-        }).detach();
+        int isolates = Interpreter::defaultIsolates;
+        if (args.size() > 2) {
+            if (auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&args[2])) {
+                auto number = [&](const char *name) -> std::optional<double> {
+                    auto it = (*opts)->fields.find(name);
+                    if (it == (*opts)->fields.end() || !std::holds_alternative<double>(it->second)) return std::nullopt;
+                    return std::get<double>(it->second);
+                };
+                if (auto n = number("isolates")) isolates = (int)*n;
+                if (auto n = number("maxBodySize")) options.max_body_size = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("bodyBufferSize")) options.buffered_body_size = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("compressMinSize")) options.compress_min_size = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("compressLevel")) options.compress_level = (uint32_t)std::clamp(*n, 0.0, 9.0);
+                if (auto n = number("cacheSize")) options.cache_size = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("maxInFlight")) options.max_in_flight = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("maxQueueDepth")) options.max_queue_depth = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("maxLoopLag")) options.max_loop_lag_ms = (uint64_t)std::max(0.0, *n);
+                if (auto n = number("retryAfter")) options.retry_after = (uint32_t)std::clamp(*n, 1.0, 86400.0);
+                auto compress = (*opts)->fields.find("compress");
+                if (compress != (*opts)->fields.end() && std::holds_alternative<bool>(compress->second)) {
+                    options.compress = std::get<bool>(compress->second);
+                }
+            }
+        }
+        if (isolates <= 1 || interp.scriptArgs.size() < 2) {
+            fsk_start_server((uint16_t)port, &options, &interp);
+            return Value(true);
+        }
+
+        auto group = std::make_shared<IsolateGroup>();
+        group->members.push_back(&interp);
+        interp.isolateGroup = group;
+        for (int id = 1; id < isolates; id++) {
+            std::thread([group, id, args = interp.scriptArgs]() { runIsolate(group, id, args); }).detach();
+        }
 
+        // Each secondary settles when its copy of the script reaches listen (or ends
+        // without it), so the wait lasts about one startup; members that joined by
+        // then share the port. A secondary stuck before listen is left out after 10 s.
+        std::vector<void *> contexts;
+        {
+            std::unique_lock<std::mutex> lock(group->mutex);
+            group->ready.wait_for(lock, std::chrono::seconds(10), [&] { return group->settled >= isolates - 1; });
+            group->serving = true;
+            if ((int)group->members.size() < isolates) {
+                std::cerr << "[FSK] " << group->members.size() << "/" << isolates << " isolates ready, serving with those." << std::endl;
+            }
+            contexts.assign(group->members.begin(), group->members.end());
+        }
+        fsk_start_server_isolates((uint16_t)port, &options, contexts.data(), contexts.size());
         return Value(true);
       });
+
+  // FSK.route("GET", "/users/:id", (req, res) => {...}): matched natively by fsk-core
+  // before the request reaches the interpreter; parameters land in req.params.
+  // Patterns take `:name` segments and a trailing `*name`; method "ALL" matches any.
+  fskInstance->fields["route"] = std::make_shared<NativeFunction>(
+      3, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1]) ||
+            !std::holds_alternative<std::shared_ptr<Callable>>(args[2])) {
+            throw std::runtime_error("route attend (méthode, chemin, handler).");
+        }
+        std::string method = std::get<std::string>(args[0]);
+        std::transform(method.begin(), method.end(), method.begin(), ::toupper);
+        interp.httpRoutes.routes.push_back({method, std::get<std::string>(args[1]), std::get<std::shared_ptr<Callable>>(args[2])});
+        return Value(true);
+      });
+
+  // FSK.use([prefix,] (req, res, next) => {...}): runs before the handler for every
+  // path under prefix (default "/"), in registration order. Answers replayed by
+  // res.cache() do not run it: cache only what every client may see.
+  fskInstance->fields["use"] = std::make_shared<NativeFunction>(
+      -1, [](Interpreter &interp, std::vector<Value> args) {
+        std::string prefix = "/";
+        size_t fn = 0;
+        if (args.size() > 1 && std::holds_alternative<std::string>(args[0])) {
+            prefix = std::get<std::string>(args[0]);
+            fn = 1;
+        }
+        if (args.size() <= fn || !std::holds_alternative<std::shared_ptr<Callable>>(args[fn])) {
+            throw std::runtime_error("use attend une fonction middleware.");
+        }
+        interp.httpRoutes.middleware.push_back({prefix, std::get<std::shared_ptr<Callable>>(args[fn])});
+        return Value(true);
+      });
+
+  // FSK.static("/assets", "public"): files under the directory are answered by
+  // fsk-core (ETag, 304, Range, cached contents) without entering the interpreter.
+  // Paths with no file behind them fall through to the routes.
+  fskInstance->fields["static"] = std::make_shared<NativeFunction>(
+      2, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+            throw std::runtime_error("static attend (préfixe, dossier).");
+        }
+        interp.httpRoutes.statics.emplace_back(std::get<std::string>(args[0]), std::get<std::string>(args[1]));
+        return Value(true);
+      });
+
+  // FSK.cachePurge("/users/42"), FSK.cachePurge("/users/*") or FSK.cachePurge("*"):
+  // drops res.cache() entries for a path, a prefix or everything. Returns how many went.
+  fskInstance->fields["cachePurge"] = std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) {
+        if (!std::holds_alternative<std::string>(args[0])) {
+            throw std::runtime_error("cachePurge attend un chemin (string).");
+        }
+        return Value((double)fsk_http_cache_purge(std::get<std::string>(args[0]).c_str()));
+      });
+
+  // FSK.httpStats(): one object per server in this process with its admission
+  // counters (inFlight, admitted, rejected by reason, queued, loopLagMs) and limits.
+  fskInstance->fields["httpStats"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        char *raw = fsk_http_stats();
+        std::string stats(raw);
+        fsk_free_string(raw);
+        return interp.jsonParse(stats);
+      });
+
+  fskInstance->fields["isolateId"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+        return Value((double)interp.isolateId);
+      });
 #endif
 
   fskInstance->fields["shell"] = std::make_shared<NativeFunction>(
@@ -726,22 +1307,304 @@ Interpreter::Interpreter() {
       });
    fskInstance->fields["E"] = Value(2.71828182845904523536);
 
+  return fskInstance;
+}
+
+// Payload of a WebSocket frame: strings go out as text frames, SharedBuffers
+// and typed views as binary frames over their raw memory.
+struct WsPayload {
+   const uint8_t *data;
+   size_t len;
+   bool binary;
+};
+
+static WsPayload wsPayloadOf(const Value &value, std::string &scratch) {
+   if (auto text = std::get_if<std::string>(&value)) return {reinterpret_cast<const uint8_t *>(text->data()), text->size(), false};
+   if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value)) {
+       if (auto buffer = std::dynamic_pointer_cast<FSKSharedBuffer>(*inst)) return {buffer->memory->bytes, buffer->memory->byteLength, true};
+       if (auto view = std::dynamic_pointer_cast<FSKTypedView>(*inst)) {
+           return {view->memory->bytes + view->byteOffset, view->length * FSKTypedView::elementSize(view->kind), true};
+       }
+   }
+   scratch = Interpreter::stringify(value);
+   return {reinterpret_cast<const uint8_t *>(scratch.data()), scratch.size(), false};
+}
+
+static uint32_t wsIdOf(const Value &value, const char *who) {
+   if (!std::holds_alternative<double>(value)) throw std::runtime_error(std::string(who) + " attend l'id d'une WebSocket.");
+   return (uint32_t)std::get<double>(value);
+}
+
+static Value wsStatsOf(Interpreter &interp, uint32_t wsId) {
+   char *raw = fsk_ws_stats(wsId);
+   if (!raw) return Value(std::monostate{});
+   std::string stats(raw);
+   fsk_free_string(raw);
+   return interp.jsonParse(stats);
+}
+
+static std::string wsRoomOf(const Value &value, const char *who) {
+   if (!std::holds_alternative<std::string>(value)) throw std::runtime_error(std::string(who) + " attend un nom de salle (chaîne).");
+   return std::get<std::string>(value);
+}
+
+// A received frame as the script sees it: text as a string, binary as a
+// SharedBuffer over a copy of the bytes.
+static Value wsMessageValue(std::string bytes, bool binary) {
+   if (!binary) return Value(std::move(bytes));
+   auto memory = std::make_shared<SharedMemory>(bytes.size());
+   std::memcpy(memory->bytes, bytes.data(), bytes.size());
+   return Value(std::static_pointer_cast<FSKInstance>(makeSharedBuffer(memory)));
+}
+
+#ifndef __EMSCRIPTEN__
+// A WS.connect socket. easywsclient is not thread-safe, so one thread owns it:
+// it sends what the script queued, polls (every 10 ms when idle) and keeps what
+// arrived for WS.poll, or hands it to a pending WS.recv through the loop.
+struct WsClient {
+   Interpreter *interp;
+   std::mutex mutex; // outbox, closing, inbox, closed, waiters
+   std::vector<std::pair<std::string, bool>> outbox;
+   bool closing = false;
+   std::deque<std::pair<std::string, bool>> inbox;
+   bool closed = false;
+   size_t waiters = 0;
+
+   std::deque<std::shared_ptr<FSKPromise>> waiting; // loop thread only
+};
+
+// Client ids start at 2^31, so WS.send can tell them from server socket ids.
+static std::mutex wsClientsMutex;
+static std::map<uint32_t, std::shared_ptr<WsClient>> wsClients;
+static uint32_t nextWsClientId = 0x80000000u;
+
+static std::shared_ptr<WsClient> wsClientOf(uint32_t id) {
+   std::lock_guard<std::mutex> lock(wsClientsMutex);
+   auto it = wsClients.find(id);
+   return it == wsClients.end() ? nullptr : it->second;
+}
+
+// Loop thread: settles pending WS.recv calls in order, with nil once closed.
+static void wsClientDeliver(WsClient &client) {
+   Interpreter &interp = *client.interp;
+   while (!client.waiting.empty()) {
+       Value message;
+       {
+           std::lock_guard<std::mutex> lock(client.mutex);
+           if (!client.inbox.empty()) {
+               auto [bytes, binary] = std::move(client.inbox.front());
+               client.inbox.pop_front();
+               message = wsMessageValue(std::move(bytes), binary);
+           } else if (!client.closed) {
+               return;
+           }
+           client.waiters--;
+       }
+       auto promise = client.waiting.front();
+       client.waiting.pop_front();
+       promise->resolve(interp, message);
+       interp.eventLoop->decrementWorkCount();
+   }
+}
+
+static void wsClientRun(std::shared_ptr<WsClient> client, std::unique_ptr<easywsclient::WebSocket> socket) {
+   auto evLoop = client->interp->eventLoop;
+   bool open = true;
+   while (open) {
+       std::vector<std::pair<std::string, bool>> outgoing;
+       bool closing;
+       {
+           std::lock_guard<std::mutex> lock(client->mutex);
+           outgoing.swap(client->outbox);
+           closing = client->closing;
+       }
+       for (auto &[bytes, binary] : outgoing) {
+           if (binary) socket->sendBinary(bytes);
+           else socket->send(bytes);
+       }
+       if (closing && socket->getReadyState() == easywsclient::WebSocket::OPEN) socket->close();
+       socket->poll(10);
+       std::vector<std::pair<std::string, bool>> received;
+       socket->dispatch([&](const std::string &message) { received.emplace_back(message, socket->isBinaryMessage()); });
+       open = socket->getReadyState() != easywsclient::WebSocket::CLOSED;
+       if (received.empty() && open) continue;
+       bool wake;
+       {
+           std::lock_guard<std::mutex> lock(client->mutex);
+           for (auto &message : received) client->inbox.push_back(std::move(message));
+           client->closed = !open;
+           wake = client->waiters > 0;
+       }
+       if (wake) evLoop->post([client]() { wsClientDeliver(*client); });
+   }
+}
+#endif
+
+Value Interpreter::makeWsModule() {
    auto wsNInstance = std::make_shared<FSKInstance>(std::make_shared<FSKClass>("WS", nullptr, std::map<std::string, std::shared_ptr<Callable>>()));
-   wsNInstance->fields["listen"] = std::make_shared<NativeFunction>(2, [](Interpreter &interp, std::vector<Value> args) {
-       if (!std::holds_alternative<double>(args[0])) throw std::runtime_error("WS.listen requires port");
+   // WS.listen(port, handler, options?). Each socket queues at most maxQueue
+   // frames; past that onFull decides: "dropOldest" (default), "disconnect", or
+   // "block" the sender for up to blockTimeout ms, then disconnect. Messages
+   // that arrive together are delivered in one loop task, up to maxBatch per
+   // socket; with `batch: true` the handler gets (ws, [messages]) instead.
+   // Text frames arrive as strings, binary frames as SharedBuffers.
+   wsNInstance->fields["listen"] = std::make_shared<NativeFunction>(-1, [](Interpreter &interp, std::vector<Value> args) {
+       if (args.size() < 2 || !std::holds_alternative<double>(args[0])) throw std::runtime_error("WS.listen requires port");
        int port = (int)std::get<double>(args[0]);
+       FskWsOptions options{1024, FskWsDropOldest, 5000, 64};
+       if (args.size() > 2) {
+           if (auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&args[2])) {
+               auto field = [&](const char *name) -> const Value * {
+                   auto it = (*opts)->fields.find(name);
+                   return it == (*opts)->fields.end() ? nullptr : &it->second;
+               };
+               auto number = [&](const char *name) -> std::optional<double> {
+                   auto value = field(name);
+                   if (!value || !std::holds_alternative<double>(*value)) return std::nullopt;
+                   return std::get<double>(*value);
+               };
+               if (auto n = number("maxQueue")) options.max_queue = (uint32_t)std::clamp(*n, 0.0, 4294967295.0);
+               if (auto n = number("blockTimeout")) options.block_timeout_ms = (uint64_t)std::max(0.0, *n);
+               if (auto n = number("maxBatch")) options.max_batch = (uint32_t)std::clamp(*n, 1.0, 65536.0);
+               if (auto onFull = field("onFull")) {
+                   std::string policy = std::holds_alternative<std::string>(*onFull) ? std::get<std::string>(*onFull) : "";
+                   if (policy == "dropOldest") options.overflow = FskWsDropOldest;
+                   else if (policy == "disconnect") options.overflow = FskWsDisconnect;
+                   else if (policy == "block") options.overflow = FskWsBlock;
+                   else throw std::runtime_error("WS.listen : onFull attend \"dropOldest\", \"disconnect\" ou \"block\".");
+               }
+               if (auto batch = field("batch")) interp.wsBatch = std::holds_alternative<bool>(*batch) && std::get<bool>(*batch);
+           }
+       }
        interp.globals->define("onWsMessage", args[1]);
        interp.eventLoop->incrementWorkCount();
-       std::thread([port, &interp]() {
-           fsk_ws_listen((uint16_t)port, fsk_on_ws_message, &interp);
-       }).detach();
+       fsk_ws_listen((uint16_t)port, &options, fsk_on_ws_message, &interp);
        return Value(true);
    });
-   
-   globals->define("WS", wsNInstance);
 
-  globals->define("FSK", fskInstance);
+   // WS.send(id, msg): false once the socket is closed. `id` is a server
+   // socket's or one returned by WS.connect.
+   wsNInstance->fields["send"] = std::make_shared<NativeFunction>(2, [](Interpreter &, std::vector<Value> args) {
+       uint32_t id = wsIdOf(args[0], "WS.send");
+       std::string scratch;
+       auto payload = wsPayloadOf(args[1], scratch);
+#ifndef __EMSCRIPTEN__
+       if (auto client = wsClientOf(id)) {
+           std::lock_guard<std::mutex> lock(client->mutex);
+           if (client->closed || client->closing) return Value(false);
+           client->outbox.emplace_back(std::string(reinterpret_cast<const char *>(payload.data), payload.len), payload.binary);
+           return Value(true);
+       }
+#endif
+       return Value(fsk_ws_send_bytes(id, payload.data, payload.len, payload.binary));
+   });
+
+   // Rooms live in the server core: WS.publish encodes the frame once and
+   // queues it on every member without a round trip through the script.
+   wsNInstance->fields["join"] = std::make_shared<NativeFunction>(2, [](Interpreter &, std::vector<Value> args) {
+       return Value(fsk_ws_join(wsIdOf(args[0], "WS.join"), wsRoomOf(args[1], "WS.join").c_str()));
+   });
+
+   wsNInstance->fields["leave"] = std::make_shared<NativeFunction>(2, [](Interpreter &, std::vector<Value> args) {
+       return Value(fsk_ws_leave(wsIdOf(args[0], "WS.leave"), wsRoomOf(args[1], "WS.leave").c_str()));
+   });
+
+   // WS.publish(room, msg, exceptId?): number of sockets the message was queued on.
+   wsNInstance->fields["publish"] = std::make_shared<NativeFunction>(-1, [](Interpreter &, std::vector<Value> args) {
+       if (args.size() < 2) throw std::runtime_error("WS.publish attend une salle et un message.");
+       std::string room = wsRoomOf(args[0], "WS.publish");
+       uint32_t except = args.size() > 2 && !std::holds_alternative<std::monostate>(args[2]) ? wsIdOf(args[2], "WS.publish") : 0;
+       std::string scratch;
+       auto payload = wsPayloadOf(args[1], scratch);
+       return Value((double)fsk_ws_publish(room.c_str(), payload.data, payload.len, payload.binary, except));
+   });
+
+   wsNInstance->fields["roomSize"] = std::make_shared<NativeFunction>(1, [](Interpreter &, std::vector<Value> args) {
+       return Value((double)fsk_ws_room_size(wsRoomOf(args[0], "WS.roomSize").c_str()));
+   });
+
+   // WS.stats(id): {queued, peakQueued, maxQueue, onFull, sent, dropped,
+   // received, batches} for an open socket, nil once it is closed.
+   wsNInstance->fields["stats"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+       return wsStatsOf(interp, wsIdOf(args[0], "WS.stats"));
+   });
+
+#ifndef __EMSCRIPTEN__
+   // WS.connect(url): id of a client socket, -1 if the connection failed. It
+   // takes WS.send(id, msg) and WS.close(id); what arrives is read with
+   // WS.poll(id) (everything so far) or WS.recv(id) (a Promise of the next one).
+   wsNInstance->fields["connect"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+       if (!std::holds_alternative<std::string>(args[0])) throw std::runtime_error("WS.connect attend une URL ws:// (chaîne).");
+       std::unique_ptr<easywsclient::WebSocket> socket(easywsclient::WebSocket::from_url(std::get<std::string>(args[0])));
+       if (!socket) return Value(-1.0);
+       auto client = std::make_shared<WsClient>();
+       client->interp = &interp;
+       uint32_t id;
+       {
+           std::lock_guard<std::mutex> lock(wsClientsMutex);
+           id = nextWsClientId++;
+           wsClients[id] = client;
+       }
+       std::thread(wsClientRun, client, std::move(socket)).detach();
+       return Value((double)id);
+   });
+
+   // WS.poll(id): messages received since the last poll, oldest first.
+   wsNInstance->fields["poll"] = std::make_shared<NativeFunction>(1, [](Interpreter &, std::vector<Value> args) -> Value {
+       auto messages = std::make_shared<FSKArray>(std::vector<Value>{});
+       auto client = wsClientOf(wsIdOf(args[0], "WS.poll"));
+       if (!client) return Value(messages);
+       std::lock_guard<std::mutex> lock(client->mutex);
+       // Pending WS.recv calls come first.
+       while (client->inbox.size() > client->waiters) {
+           auto [bytes, binary] = std::move(client->inbox.front());
+           client->inbox.pop_front();
+           messages->elements.push_back(wsMessageValue(std::move(bytes), binary));
+       }
+       return Value(messages);
+   });
 
+   // WS.recv(id) -> Promise of the next message, nil once the socket is closed.
+   wsNInstance->fields["recv"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+       auto promise = interp.makePromise();
+       auto client = wsClientOf(wsIdOf(args[0], "WS.recv"));
+       if (!client) {
+           promise->resolve(interp, Value(std::monostate{}));
+           return Value(std::static_pointer_cast<FSKInstance>(promise));
+       }
+       client->waiting.push_back(promise);
+       interp.eventLoop->incrementWorkCount();
+       bool ready;
+       {
+           std::lock_guard<std::mutex> lock(client->mutex);
+           client->waiters++;
+           ready = client->inbox.size() >= client->waiters || client->closed;
+       }
+       if (ready) wsClientDeliver(*client);
+       return Value(std::static_pointer_cast<FSKInstance>(promise));
+   });
+
+   // WS.close(id): pending WS.recv calls get nil once the socket has closed.
+   wsNInstance->fields["close"] = std::make_shared<NativeFunction>(1, [](Interpreter &, std::vector<Value> args) -> Value {
+       uint32_t id = wsIdOf(args[0], "WS.close");
+       std::shared_ptr<WsClient> client;
+       {
+           std::lock_guard<std::mutex> lock(wsClientsMutex);
+           auto it = wsClients.find(id);
+           if (it == wsClients.end()) return Value(false);
+           client = it->second;
+           wsClients.erase(it);
+       }
+       std::lock_guard<std::mutex> lock(client->mutex);
+       client->closing = true;
+       return Value(true);
+   });
+#endif
+
+  return wsNInstance;
+}
+
+Value Interpreter::makeFfiModule() {
    auto ffiClass = std::make_shared<FSKClass>("FFI", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
    auto ffiInstance = std::make_shared<FSKInstance>(ffiClass);
 
@@ -846,9 +1709,10 @@ Interpreter::Interpreter() {
        return Value(libInst);
    });
 
-   globals->define("FFI", ffiInstance);
-
+  return ffiInstance;
+}
 
+Value Interpreter::makeConsoleModule() {
   auto consoleClass = std::make_shared<FSKClass>("Console", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto consoleInstance = std::make_shared<FSKInstance>(consoleClass);
   
@@ -883,8 +1747,10 @@ Interpreter::Interpreter() {
       return Value(true);
   });
 
-  globals->define("Console", consoleInstance);
+  return consoleInstance;
+}
 
+Value Interpreter::makeSqlModule() {
    auto sqlClass = std::make_shared<FSKClass>("SQL", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
    auto sqlInstance = std::make_shared<FSKInstance>(sqlClass);
 
@@ -901,8 +1767,10 @@ Interpreter::Interpreter() {
       return interp.jsonParse(result);
    });
 
-   globals->define("SQL", sqlInstance);
+  return sqlInstance;
+}
 
+Value Interpreter::makeSystemModule() {
    auto systemClass = std::make_shared<FSKClass>("System", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
    auto systemInstance = std::make_shared<FSKInstance>(systemClass);
    systemInstance->fields["getInfo"] = std::make_shared<NativeFunction>(0, [](Interpreter &interp, std::vector<Value> args) {
@@ -911,9 +1779,11 @@ Interpreter::Interpreter() {
       fsk_free_string(res);
       return interp.jsonParse(result);
    });
-   globals->define("System", systemInstance);
 
+  return systemInstance;
+}
 
+Value Interpreter::makeVmModule() {
    auto vmClass = std::make_shared<FSKClass>("VM", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
    auto vmInstance = std::make_shared<FSKInstance>(vmClass);
 
@@ -961,8 +1831,11 @@ Interpreter::Interpreter() {
         fsk_vm_run(bytecode.data(), bytecode.size(), jsonStr.c_str());
         return Value(true);
    });
-   globals->define("VM", vmInstance);
 
+  return vmInstance;
+}
+
+Value Interpreter::makeJsonModule() {
   auto jsonClass = std::make_shared<FSKClass>("JSON", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto jsonInstance = std::make_shared<FSKInstance>(jsonClass);
 
@@ -983,8 +1856,10 @@ Interpreter::Interpreter() {
       }
   });
 
-  globals->define("JSON", jsonInstance);
+  return jsonInstance;
+}
 
+Value Interpreter::makeAudioModule() {
   auto audioClass = std::make_shared<FSKClass>("Audio", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto audioInstance = std::make_shared<FSKInstance>(audioClass);
 
@@ -1037,8 +1912,10 @@ Interpreter::Interpreter() {
       return Value(true);
   });
 
-  globals->define("Audio", audioInstance);
+  return audioInstance;
+}
 
+Value Interpreter::makeGraphicsModule() {
   auto gfxClass = std::make_shared<FSKClass>("Graphics", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto gfxInstance = std::make_shared<FSKInstance>(gfxClass);
 
@@ -1115,8 +1992,10 @@ Interpreter::Interpreter() {
       return Value(true);
   });
 
-   globals->define("Graphics", gfxInstance);
+  return gfxInstance;
+}
 
+Value Interpreter::makeCryptoModule() {
    auto cryptoClass = std::make_shared<FSKClass>("Crypto", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto cryptoInstance = std::make_shared<FSKInstance>(cryptoClass);
 
@@ -1129,36 +2008,6 @@ Interpreter::Interpreter() {
          return Value(result);
        });
 
-  auto mathClass = std::make_shared<FSKClass>("Math", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-  auto mathInstance = std::make_shared<FSKInstance>(mathClass);
-  mathInstance->fields["PI"] = 3.14159265358979323846;
-  mathInstance->fields["E"] = 2.71828182845904523536;
-  
-  mathInstance->fields["sin"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
-      return Value(std::sin(std::get<double>(args[0])));
-  });
-  mathInstance->fields["cos"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
-      return Value(std::cos(std::get<double>(args[0])));
-  });
-  mathInstance->fields["sqrt"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
-      return Value(std::sqrt(std::get<double>(args[0])));
-  });
-  mathInstance->fields["abs"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
-      return Value(std::abs(std::get<double>(args[0])));
-  });
-  mathInstance->fields["pow"] = std::make_shared<NativeFunction>(2, [](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<double>(args[0]) || !std::holds_alternative<double>(args[1])) return Value(0.0);
-      return Value(std::pow(std::get<double>(args[0]), std::get<double>(args[1])));
-  });
-
-  globals->define("Math", mathInstance);
-
-
-
    cryptoInstance->fields["md5"] = std::make_shared<NativeFunction>(
        1, [](Interpreter &interp, std::vector<Value> args) {
          if (!std::holds_alternative<std::string>(args[0])) return Value(std::string(""));
@@ -1212,8 +2061,40 @@ Interpreter::Interpreter() {
 #endif
     });
 
-  globals->define("Crypto", cryptoInstance);
+  return cryptoInstance;
+}
+
+Value Interpreter::makeMathModule() {
+  auto mathClass = std::make_shared<FSKClass>("Math", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+  auto mathInstance = std::make_shared<FSKInstance>(mathClass);
+  mathInstance->fields["PI"] = 3.14159265358979323846;
+  mathInstance->fields["E"] = 2.71828182845904523536;
+  
+  mathInstance->fields["sin"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
+      return Value(std::sin(std::get<double>(args[0])));
+  });
+  mathInstance->fields["cos"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
+      return Value(std::cos(std::get<double>(args[0])));
+  });
+  mathInstance->fields["sqrt"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
+      return Value(std::sqrt(std::get<double>(args[0])));
+  });
+  mathInstance->fields["abs"] = std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0])) return Value(0.0);
+      return Value(std::abs(std::get<double>(args[0])));
+  });
+  mathInstance->fields["pow"] = std::make_shared<NativeFunction>(2, [](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<double>(args[0]) || !std::holds_alternative<double>(args[1])) return Value(0.0);
+      return Value(std::pow(std::get<double>(args[0]), std::get<double>(args[1])));
+  });
+
+  return mathInstance;
+}
 
+Value Interpreter::makeDateModule() {
   auto dateClass = std::make_shared<FSKClass>("Date", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto dateInstance = std::make_shared<FSKInstance>(dateClass);
 
@@ -1237,8 +2118,10 @@ Interpreter::Interpreter() {
       return Value(ss.str());
   });
 
-  globals->define("Date", dateInstance);
+  return dateInstance;
+}
 
+Value Interpreter::makeFsModule() {
   auto fsClass = std::make_shared<FSKClass>("FS", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto fsInstance = std::make_shared<FSKInstance>(fsClass);
 
@@ -1442,46 +2325,46 @@ Interpreter::Interpreter() {
       } catch(...) { return Value(std::monostate{}); }
   });
 
-  globals->define("FS", fsInstance);
-
+  return fsInstance;
+}
 
+Value Interpreter::makeWorkerModule() {
   auto workerHandleClass = std::make_shared<FSKClass>("WorkerHandle", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   
   auto workerFactoryClass = std::make_shared<FSKClass>("WorkerFactory", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto workerFactory = std::make_shared<FSKInstance>(workerFactoryClass);
 
-  workerFactory->fields["init"] = std::make_shared<NativeFunction>(1, [workerHandleClass](Interpreter &interp, std::vector<Value> args) {
-      if (!std::holds_alternative<std::string>(args[0])) return Value(std::monostate{});
+  // Worker.init(script, {capacity: n, block: bool}): capacity bounds both message
+  // queues (0 = unbounded). When full, postMessage returns false; block: true makes
+  // it wait instead, which deadlocks if the worker is itself waiting on its replies.
+  workerFactory->fields["init"] = std::make_shared<NativeFunction>(-1, [workerHandleClass](Interpreter &interp, std::vector<Value> args) {
+      if (args.empty() || !std::holds_alternative<std::string>(args[0])) return Value(std::monostate{});
       std::string scriptPath = std::get<std::string>(args[0]);
+
+      size_t capacity = 0;
+      bool blocking = false;
+      if (args.size() > 1) {
+          if (auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&args[1])) {
+              auto &fields = (*opts)->fields;
+              if (fields.count("capacity") && std::holds_alternative<double>(fields["capacity"]) && std::get<double>(fields["capacity"]) > 0) {
+                  capacity = (size_t)std::get<double>(fields["capacity"]);
+              }
+              if (fields.count("block") && std::holds_alternative<bool>(fields["block"])) {
+                  blocking = std::get<bool>(fields["block"]);
+              }
+          }
+      }
       
       auto resource = std::make_shared<WorkerResource>();
-      resource->incoming = std::make_shared<ThreadSafeQueue<std::string>>();
-      resource->outgoing = std::make_shared<ThreadSafeQueue<std::string>>();
+      resource->incoming = std::make_shared<ThreadSafeQueue<ClonedMessage>>(capacity);
+      resource->outgoing = std::make_shared<ThreadSafeQueue<ClonedMessage>>(capacity);
+      resource->blocking = blocking;
       
+      // Workers live until terminated, so they keep a dedicated thread rather than pinning an I/O pool slot.
       resource->thread = std::make_shared<std::thread>([scriptPath, resource]() {
-          std::string source;
-          try {
-              std::ifstream t(scriptPath);
-              std::stringstream buffer;
-              buffer << t.rdbuf();
-              source = buffer.str();
-          } catch (...) { return; }
-
-          Lexer lexer(source);
-          std::vector<Token> tokens = lexer.scanTokens();
-          Parser parser(tokens);
-          std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
-          
-          Interpreter workerInterp;
-          workerInterp.isWorker = true;
-          workerInterp.workerIncoming = resource->incoming;
-          workerInterp.workerOutgoing = resource->outgoing;
-          
-          try {
-             workerInterp.interpret(statements);
-          } catch(...) {}
+          runWorkerScript(scriptPath, resource);
       });
-      resource->thread->detach(); 
+      resource->thread->detach();
       
       int id = interp.workerIdCounter++;
       interp.workers[id] = resource;
@@ -1489,25 +2372,33 @@ Interpreter::Interpreter() {
       auto instance = std::make_shared<FSKInstance>(workerHandleClass);
       instance->fields["id"] = Value((double)id);
       
-      instance->fields["postMessage"] = std::make_shared<NativeFunction>(1, [id](Interpreter &interp, std::vector<Value> args) {
+      instance->fields["postMessage"] = std::make_shared<NativeFunction>(-1, [id](Interpreter &interp, std::vector<Value> args) {
+          if (args.empty()) throw std::runtime_error("postMessage attend un message.");
           if (interp.workers.find(id) == interp.workers.end()) return Value(false);
-          std::string msg = stringify(args[0]);
-          interp.workers[id]->incoming->push(msg);
-          return Value(true);
+          bool transfer = args.size() > 1 && std::holds_alternative<bool>(args[1]) && std::get<bool>(args[1]);
+          auto &resource = interp.workers[id];
+          auto message = ClonedMessage::fromValue(std::move(args[0]), transfer);
+          return Value(resource->blocking ? resource->incoming->push(std::move(message)) : resource->incoming->tryPush(message));
       });
       
-      instance->fields["poll"] = std::make_shared<NativeFunction>(0, [id](Interpreter &interp, std::vector<Value> args) {
+      instance->fields["poll"] = std::make_shared<NativeFunction>(-1, [id](Interpreter &interp, std::vector<Value> args) {
           if (interp.workers.find(id) == interp.workers.end()) return Value(std::make_shared<FSKArray>(std::vector<Value>{}));
           std::vector<Value> msgs;
-          while (auto msg = interp.workers[id]->outgoing->pop(false)) {
-              msgs.push_back(Value(*msg));
+          for (auto &msg : popMessages(*interp.workers[id]->outgoing, args)) {
+              msgs.push_back(msg.toValue());
           }
           return Value(std::make_shared<FSKArray>(msgs));
       });
 
+      instance->fields["pending"] = std::make_shared<NativeFunction>(0, [id](Interpreter &interp, std::vector<Value> args) {
+          if (interp.workers.find(id) == interp.workers.end()) return Value(0.0);
+          return Value((double)interp.workers[id]->incoming->size());
+      });
+
       instance->fields["terminate"] = std::make_shared<NativeFunction>(0, [id](Interpreter &interp, std::vector<Value> args) {
           if (interp.workers.find(id) != interp.workers.end()) {
               interp.workers[id]->incoming->close();
+              interp.workers[id]->outgoing->close();
               interp.workers.erase(id);
           }
           return Value(true);
@@ -1516,25 +2407,61 @@ Interpreter::Interpreter() {
       return Value(instance);
   });
 
-  globals->define("Worker", workerFactory);
+  auto workerPoolClass = std::make_shared<FSKClass>("WorkerPool", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
 
-  globals->define("workerPostMessage", std::make_shared<NativeFunction>(1, [](Interpreter &interp, std::vector<Value> args) {
-      if (!interp.isWorker) return Value(false);
-      std::string msg = stringify(args[0]);
-      interp.workerOutgoing->push(msg);
-      return Value(true);
-  }));
-
-  globals->define("workerPoll", std::make_shared<NativeFunction>(0, [](Interpreter &interp, std::vector<Value> args) {
-      if (!interp.isWorker) return Value(std::make_shared<FSKArray>(std::vector<Value>{}));
-      std::vector<Value> msgs;
-      while (auto msg = interp.workerIncoming->pop(false)) {
-          msgs.push_back(Value(*msg));
+  workerFactory->fields["pool"] = std::make_shared<NativeFunction>(2, [workerPoolClass](Interpreter &interp, std::vector<Value> args) {
+      if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<double>(args[1])) {
+          throw std::runtime_error("Worker.pool attend (script, taille).");
       }
-      return Value(std::make_shared<FSKArray>(msgs));
-      return Value(std::make_shared<FSKArray>(msgs));
-  }));
+      int size = (int)std::get<double>(args[1]);
+      if (size < 1) throw std::runtime_error("Worker.pool attend une taille >= 1.");
+      auto pool = std::make_shared<WorkerPool>(std::get<std::string>(args[0]), (size_t)size);
+
+      auto instance = std::make_shared<FSKInstance>(workerPoolClass);
+      instance->fields["size"] = Value((double)size);
+
+      instance->fields["run"] = std::make_shared<NativeFunction>(1, [pool](Interpreter &interp, std::vector<Value> args) {
+          auto promise = interp.makePromise();
+          auto evLoop = interp.eventLoop;
+          // The result is posted to this thread, so counting the job after it is
+          // accepted still comes before its decrement.
+          bool queued = pool->submit({ClonedMessage::fromValue(std::move(args[0])), [&interp, evLoop, promise](bool ok, ClonedMessage result) {
+              auto message = std::make_shared<ClonedMessage>(std::move(result));
+              evLoop->post([&interp, evLoop, promise, ok, message]() {
+                  if (ok) promise->resolve(interp, message->toValue());
+                  else promise->reject(interp, message->toValue());
+                  evLoop->decrementWorkCount();
+              });
+          }});
+          if (queued) evLoop->incrementWorkCount();
+          else promise->reject(interp, Value(std::string("WorkerPool fermé")));
+          return Value(std::static_pointer_cast<FSKInstance>(promise));
+      });
 
+      instance->fields["stats"] = std::make_shared<NativeFunction>(0, [pool](Interpreter &interp, std::vector<Value> args) {
+          static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+          auto stats = pool->stats();
+          auto obj = std::make_shared<FSKInstance>(objClass);
+          obj->fields["size"] = Value((double)stats.size);
+          obj->fields["idle"] = Value((double)stats.idle);
+          obj->fields["queued"] = Value((double)stats.queued);
+          obj->fields["completed"] = Value((double)stats.completed);
+          obj->fields["stolen"] = Value((double)stats.stolen);
+          return Value(obj);
+      });
+
+      instance->fields["close"] = std::make_shared<NativeFunction>(0, [pool](Interpreter &interp, std::vector<Value> args) {
+          pool->close();
+          return Value(true);
+      });
+
+      return Value(instance);
+  });
+
+  return workerFactory;
+}
+
+Value Interpreter::makeTaskModule() {
   auto taskClass = std::make_shared<FSKClass>("Task", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto taskFactory = std::make_shared<FSKInstance>(taskClass);
 
@@ -1543,33 +2470,15 @@ Interpreter::Interpreter() {
       std::string scriptPath = std::get<std::string>(args[0]);
       
       auto resource = std::make_shared<WorkerResource>();
-      resource->incoming = std::make_shared<ThreadSafeQueue<std::string>>();
-      resource->outgoing = std::make_shared<ThreadSafeQueue<std::string>>();
+      resource->incoming = std::make_shared<ThreadSafeQueue<ClonedMessage>>();
+      resource->outgoing = std::make_shared<ThreadSafeQueue<ClonedMessage>>();
       
+      // A task script may run for as long as it likes: on the shared I/O pool it
+      // would hold a slot that FSK.fetch (or the task's own fetches) waits for.
       resource->thread = std::make_shared<std::thread>([scriptPath, resource]() {
-          std::string source;
-          try {
-              std::ifstream t(scriptPath);
-              std::stringstream buffer;
-              buffer << t.rdbuf();
-              source = buffer.str();
-          } catch (...) { return; }
-
-          Lexer lexer(source);
-          std::vector<Token> tokens = lexer.scanTokens();
-          Parser parser(tokens);
-          std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
-          
-          Interpreter workerInterp;
-          workerInterp.isWorker = true;
-          workerInterp.workerIncoming = resource->incoming;
-          workerInterp.workerOutgoing = resource->outgoing;
-          
-          try {
-             workerInterp.interpret(statements);
-          } catch(...) {}
+          runWorkerScript(scriptPath, resource);
       });
-      resource->thread->detach(); 
+      resource->thread->detach();
       
       int id = interp.workerIdCounter++;
       interp.workers[id] = resource;
@@ -1583,7 +2492,7 @@ Interpreter::Interpreter() {
           auto msg = interp.workers[id]->outgoing->pop(true); // Blocking pop
           Value result = std::monostate{};
           if (msg) {
-              result = Value(*msg); 
+              result = msg->toValue();
           }
           
           interp.workers[id]->incoming->close();
@@ -1595,8 +2504,73 @@ Interpreter::Interpreter() {
       return Value(instance);
   });
 
-  globals->define("Task", taskFactory);
+  return taskFactory;
+}
+
+Value Interpreter::makeAtomicsModule() {
+  auto atomicsClass = std::make_shared<FSKClass>("Atomics", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+  auto atomicsInstance = std::make_shared<FSKInstance>(atomicsClass);
+
+  // Every Atomics.* call takes (view, index, ...); this unpacks and checks the first two.
+  auto atomicTarget = [](const std::vector<Value> &args, const char *name) {
+      std::shared_ptr<FSKTypedView> view;
+      if (!args.empty()) {
+          if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&args[0])) view = std::dynamic_pointer_cast<FSKTypedView>(*inst);
+      }
+      if (!view || args.size() < 2 || !std::holds_alternative<double>(args[1]) || std::get<double>(args[1]) < 0) {
+          throw std::runtime_error(std::string("Atomics.") + name + " attend (vue, index, ...).");
+      }
+      return std::make_pair(view, (size_t)std::get<double>(args[1]));
+  };
+  auto numberArg = [](const std::vector<Value> &args, size_t i, const char *name) {
+      if (i >= args.size() || !std::holds_alternative<double>(args[i])) {
+          throw std::runtime_error(std::string("Atomics.") + name + " attend une valeur numérique.");
+      }
+      return std::get<double>(args[i]);
+  };
+
+  atomicsInstance->fields["load"] = std::make_shared<NativeFunction>(2, [atomicTarget](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "load");
+      return Value(view->load(index));
+  });
+  atomicsInstance->fields["store"] = std::make_shared<NativeFunction>(3, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "store");
+      double value = numberArg(args, 2, "store");
+      view->exchange(index, value);
+      return Value(value);
+  });
+  atomicsInstance->fields["add"] = std::make_shared<NativeFunction>(3, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "add");
+      return Value(view->fetchAdd(index, numberArg(args, 2, "add")));
+  });
+  atomicsInstance->fields["sub"] = std::make_shared<NativeFunction>(3, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "sub");
+      return Value(view->fetchAdd(index, -numberArg(args, 2, "sub")));
+  });
+  atomicsInstance->fields["exchange"] = std::make_shared<NativeFunction>(3, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "exchange");
+      return Value(view->exchange(index, numberArg(args, 2, "exchange")));
+  });
+  atomicsInstance->fields["compareExchange"] = std::make_shared<NativeFunction>(4, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "compareExchange");
+      return Value(view->compareExchange(index, numberArg(args, 2, "compareExchange"), numberArg(args, 3, "compareExchange")));
+  });
+  atomicsInstance->fields["wait"] = std::make_shared<NativeFunction>(-1, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "wait");
+      double expected = numberArg(args, 2, "wait");
+      double timeoutMs = args.size() > 3 ? numberArg(args, 3, "wait") : -1;
+      return Value(view->wait(index, expected, timeoutMs));
+  });
+  atomicsInstance->fields["notify"] = std::make_shared<NativeFunction>(-1, [atomicTarget, numberArg](Interpreter &interp, std::vector<Value> args) {
+      auto [view, index] = atomicTarget(args, "notify");
+      int count = args.size() > 2 ? (int)numberArg(args, 2, "notify") : -1;
+      return Value((double)view->notify(index, count));
+  });
+
+  return atomicsInstance;
+}
 
+Value Interpreter::makeRegexModule() {
   auto regexClass = std::make_shared<FSKClass>("Regex", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto regexInstance = std::make_shared<FSKInstance>(regexClass);
 
@@ -1638,8 +2612,125 @@ Interpreter::Interpreter() {
       } catch(...) { return Value(text); }
   });
 
-  globals->define("Regex", regexInstance);
+  return regexInstance;
+}
+
+#ifndef __EMSCRIPTEN__
+static HttpClient &httpClientOf(Interpreter &interp) {
+  if (!interp.httpClient) interp.httpClient = std::make_shared<HttpClient>();
+  return *interp.httpClient;
+}
+
+// {status, body, headers} for a request that got an answer, nil otherwise.
+static Value httpResponseValue(HttpClient::Response &response) {
+  if (!response.ok) return Value(std::monostate{});
+  static auto respClass = std::make_shared<FSKClass>("HttpResponse", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+  static auto headersClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+  auto respInst = std::make_shared<FSKInstance>(respClass);
+  auto headers = std::make_shared<FSKInstance>(headersClass);
+  for (auto &[name, value] : response.headers) {
+    auto it = headers->fields.find(name);
+    if (it == headers->fields.end()) headers->fields[name] = Value(std::move(value));
+    else it->second = Value(std::get<std::string>(it->second) + ", " + value);
+  }
+  respInst->fields["status"] = Value((double)response.status);
+  respInst->fields["body"] = Value(std::move(response.body));
+  respInst->fields["headers"] = Value(headers);
+  return Value(respInst);
+}
+
+// HTTP.request's argument: a URL, or {url, method, headers, body, timeout}.
+// Non-string bodies are sent as JSON.
+static HttpClient::Request httpRequestOf(Interpreter &interp, const Value &spec) {
+  HttpClient::Request request;
+  if (auto url = std::get_if<std::string>(&spec)) {
+    request.url = *url;
+    return request;
+  }
+  auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&spec);
+  if (!opts) throw std::runtime_error("HTTP.request attend une URL ou un objet {url, method, headers, body}.");
+  auto &fields = (*opts)->fields;
+  auto url = fields.find("url");
+  if (url == fields.end() || !std::holds_alternative<std::string>(url->second)) {
+    throw std::runtime_error("HTTP.request: 'url' manquant.");
+  }
+  request.url = std::get<std::string>(url->second);
+  auto method = fields.find("method");
+  if (method != fields.end() && std::holds_alternative<std::string>(method->second)) {
+    request.method = std::get<std::string>(method->second);
+    std::transform(request.method.begin(), request.method.end(), request.method.begin(), [](unsigned char c) { return (char)std::toupper(c); });
+  }
+  bool hasContentType = false;
+  auto headers = fields.find("headers");
+  if (headers != fields.end()) {
+    if (auto h = std::get_if<std::shared_ptr<FSKInstance>>(&headers->second)) {
+      for (auto &[name, value] : (*h)->fields) {
+        std::string text = std::holds_alternative<std::string>(value) ? std::get<std::string>(value) : interp.stringify(value);
+        request.headers.emplace_back(name, text);
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (lower == "content-type") hasContentType = true;
+      }
+    }
+  }
+  auto body = fields.find("body");
+  if (body != fields.end() && !std::holds_alternative<std::monostate>(body->second)) {
+    if (auto text = std::get_if<std::string>(&body->second)) {
+      request.body = *text;
+    } else {
+      request.body = interp.jsonStringify(body->second);
+      if (!hasContentType) request.headers.emplace_back("Content-Type", "application/json");
+    }
+    if (method == fields.end()) request.method = "POST";
+  }
+  auto timeout = fields.find("timeout");
+  if (timeout != fields.end() && std::holds_alternative<double>(timeout->second)) {
+    request.timeoutMs = (long)std::max(1.0, std::get<double>(timeout->second));
+  }
+  return request;
+}
+
+// Runs `request` on the client's I/O thread and `done` back on the event loop,
+// which stays alive until then.
+static void httpSubmit(Interpreter &interp, HttpClient::Request request,
+                       std::function<void(HttpClient::Response &)> done) {
+  auto evLoop = interp.eventLoop;
+  evLoop->incrementWorkCount();
+  httpClientOf(interp).submit(std::move(request), [evLoop, done = std::move(done)](HttpClient::Response response) {
+    evLoop->post([evLoop, done, response = std::move(response)]() mutable {
+      done(response);
+      evLoop->decrementWorkCount();
+    });
+  });
+}
+
+// HTTP.requestAll: results in list order, at most `limit` requests in flight.
+struct HttpFanOut {
+  std::vector<HttpClient::Request> requests;
+  std::vector<Value> results;
+  size_t next = 0;
+  size_t completed = 0;
+  size_t limit = 0;
+  std::shared_ptr<FSKPromise> promise;
+};
+
+static void httpFanOutNext(Interpreter &interp, std::shared_ptr<HttpFanOut> fanOut) {
+  while (fanOut->next < fanOut->requests.size() && fanOut->next - fanOut->completed < fanOut->limit) {
+    size_t index = fanOut->next++;
+    httpSubmit(interp, std::move(fanOut->requests[index]), [&interp, fanOut, index](HttpClient::Response &response) {
+      fanOut->results[index] = httpResponseValue(response);
+      fanOut->completed++;
+      if (fanOut->completed == fanOut->requests.size()) {
+        fanOut->promise->resolve(interp, Value(std::make_shared<FSKArray>(std::move(fanOut->results))));
+      } else {
+        httpFanOutNext(interp, fanOut);
+      }
+    });
+  }
+}
+#endif
 
+Value Interpreter::makeHttpModule() {
   auto httpClass = std::make_shared<FSKClass>("HTTP", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
   auto httpInstance = std::make_shared<FSKInstance>(httpClass);
 
@@ -1649,38 +2740,10 @@ Interpreter::Interpreter() {
          std::string url = std::get<std::string>(args[0]);
 
 #ifndef __EMSCRIPTEN__
-         CURL *curl;
-         CURLcode res;
-         std::string readBuffer;
-
-         curl = curl_easy_init();
-         if(curl) {
-           curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-           curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](void *contents, size_t size, size_t nmemb, void *userp) -> size_t {
-               ((std::string*)userp)->append((char*)contents, size * nmemb);
-               return size * nmemb;
-           });
-           curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-           // Timeout basic setup
-           curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-           curl_easy_setopt(curl, CURLOPT_USERAGENT, "FSK-Language/1.0");
-
-           res = curl_easy_perform(curl);
-           long response_code = 0;
-           curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-           
-           curl_easy_cleanup(curl);
-
-           if (res == CURLE_OK) {
-                // Return object with status and body
-                auto respClass = std::make_shared<FSKClass>("HttpResponse", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-                auto respInst = std::make_shared<FSKInstance>(respClass);
-                respInst->fields["status"] = Value((double)response_code);
-                respInst->fields["body"] = Value(readBuffer);
-                return Value(respInst);
-           }
-         }
-         return Value(std::monostate{});
+         HttpClient::Request request;
+         request.url = url;
+         auto response = httpClientOf(interp).perform(std::move(request));
+         return httpResponseValue(response);
 #else
          return Value(std::string("httpGet not supported in WASM"));
 #endif
@@ -1694,82 +2757,114 @@ Interpreter::Interpreter() {
          std::string postData = "";
          if (std::holds_alternative<std::string>(args[1])) {
              postData = std::get<std::string>(args[1]);
-         } else if (std::holds_alternative<std::shared_ptr<FSKInstance>>(args[1])) {
-              // serialize logic basic
+         } else if (!std::holds_alternative<std::monostate>(args[1])) {
+             postData = interp.jsonStringify(args[1]);
          }
 
 #ifndef __EMSCRIPTEN__
-         CURL *curl;
-         CURLcode res;
-         std::string readBuffer;
-
-         curl = curl_easy_init();
-         if(curl) {
-           curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-           curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-
-           struct curl_slist *headers = NULL;
-           headers = curl_slist_append(headers, "Content-Type: application/json");
-           curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-           curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](void *contents, size_t size, size_t nmemb, void *userp) -> size_t {
-               ((std::string*)userp)->append((char*)contents, size * nmemb);
-               return size * nmemb;
-           });
-           curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-           res = curl_easy_perform(curl);
-           
-           long response_code = 0;
-           curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-
-           curl_slist_free_all(headers);
-           curl_easy_cleanup(curl);
-           
-           if (res == CURLE_OK) {
-                auto respClass = std::make_shared<FSKClass>("HttpResponse", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-                auto respInst = std::make_shared<FSKInstance>(respClass);
-                respInst->fields["status"] = Value((double)response_code);
-                respInst->fields["body"] = Value(readBuffer);
-                return Value(respInst);
-           }
-         }
-         return Value(std::monostate{});
+         HttpClient::Request request;
+         request.method = "POST";
+         request.url = url;
+         request.body = std::move(postData);
+         request.headers.emplace_back("Content-Type", "application/json");
+         auto response = httpClientOf(interp).perform(std::move(request));
+         return httpResponseValue(response);
 #else
          return Value(std::string("httpPost not supported in WASM"));
 #endif
       });
 
-  globals->define("HTTP", httpInstance);
+   httpInstance->fields["get"] = httpInstance->fields["httpGet"];
+   httpInstance->fields["post"] = httpInstance->fields["httpPost"];
 
+#ifndef __EMSCRIPTEN__
+   // HTTP.configure({maxPerHost, maxIdle, timeout, keepAlive}): connections are
+   // kept open and reused by default; keepAlive: false opens one per request.
+   httpInstance->fields["configure"] = std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) {
+         auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&args[0]);
+         if (!opts) throw std::runtime_error("HTTP.configure attend un objet d'options.");
+         auto &client = httpClientOf(interp);
+         auto options = client.options();
+         auto number = [&](const char *name) -> std::optional<double> {
+             auto it = (*opts)->fields.find(name);
+             if (it == (*opts)->fields.end() || !std::holds_alternative<double>(it->second)) return std::nullopt;
+             return std::get<double>(it->second);
+         };
+         if (auto n = number("maxPerHost")) options.maxPerHost = (long)std::max(0.0, *n);
+         if (auto n = number("maxIdle")) options.maxIdle = (long)std::max(0.0, *n);
+         if (auto n = number("timeout")) options.timeoutMs = (long)std::max(0.0, *n);
+         auto keepAlive = (*opts)->fields.find("keepAlive");
+         if (keepAlive != (*opts)->fields.end() && std::holds_alternative<bool>(keepAlive->second)) {
+             options.keepAlive = std::get<bool>(keepAlive->second);
+         }
+         client.configure(options);
+         return Value(true);
+      });
 
+   // HTTP.stats(): {requests, failures, connections (opened), reused, handles, idle}.
+   httpInstance->fields["stats"] = std::make_shared<NativeFunction>(
+      0, [](Interpreter &interp, std::vector<Value> args) {
+         auto stats = httpClientOf(interp).stats();
+         static auto statsClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+         auto result = std::make_shared<FSKInstance>(statsClass);
+         result->fields["requests"] = Value((double)stats.requests);
+         result->fields["failures"] = Value((double)stats.failures);
+         result->fields["connections"] = Value((double)stats.connections);
+         result->fields["reused"] = Value((double)(stats.requests > stats.connections ? stats.requests - stats.connections : 0));
+         result->fields["handles"] = Value((double)stats.handles);
+         result->fields["idle"] = Value((double)stats.idle);
+         result->fields["pending"] = Value((double)stats.pending);
+         return Value(result);
+      });
 
+   // HTTP.request(url | {url, method, headers, body, timeout}) -> Promise of
+   // {status, body, headers}. Runs on the client's I/O thread, so the
+   // interpreter keeps going; rejects only when no response arrived.
+   httpInstance->fields["request"] = std::make_shared<NativeFunction>(
+      1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+         auto request = httpRequestOf(interp, args[0]);
+         auto promise = interp.makePromise();
+         httpSubmit(interp, std::move(request), [&interp, promise](HttpClient::Response &response) {
+             if (response.ok) {
+                 promise->resolve(interp, httpResponseValue(response));
+             } else {
+                 promise->reject(interp, Value("HTTP.request: " + response.error));
+             }
+         });
+         return Value(std::static_pointer_cast<FSKInstance>(promise));
+      });
 
-  
+   // HTTP.requestAll(list, {concurrency}) -> Promise of the responses in list
+   // order, nil for requests that got none. At most `concurrency` (default:
+   // all) are in flight at once.
+   httpInstance->fields["requestAll"] = std::make_shared<NativeFunction>(
+      -1, [](Interpreter &interp, std::vector<Value> args) -> Value {
+         auto list = args.empty() ? nullptr : std::get_if<std::shared_ptr<FSKArray>>(&args[0]);
+         if (!list) throw std::runtime_error("HTTP.requestAll attend une liste de requêtes.");
+         auto fanOut = std::make_shared<HttpFanOut>();
+         for (auto &spec : (*list)->elements) fanOut->requests.push_back(httpRequestOf(interp, spec));
+         fanOut->results.assign(fanOut->requests.size(), Value(std::monostate{}));
+         fanOut->limit = fanOut->requests.size();
+         if (args.size() > 1) {
+             if (auto opts = std::get_if<std::shared_ptr<FSKInstance>>(&args[1])) {
+                 auto concurrency = (*opts)->fields.find("concurrency");
+                 if (concurrency != (*opts)->fields.end() && std::holds_alternative<double>(concurrency->second)) {
+                     fanOut->limit = (size_t)std::max(1.0, std::get<double>(concurrency->second));
+                 }
+             }
+         }
+         fanOut->promise = interp.makePromise();
+         if (fanOut->requests.empty()) {
+             fanOut->promise->resolve(interp, Value(std::make_shared<FSKArray>(std::vector<Value>{})));
+         } else {
+             httpFanOutNext(interp, fanOut);
+         }
+         return Value(std::static_pointer_cast<FSKInstance>(fanOut->promise));
+      });
+#endif
 
-  std::vector<std::string> searchPaths = {
-      "std/prelude.fsk",
-      "../std/prelude.fsk",
-      "/usr/local/lib/fsk/std/prelude.fsk",
-      "C:/Fsk/std/prelude.fsk" 
-  };
-  for (const auto &path : searchPaths) {
-    std::ifstream file(path);
-    if (file.is_open()) {
-      std::stringstream buffer;
-      buffer << file.rdbuf();
-      std::string source = buffer.str();
-      Lexer lexer(source);
-      std::vector<Token> tokens = lexer.scanTokens();
-      Parser parser(tokens);
-      std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
-      try {
-        interpret(statements);
-      } catch (...) {
-      }
-      break;
-    }
-  }
+  return httpInstance;
 }
 
 void Interpreter::interpret(std::vector<std::shared_ptr<Stmt>> statements, bool runEventLoop, bool replMode) {
@@ -1789,17 +2884,22 @@ void Interpreter::interpret(std::vector<std::shared_ptr<Stmt>> statements, bool
       eventLoop->run();
     }
   } catch (const std::runtime_error &error) {
-    std::cerr << "Erreur d'exécution : " << error.what() << std::endl;
-    if (!callStack.empty()) {
-        std::cerr << "Call Stack:" << std::endl;
-        for (auto it = callStack.rbegin(); it != callStack.rend(); ++it) {
-            std::cerr << "  at " << *it << "()" << std::endl;
-        }
-    }
-    callStack.clear();
+    reportError(error.what());
   }
 }
 
+void Interpreter::reportError(const std::string &message) {
+  std::cerr << "Erreur d'exécution : " << message << std::endl;
+  if (!callStack.empty()) {
+      std::cerr << "Call Stack:" << std::endl;
+      for (auto it = callStack.rbegin(); it != callStack.rend(); ++it) {
+          std::cerr << "  at " << *it << "()" << std::endl;
+      }
+  }
+  callStack.clear();
+}
+
+
 void Interpreter::execute(std::shared_ptr<Stmt> stmt) {
   if (stmt) {
     stmt->accept(*this);
@@ -2148,39 +3248,71 @@ void Interpreter::visitLogicalExpr(Logical &expr) {
   lastValue = evaluate(expr.right);
 }
 
+static void checkArity(Callable &function, size_t count) {
+  int min = function.minArity();
+  int max = function.maxArity();
+
+  if ((min != -1 && count < (size_t)min) || (max != -1 && count > (size_t)max)) {
+    if (min == max) {
+      throw std::runtime_error("Expected " + std::to_string(min) +
+                               " arguments but got " +
+                               std::to_string(count) + ".");
+    } else {
+      throw std::runtime_error("Expected " + std::to_string(min) + "-" + 
+                               std::to_string(max) +
+                               " arguments but got " +
+                               std::to_string(count) + ".");
+    }
+  }
+}
+
 void Interpreter::visitCallExpr(Call &expr) {
-  Value callee = evaluate(expr.callee);
+  Value callee;
+  std::shared_ptr<FSKInstance> receiver;
+  std::shared_ptr<NativeFunction> method;
+
+  auto get = dynamic_cast<Get *>(expr.callee.get());
+  if (get && !get->isOptional) {
+    Value object = evaluate(get->object);
+    // Native class methods (Request, Channel, ...) are called on the instance
+    // directly instead of allocating a bound copy on every call.
+    auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&object);
+    if (inst && (*inst)->klass && !(*inst)->fields.count(get->name.lexeme)) {
+      auto native = std::dynamic_pointer_cast<NativeFunction>((*inst)->klass->findMethod(get->name.lexeme));
+      if (native && native->_callMethod) {
+        receiver = *inst;
+        method = native;
+      }
+    }
+    if (!method) {
+      getProperty(object, *get);
+      callee = lastValue;
+    }
+  } else {
+    callee = evaluate(expr.callee);
+  }
 
   std::vector<Value> arguments;
   for (const auto &arg : expr.arguments) {
     arguments.push_back(evaluate(arg));
   }
 
-  if (std::holds_alternative<std::shared_ptr<Callable>>(callee)) {
+  if (method) {
+    checkArity(*method, arguments.size());
+    lastValue = method->_callMethod(*this, arguments, receiver);
+  } else if (std::holds_alternative<std::shared_ptr<Callable>>(callee)) {
     auto function = std::get<std::shared_ptr<Callable>>(callee);
-    int min = function->minArity();
-    int max = function->maxArity();
-    
-    if ((min != -1 && arguments.size() < (size_t)min) || (max != -1 && arguments.size() > (size_t)max)) {
-      if (min == max) {
-        throw std::runtime_error("Expected " + std::to_string(min) +
-                                 " arguments but got " +
-                                 std::to_string(arguments.size()) + ".");
-      } else {
-        throw std::runtime_error("Expected " + std::to_string(min) + "-" + 
-                                 std::to_string(max) +
-                                 " arguments but got " +
-                                 std::to_string(arguments.size()) + ".");
-      }
-    }
+    checkArity(*function, arguments.size());
     lastValue = function->call(*this, arguments);
   } else {
     throw std::runtime_error("Can only call functions and classes.");
   }
 }
 void Interpreter::visitGetExpr(Get &expr) {
-  Value object = evaluate(expr.object);
+  getProperty(evaluate(expr.object), expr);
+}
 
+void Interpreter::getProperty(Value object, Get &expr) {
   if (expr.isOptional) {
      if (std::holds_alternative<std::monostate>(object)) {
          lastValue = std::monostate{};
@@ -2191,6 +3323,13 @@ void Interpreter::visitGetExpr(Get &expr) {
     lastValue = std::get<std::shared_ptr<FSKInstance>>(object)->get(expr.name);
     return;
   }
+  if (std::holds_alternative<std::shared_ptr<Callable>>(object)) {
+    auto klass = std::dynamic_pointer_cast<FSKClass>(std::get<std::shared_ptr<Callable>>(object));
+    if (klass && klass->statics.count(expr.name.lexeme)) {
+      lastValue = klass->statics[expr.name.lexeme];
+      return;
+    }
+  }
   if (std::holds_alternative<std::shared_ptr<FSKArray>>(object)) {
     auto arr = std::get<std::shared_ptr<FSKArray>>(object);
     if (expr.name.lexeme == "length") {
@@ -2447,6 +3586,11 @@ void Interpreter::visitSuperExpr(Super &expr) {
 void Interpreter::visitAwaitExpr(Await &expr) {
   Value value = evaluate(expr.expression);
 
+  if (auto promise = asPromise(value)) {
+      lastValue = promise->wait(*this);
+      return;
+  }
+
   if (std::holds_alternative<std::shared_ptr<FSKInstance>>(value)) {
       auto instance = std::get<std::shared_ptr<FSKInstance>>(value);
       Token waitToken(TokenType::IDENTIFIER, "wait", std::monostate{}, 0);
@@ -2463,17 +3607,172 @@ void Interpreter::visitAwaitExpr(Await &expr) {
   lastValue = value;
 }
 
+// Names a function reads or assigns without declaring them: what a spawned fiber
+// needs copied from the spawner. Scopes inside the function are not told apart,
+// so a name declared anywhere in it counts as its own.
+class FreeNames : public ExprVisitor, public StmtVisitor {
+public:
+  static std::set<std::string> of(Function &function) {
+    FreeNames names;
+    names.function(function.params, function.body);
+    std::set<std::string> free;
+    for (auto &name : names.used) {
+      if (!names.declared.count(name)) free.insert(name);
+    }
+    return free;
+  }
+
+  void visitBinaryExpr(Binary &expr) override { walk(expr.left); walk(expr.right); }
+  void visitGroupingExpr(Grouping &expr) override { walk(expr.expression); }
+  void visitLiteralExpr(Literal &) override {}
+  void visitUnaryExpr(Unary &expr) override { walk(expr.right); }
+  void visitVariableExpr(Variable &expr) override { used.insert(expr.name.lexeme); }
+  void visitAssignExpr(Assign &expr) override { used.insert(expr.name.lexeme); walk(expr.value); }
+  void visitLogicalExpr(Logical &expr) override { walk(expr.left); walk(expr.right); }
+  void visitCallExpr(Call &expr) override { walk(expr.callee); for (auto &a : expr.arguments) walk(a); }
+  void visitGetExpr(Get &expr) override { walk(expr.object); }
+  void visitSetExpr(Set &expr) override { walk(expr.object); walk(expr.value); }
+  void visitThisExpr(This &) override {}
+  void visitSuperExpr(Super &) override {}
+  void visitAwaitExpr(Await &expr) override { walk(expr.expression); }
+  void visitSpawnExpr(Spawn &expr) override { walk(expr.call); }
+  void visitArrayExpr(Array &expr) override { for (auto &e : expr.elements) walk(e.expr); }
+  void visitIndexExpr(IndexExpr &expr) override { walk(expr.callee); walk(expr.index); }
+  void visitIndexSetExpr(IndexSet &expr) override { walk(expr.callee); walk(expr.index); walk(expr.value); }
+  void visitFunctionExpr(FunctionExpr &expr) override { function(expr.params, expr.body); }
+  void visitTemplateLiteralExpr(TemplateLiteral &expr) override { for (auto &e : expr.expressions) walk(e); }
+  void visitArrowFunctionExpr(ArrowFunction &expr) override { function(expr.params, expr.body); }
+  void visitObjectExpr(ObjectExpr &expr) override { for (auto &[key, value] : expr.fields) walk(value); }
+
+  void visitExpressionStmt(Expression &stmt) override { walk(stmt.expression); }
+  void visitPrintStmt(Print &stmt) override { walk(stmt.expression); }
+  void visitLetStmt(Let &stmt) override { declare(stmt.pattern); walk(stmt.initializer); }
+  void visitConstStmt(Const &stmt) override { declare(stmt.pattern); walk(stmt.initializer); }
+  void visitBlockStmt(Block &stmt) override { for (auto &s : stmt.statements) walk(s); }
+  void visitIfStmt(If &stmt) override { walk(stmt.condition); walk(stmt.thenBranch); walk(stmt.elseBranch); }
+  void visitWhileStmt(While &stmt) override { walk(stmt.condition); walk(stmt.body); }
+  void visitFunctionStmt(Function &stmt) override { declared.insert(stmt.name.lexeme); function(stmt.params, stmt.body); }
+  void visitReturnStmt(Return &stmt) override { walk(stmt.value); }
+  void visitClassStmt(Class &stmt) override {
+    declared.insert(stmt.name.lexeme);
+    if (stmt.superclass) walk(std::static_pointer_cast<Expr>(stmt.superclass));
+    for (auto &method : stmt.methods) function(method->params, method->body);
+  }
+  void visitForStmt(For &stmt) override { walk(stmt.initializer); walk(stmt.condition); walk(stmt.increment); walk(stmt.body); }
+  void visitTryStmt(Try &stmt) override { declared.insert(stmt.catchName.lexeme); walk(stmt.tryBranch); walk(stmt.catchBranch); }
+  void visitThrowStmt(Throw &stmt) override { walk(stmt.value); }
+  void visitImportStmt(Import &stmt) override { walk(stmt.file); }
+  void visitMatchStmt(Match &stmt) override {
+    walk(stmt.expression);
+    for (auto &[pattern, body] : stmt.arms) { declare(pattern); walk(body); }
+  }
+
+private:
+  std::set<std::string> used;
+  std::set<std::string> declared;
+
+  void walk(const std::shared_ptr<Expr> &expr) { if (expr) expr->accept(*this); }
+  void walk(const std::shared_ptr<Stmt> &stmt) { if (stmt) stmt->accept(*this); }
+
+  void function(std::vector<Parameter> &params, std::vector<std::shared_ptr<Stmt>> &body) {
+    for (auto &param : params) { declared.insert(param.name.lexeme); walk(param.defaultValue); }
+    for (auto &stmt : body) walk(stmt);
+  }
+
+  // Every variable in a binding pattern is declared by it.
+  void declare(const std::shared_ptr<Expr> &pattern) {
+    if (auto variable = std::dynamic_pointer_cast<Variable>(pattern)) {
+      declared.insert(variable->name.lexeme);
+    } else if (auto array = std::dynamic_pointer_cast<Array>(pattern)) {
+      for (auto &element : array->elements) declare(element.expr);
+    } else if (auto object = std::dynamic_pointer_cast<ObjectExpr>(pattern)) {
+      for (auto &[key, value] : object->fields) declare(value);
+    }
+  }
+};
+
+void Interpreter::visitSpawnExpr(Spawn &expr) {
+  Value callee = evaluate(expr.call->callee);
+  std::shared_ptr<FunctionCallable> function;
+  if (auto callable = std::get_if<std::shared_ptr<Callable>>(&callee)) {
+    function = std::dynamic_pointer_cast<FunctionCallable>(*callable);
+  }
+  if (!function) {
+    throw std::runtime_error("spawn attend un appel de fonction fsk (ligne " + std::to_string(expr.keyword.line) + ").");
+  }
+
+  auto args = std::make_shared<FSKArray>(std::vector<Value>{});
+  for (auto &argument : expr.call->arguments) {
+    args->elements.push_back(evaluate(argument));
+  }
+
+  FiberScheduler::Fiber fiber;
+  fiber.function = function->declaration;
+  fiber.args = ClonedMessage::fromValue(Value(args));
+  fiber.state = std::make_shared<FiberState>();
+
+  // The fiber gets copies of the values its function reads from the spawner's
+  // scopes, inner scopes first, following the helper functions it reaches. Native
+  // functions and modules are left out: every interpreter has its own. Anything
+  // else that cannot be cloned stops the spawn here.
+  std::set<std::string> seen;
+  std::set<Function *> scanned{function->declaration.get()};
+  std::vector<std::pair<std::shared_ptr<Function>, std::shared_ptr<Environment>>> toScan{{function->declaration, function->closure}};
+  while (!toScan.empty()) {
+    auto [declaration, closure] = toScan.back();
+    toScan.pop_back();
+    for (auto &name : FreeNames::of(*declaration)) {
+      if (!seen.insert(name).second) continue;
+      auto scope = closure;
+      while (scope && !scope->getValues().count(name)) scope = scope->getEnclosing();
+      if (!scope) continue; // a module not loaded yet, or undefined: the fiber reports it
+      const Value &value = scope->getValues().at(name);
+      if (auto callable = std::get_if<std::shared_ptr<Callable>>(&value)) {
+        if (auto fn = std::dynamic_pointer_cast<FunctionCallable>(*callable)) {
+          (scope == globals ? fiber.helpers : fiber.closures)[name] = fn->declaration;
+          if (scanned.insert(fn->declaration.get()).second) toScan.emplace_back(fn->declaration, fn->closure);
+          continue;
+        }
+        // A script's class has no copy over there; natives (Promise too) do.
+        if (std::dynamic_pointer_cast<NativeFunction>(*callable) || callable->get() == promiseClass.get()) continue;
+      }
+      if (scope == globals && nativeModules.count(name)) continue;
+      try {
+        (scope == globals ? fiber.globals : fiber.captures).emplace_back(name, ClonedMessage::fromValue(value));
+      } catch (const std::runtime_error &error) {
+        throw std::runtime_error("spawn ne peut pas copier '" + name + "' dans la fibre (ligne " +
+                                 std::to_string(expr.keyword.line) + ") : " + error.what());
+      }
+    }
+  }
+  if (fiber.globals.empty()) fiber.helpers.clear(); // already bound in every scheduler interpreter
+
+  // And the script's top-level functions, rescanned only when one was (re)defined.
+  if (!spawnFunctions || spawnFunctionsRevision != globals->getFunctionRevision()) {
+    auto functions = std::make_shared<std::map<std::string, std::shared_ptr<Function>>>();
+    for (auto &[name, value] : globals->getValues()) {
+      if (auto callable = std::get_if<std::shared_ptr<Callable>>(&value)) {
+        auto fn = std::dynamic_pointer_cast<FunctionCallable>(*callable);
+        if (fn && fn->closure == globals) (*functions)[name] = fn->declaration;
+      }
+    }
+    if (!spawnFunctions || *spawnFunctions != *functions) spawnFunctions = functions;
+    spawnFunctionsRevision = globals->getFunctionRevision();
+  }
+  fiber.functions = spawnFunctions;
+
+  auto state = fiber.state;
+  FiberScheduler::shared().spawn(std::move(fiber));
+  lastValue = Value(std::static_pointer_cast<FSKInstance>(makeFiberHandle(state)));
+}
+
 void Interpreter::visitFunctionExpr(FunctionExpr &expr) {
-  Token name(TokenType::IDENTIFIER, "", std::monostate{}, 0);
-  auto function = std::make_shared<Function>(name, expr.params, expr.body, false);
-  auto callable = std::make_shared<FunctionCallable>(function, environment);
+  auto callable = std::make_shared<FunctionCallable>(expr.function, environment);
   lastValue = callable;
 }
 
 void Interpreter::visitArrowFunctionExpr(ArrowFunction &expr) {
-  Token name(TokenType::IDENTIFIER, "", std::monostate{}, 0);
-  auto function = std::make_shared<Function>(name, expr.params, expr.body, false);
-  auto callable = std::make_shared<FunctionCallable>(function, environment);
+  auto callable = std::make_shared<FunctionCallable>(expr.function, environment);
   lastValue = callable;
 }
 
@@ -2546,11 +3845,18 @@ void Interpreter::visitIndexExpr(IndexExpr &expr) {
   }
 
   if (std::holds_alternative<std::shared_ptr<FSKInstance>>(callee)) {
+      auto inst = std::get<std::shared_ptr<FSKInstance>>(callee);
+      if (auto view = std::dynamic_pointer_cast<FSKTypedView>(inst)) {
+          if (!std::holds_alternative<double>(index) || std::get<double>(index) < 0) {
+              throw std::runtime_error("Index must be a number.");
+          }
+          lastValue = view->load((size_t)std::get<double>(index));
+          return;
+      }
       if (!std::holds_alternative<std::string>(index)) {
           throw std::runtime_error("Index must be a string for objects.");
       }
       std::string key = std::get<std::string>(index);
-      auto inst = std::get<std::shared_ptr<FSKInstance>>(callee);
       if (inst->fields.count(key)) {
           lastValue = inst->fields[key];
       } else {
@@ -2582,11 +3888,22 @@ void Interpreter::visitIndexSetExpr(IndexSet &expr) {
   }
 
   if (std::holds_alternative<std::shared_ptr<FSKInstance>>(callee)) {
+      auto inst = std::get<std::shared_ptr<FSKInstance>>(callee);
+      if (auto view = std::dynamic_pointer_cast<FSKTypedView>(inst)) {
+          if (!std::holds_alternative<double>(index) || std::get<double>(index) < 0) {
+              throw std::runtime_error("Index must be a number.");
+          }
+          if (!std::holds_alternative<double>(value)) {
+              throw std::runtime_error("Typed views only store numbers.");
+          }
+          view->store((size_t)std::get<double>(index), std::get<double>(value));
+          lastValue = value;
+          return;
+      }
       if (!std::holds_alternative<std::string>(index)) {
           throw std::runtime_error("Index must be a string for objects.");
       }
       std::string key = std::get<std::string>(index);
-      auto inst = std::get<std::shared_ptr<FSKInstance>>(callee);
       inst->fields[key] = value;
       lastValue = value;
       return;
@@ -2754,14 +4071,18 @@ void Interpreter::visitImportStmt(Import &stmt) {
 
   std::stringstream buffer;
   buffer << file.rdbuf();
-  std::string source = buffer.str();
+  interpret(parseSource(buffer.str()));
+}
 
+std::vector<std::shared_ptr<Stmt>> Interpreter::parseSource(const std::string &source) {
   Lexer lexer(source);
-  std::vector<Token> tokens = lexer.scanTokens();
-  Parser parser(tokens);
+  Parser parser(lexer.scanTokens());
   std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
-
-  interpret(statements);
+  if (recordSources) {
+    for (auto &function : parser.functions) function->unit = (int)sources.size();
+    sources.push_back(source);
+  }
+  return statements;
 }
 
 void Interpreter::setArgs(int argc, char *argv[]) {
@@ -2772,6 +4093,10 @@ void Interpreter::setArgs(int argc, char *argv[]) {
 }
 
 
+std::shared_ptr<FSKPromise> Interpreter::makePromise() {
+    return std::make_shared<FSKPromise>(promiseClass);
+}
+
 std::string Interpreter::jsonStringify(Value value) {
     return valueToJson(value).dump();
 }
@@ -2781,73 +4106,173 @@ Value Interpreter::jsonParse(std::string source) {
     return jsonToValue(j);
 }
 
-extern "C" void fsk_on_http_request(uint64_t req_id, const char* method, const char* path, const char* body, void* context) {
+extern "C" void fsk_on_http_request(const FskRequest* request, void* context) {
     if (!context) return;
     auto interp = static_cast<Interpreter*>(context);
-    
-    std::string m(method);
-    std::string p(path);
-    std::string b(body);
-    
-    interp->eventLoop->post([interp, req_id, m, p, b]() {
-        Value handler;
-        try {
-            handler = interp->globals->get("onHttpRequest");
-        } catch (...) {
+
+    std::vector<std::pair<std::string, std::string>> params;
+    params.reserve(request->param_count);
+    for (size_t i = 0; i < request->param_count; i++) {
+        params.emplace_back(request->params[i].name, request->params[i].value);
+    }
+    std::vector<uint32_t> chain(request->middleware, request->middleware + request->middleware_count);
+
+    // The only copy out of the server's buffers; from here the strings are moved.
+    interp->eventLoop->post([interp, req_id = request->id, streaming = request->streaming, route = request->route,
+                             m = std::string(request->method), p = std::string(request->path),
+                             b = std::string(reinterpret_cast<const char*>(request->body), request->body_len),
+                             params = std::move(params), chain = std::move(chain)]() mutable {
+        if (route < 0 && !interp->httpHandler && chain.empty()) {
             fsk_http_respond(req_id, 404, "Not Found");
             return;
         }
+        auto req = interp->httpPool.acquire(req_id, std::move(m), std::move(p), std::move(b), streaming);
+        req->params = std::move(params);
+        interp->httpRoutes.dispatch(*interp, req, route, chain, interp->httpHandler);
+    });
+}
 
-        if (std::holds_alternative<std::shared_ptr<Callable>>(handler)) {
-            static auto reqClass = std::make_shared<FSKClass>("Request", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-            auto reqInst = std::make_shared<FSKInstance>(reqClass);
-            reqInst->fields["id"] = (double)req_id;
-            reqInst->fields["method"] = m;
-            reqInst->fields["path"] = p;
-            reqInst->fields["body"] = b;
-            
-            reqInst->fields["send"] = std::make_shared<NativeFunction>(1, std::function<Value(Interpreter&, std::vector<Value>)>([req_id](Interpreter& i, std::vector<Value> args) -> Value {
-                if (args.size() > 0 && std::holds_alternative<std::string>(args[0])) {
-                    fsk_http_respond(req_id, 200, std::get<std::string>(args[0]).c_str());
-                } else {
-                    fsk_http_respond(req_id, 200, "");
-                }
-                return Value(std::monostate{});
-            }));
+extern "C" void fsk_on_http_body(uint64_t req_id, const uint8_t* data, size_t len, int32_t state, void* context) {
+    if (!context) return;
+    auto interp = static_cast<Interpreter*>(context);
 
-            std::get<std::shared_ptr<Callable>>(handler)->call(*interp, {Value(reqInst)});
+    interp->eventLoop->post([interp, req_id, state, chunk = std::string(reinterpret_cast<const char*>(data), len)]() mutable {
+        auto &uploads = interp->httpPool.uploads;
+        auto it = uploads.find(req_id);
+        std::shared_ptr<FSKHttpRequest> req;
+        if (it != uploads.end()) {
+            req = it->second.lock();
+            if (state != FskBodyData) uploads.erase(it);
+        }
+        if (!req) {
+            // The script let go of the request: drain the upload.
+            if (state == FskBodyData) fsk_http_body_ack(req_id);
+            return;
+        }
+        if (state == FskBodyData) {
+            req->pushChunk(*interp, std::move(chunk));
         } else {
-            fsk_http_respond(req_id, 500, "Internal Server Error");
+            req->finishBody(*interp, state == FskBodyAborted);
         }
     });
 }
 
-extern "C" void fsk_on_ws_message(uint32_t ws_id, const char* message, void* context) {
+// A chunk queued by res.write() reached the client, or was dropped along with the
+// stream. Runs the response's onDrain from the loop once its queue is empty.
+extern "C" void fsk_on_http_drain(uint64_t req_id, size_t bytes, bool written, void* context) {
     if (!context) return;
     auto interp = static_cast<Interpreter*>(context);
-    std::string msg(message);
-    
-    interp->eventLoop->post([interp, ws_id, msg]() {
+
+    interp->eventLoop->post([interp, req_id, bytes, written]() {
+        auto &streams = interp->httpPool.streams;
+        auto it = streams.find(req_id);
+        if (it == streams.end()) return;
+        auto res = it->second.lock();
+        if (!res) {
+            streams.erase(it);
+            return;
+        }
+        res->drained(*interp, bytes, written);
+        if (res->queued == 0) streams.erase(req_id); // the next write lists it again
+    });
+}
+
+// Called from the server's threads for admission control: lock-free reads only.
+extern "C" void fsk_http_loop_load(void* context, FskLoopLoad* out) {
+    if (!context || !out) return;
+    auto load = static_cast<Interpreter*>(context)->eventLoop->load();
+    out->queue_depth = load.queueDepth;
+    out->lag_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(load.oldestWait).count();
+}
+
+// Handle passed to WS.listen's handler; one per socket and delivery.
+static std::shared_ptr<FSKInstance> makeWsPointer(uint32_t ws_id) {
+    static auto wsClass = std::make_shared<FSKClass>("WebSocketPointer", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+    auto wsInst = std::make_shared<FSKInstance>(wsClass);
+    wsInst->fields["id"] = (double)ws_id;
+
+    wsInst->fields["send"] = std::make_shared<NativeFunction>(1, std::function<Value(Interpreter&, std::vector<Value>)>([ws_id](Interpreter& i, std::vector<Value> args) -> Value {
+        if (args.size() > 0 && !std::holds_alternative<std::monostate>(args[0])) {
+            std::string scratch;
+            auto payload = wsPayloadOf(args[0], scratch);
+            fsk_ws_send_bytes(ws_id, payload.data, payload.len, payload.binary);
+        }
+        return Value(std::monostate{});
+    }));
+    wsInst->fields["join"] = std::make_shared<NativeFunction>(1, std::function<Value(Interpreter&, std::vector<Value>)>([ws_id](Interpreter& i, std::vector<Value> args) -> Value {
+        return Value(fsk_ws_join(ws_id, wsRoomOf(args[0], "ws.join").c_str()));
+    }));
+    wsInst->fields["leave"] = std::make_shared<NativeFunction>(1, std::function<Value(Interpreter&, std::vector<Value>)>([ws_id](Interpreter& i, std::vector<Value> args) -> Value {
+        return Value(fsk_ws_leave(ws_id, wsRoomOf(args[0], "ws.leave").c_str()));
+    }));
+    wsInst->fields["stats"] = std::make_shared<NativeFunction>(0, std::function<Value(Interpreter&, std::vector<Value>)>([ws_id](Interpreter& i, std::vector<Value> args) -> Value {
+        return wsStatsOf(i, ws_id);
+    }));
+    return wsInst;
+}
+
+// Called from fsk-core's socket tasks with the messages one socket had ready.
+// They go to the interpreter's inbox; only the first arrival since the last
+// drain posts a loop task, so a burst costs one post however many sockets
+// and messages it spans.
+extern "C" void fsk_on_ws_message(uint32_t ws_id, const FskWsMessage* messages, size_t count, void* context) {
+    if (!context || count == 0) return;
+    auto interp = static_cast<Interpreter*>(context);
+    bool post;
+    {
+        std::lock_guard<std::mutex> lock(interp->wsInbox.mutex);
+        for (size_t i = 0; i < count; i++) {
+            interp->wsInbox.messages.push_back({ws_id, std::string(reinterpret_cast<const char*>(messages[i].data), messages[i].len), messages[i].binary});
+        }
+        post = !interp->wsInbox.scheduled;
+        interp->wsInbox.scheduled = true;
+    }
+    if (!post) return;
+
+    interp->eventLoop->post([interp]() {
+        std::vector<Interpreter::WsInbox::Message> messages;
+        {
+            std::lock_guard<std::mutex> lock(interp->wsInbox.mutex);
+            messages.swap(interp->wsInbox.messages);
+            interp->wsInbox.scheduled = false;
+        }
+
         Value handler;
         try {
             handler = interp->globals->get("onWsMessage");
         } catch (...) {
             return;
         }
+        auto callable = std::get_if<std::shared_ptr<Callable>>(&handler);
+        if (!callable) return;
+
+        std::map<uint32_t, std::shared_ptr<FSKInstance>> sockets;
+        auto socketOf = [&](uint32_t id) {
+            auto &ws = sockets[id];
+            if (!ws) ws = makeWsPointer(id);
+            return ws;
+        };
+
+        if (!interp->wsBatch) {
+            for (auto &msg : messages) {
+                (*callable)->call(*interp, {Value(socketOf(msg.wsId)), wsMessageValue(std::move(msg.bytes), msg.binary)});
+            }
+            return;
+        }
 
-        if (std::holds_alternative<std::shared_ptr<Callable>>(handler)) {
-            static auto wsClass = std::make_shared<FSKClass>("WebSocketPointer", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
-            auto wsInst = std::make_shared<FSKInstance>(wsClass);
-            wsInst->fields["id"] = (double)ws_id;
-            
-            wsInst->fields["send"] = std::make_shared<NativeFunction>(1, std::function<Value(Interpreter&, std::vector<Value>)>([ws_id](Interpreter& i, std::vector<Value> args) -> Value {
-                if (args.size() > 0 && std::holds_alternative<std::string>(args[0])) {
-                    fsk_ws_send(ws_id, std::get<std::string>(args[0]).c_str());
-                }
-                return Value(std::monostate{});
-            }));
-
-            std::get<std::shared_ptr<Callable>>(handler)->call(*interp, {Value(wsInst), Value(msg)});
+        // `batch: true`: each socket's messages in one call, sockets in arrival order.
+        std::vector<uint32_t> order;
+        std::map<uint32_t, std::shared_ptr<FSKArray>> batches;
+        for (auto &msg : messages) {
+            auto &batch = batches[msg.wsId];
+            if (!batch) {
+                batch = std::make_shared<FSKArray>(std::vector<Value>{});
+                order.push_back(msg.wsId);
+            }
+            batch->elements.push_back(wsMessageValue(std::move(msg.bytes), msg.binary));
+        }
+        for (uint32_t id : order) {
+            (*callable)->call(*interp, {Value(socketOf(id)), Value(batches[id])});
         }
     });
 }
@@ -0,0 +1,192 @@
+#include "SharedBuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+SharedMemory::SharedMemory(size_t byteLength) : byteLength(byteLength) {
+    // Rounded up to 8 so every f64/i32 slot is naturally aligned for atomic_ref.
+    size_t capacity = (byteLength + 7) & ~size_t(7);
+    bytes = static_cast<uint8_t *>(std::aligned_alloc(8, capacity ? capacity : 8));
+    if (!bytes) throw std::runtime_error("SharedBuffer: allocation impossible.");
+    std::memset(bytes, 0, capacity);
+}
+
+SharedMemory::~SharedMemory() { std::free(bytes); }
+
+FSKSharedBuffer::FSKSharedBuffer(std::shared_ptr<FSKClass> klass, std::shared_ptr<SharedMemory> memory)
+    : FSKInstance(klass), memory(memory) {
+    fields["byteLength"] = Value((double)memory->byteLength);
+}
+
+FSKTypedView::FSKTypedView(std::shared_ptr<FSKClass> klass, std::shared_ptr<SharedMemory> memory,
+                           Kind kind, size_t byteOffset, size_t length)
+    : FSKInstance(klass), memory(memory), kind(kind), byteOffset(byteOffset), length(length) {
+    fields["length"] = Value((double)length);
+    fields["type"] = Value(std::string(kindName(kind)));
+}
+
+size_t FSKTypedView::elementSize(Kind kind) {
+    switch (kind) {
+    case Kind::F64: return 8;
+    case Kind::I32: return 4;
+    case Kind::U8: return 1;
+    }
+    return 1;
+}
+
+const char *FSKTypedView::kindName(Kind kind) {
+    switch (kind) {
+    case Kind::F64: return "f64";
+    case Kind::I32: return "i32";
+    case Kind::U8: return "u8";
+    }
+    return "u8";
+}
+
+void FSKTypedView::checkIndex(size_t index) const {
+    if (index >= length) throw std::runtime_error("Index out of bounds.");
+}
+
+template <typename T>
+static std::atomic_ref<T> slot(const FSKTypedView &view, size_t index) {
+    view.checkIndex(index);
+    return std::atomic_ref<T>(*reinterpret_cast<T *>(view.memory->bytes + view.byteOffset + index * sizeof(T)));
+}
+
+// Numbers are doubles in fsk; integer views wrap like a C cast through int64.
+static int32_t toI32(double v) { return std::isfinite(v) ? (int32_t)(uint32_t)(int64_t)v : 0; }
+static uint8_t toU8(double v) { return std::isfinite(v) ? (uint8_t)(int64_t)v : 0; }
+
+double FSKTypedView::load(size_t index) const {
+    switch (kind) {
+    case Kind::F64: return slot<double>(*this, index).load(std::memory_order_relaxed);
+    case Kind::I32: return slot<int32_t>(*this, index).load(std::memory_order_relaxed);
+    case Kind::U8: return slot<uint8_t>(*this, index).load(std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+void FSKTypedView::store(size_t index, double value) {
+    switch (kind) {
+    case Kind::F64: slot<double>(*this, index).store(value, std::memory_order_relaxed); break;
+    case Kind::I32: slot<int32_t>(*this, index).store(toI32(value), std::memory_order_relaxed); break;
+    case Kind::U8: slot<uint8_t>(*this, index).store(toU8(value), std::memory_order_relaxed); break;
+    }
+}
+
+double FSKTypedView::fetchAdd(size_t index, double delta) {
+    switch (kind) {
+    case Kind::I32: return slot<int32_t>(*this, index).fetch_add(toI32(delta));
+    case Kind::U8: return slot<uint8_t>(*this, index).fetch_add(toU8(delta));
+    default: throw std::runtime_error("Atomics attend une vue entière (i32 ou u8).");
+    }
+}
+
+double FSKTypedView::exchange(size_t index, double value) {
+    switch (kind) {
+    case Kind::I32: return slot<int32_t>(*this, index).exchange(toI32(value));
+    case Kind::U8: return slot<uint8_t>(*this, index).exchange(toU8(value));
+    default: throw std::runtime_error("Atomics attend une vue entière (i32 ou u8).");
+    }
+}
+
+double FSKTypedView::compareExchange(size_t index, double expected, double replacement) {
+    switch (kind) {
+    case Kind::I32: {
+        int32_t current = toI32(expected);
+        slot<int32_t>(*this, index).compare_exchange_strong(current, toI32(replacement));
+        return current;
+    }
+    case Kind::U8: {
+        uint8_t current = toU8(expected);
+        slot<uint8_t>(*this, index).compare_exchange_strong(current, toU8(replacement));
+        return current;
+    }
+    default: throw std::runtime_error("Atomics attend une vue entière (i32 ou u8).");
+    }
+}
+
+std::string FSKTypedView::wait(size_t index, double expected, double timeoutMs) {
+    if (kind != Kind::I32) throw std::runtime_error("Atomics.wait attend une vue i32.");
+    checkIndex(index);
+
+    SharedMemory::Waiter waiter{byteOffset + index * 4};
+    std::unique_lock<std::mutex> lock(memory->waitMutex);
+    // Checked under waitMutex so a notify between the check and the sleep is not lost.
+    if (slot<int32_t>(*this, index).load() != toI32(expected)) return "not-equal";
+
+    memory->waiters.push_back(&waiter);
+    bool woken;
+    if (timeoutMs < 0) {
+        memory->waitCv.wait(lock, [&] { return waiter.notified; });
+        woken = true;
+    } else {
+        woken = memory->waitCv.wait_for(lock, std::chrono::duration<double, std::milli>(timeoutMs),
+                                        [&] { return waiter.notified; });
+    }
+    memory->waiters.remove(&waiter);
+    return woken ? "ok" : "timed-out";
+}
+
+int FSKTypedView::notify(size_t index, int count) {
+    if (kind != Kind::I32) throw std::runtime_error("Atomics.notify attend une vue i32.");
+    checkIndex(index);
+
+    size_t target = byteOffset + index * 4;
+    int woken = 0;
+    {
+        std::lock_guard<std::mutex> lock(memory->waitMutex);
+        for (auto *waiter : memory->waiters) {
+            if (count >= 0 && woken >= count) break;
+            if (waiter->byteOffset == target && !waiter->notified) {
+                waiter->notified = true;
+                woken++;
+            }
+        }
+    }
+    if (woken) memory->waitCv.notify_all();
+    return woken;
+}
+
+static std::shared_ptr<FSKClass> typedViewClass() {
+    static auto klass = std::make_shared<FSKClass>("TypedView", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+    return klass;
+}
+
+// view(kind) methods: buf.f64(byteOffset?, length?) and friends.
+static std::shared_ptr<Callable> viewMethod(FSKTypedView::Kind kind) {
+    return std::shared_ptr<NativeFunction>(new NativeFunction(-1, NativeMethodCallback([kind](Interpreter &interp, std::vector<Value> args, std::shared_ptr<FSKInstance> self) -> Value {
+        auto buffer = std::dynamic_pointer_cast<FSKSharedBuffer>(self);
+        if (!buffer) throw std::runtime_error("Méthode SharedBuffer appelée sur un autre objet.");
+        size_t size = FSKTypedView::elementSize(kind);
+        size_t byteOffset = 0;
+        if (!args.empty() && std::holds_alternative<double>(args[0])) byteOffset = (size_t)std::get<double>(args[0]);
+        if (byteOffset % size != 0 || byteOffset > buffer->memory->byteLength) {
+            throw std::runtime_error(std::string("SharedBuffer.") + FSKTypedView::kindName(kind) + ": offset invalide.");
+        }
+        size_t length = (buffer->memory->byteLength - byteOffset) / size;
+        if (args.size() > 1 && std::holds_alternative<double>(args[1])) {
+            size_t requested = (size_t)std::get<double>(args[1]);
+            if (requested > length) throw std::runtime_error(std::string("SharedBuffer.") + FSKTypedView::kindName(kind) + ": longueur hors limites.");
+            length = requested;
+        }
+        return Value(std::static_pointer_cast<FSKInstance>(makeTypedView(buffer->memory, kind, byteOffset, length)));
+    }), nullptr));
+}
+
+std::shared_ptr<FSKSharedBuffer> makeSharedBuffer(std::shared_ptr<SharedMemory> memory) {
+    static auto klass = std::make_shared<FSKClass>("SharedBuffer", nullptr, std::map<std::string, std::shared_ptr<Callable>>{
+        {"f64", viewMethod(FSKTypedView::Kind::F64)},
+        {"i32", viewMethod(FSKTypedView::Kind::I32)},
+        {"u8", viewMethod(FSKTypedView::Kind::U8)},
+    });
+    return std::make_shared<FSKSharedBuffer>(klass, memory);
+}
+
+std::shared_ptr<FSKTypedView> makeTypedView(std::shared_ptr<SharedMemory> memory, FSKTypedView::Kind kind,
+                                            size_t byteOffset, size_t length) {
+    return std::make_shared<FSKTypedView>(typedViewClass(), memory, kind, byteOffset, length);
+}
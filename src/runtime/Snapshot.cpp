@@ -0,0 +1,376 @@
+#include "Snapshot.hpp"
+#include "Callable.hpp"
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
+
+namespace {
+
+const std::string Magic = "FSKSNAP1";
+
+enum Tag : char {
+    TagNil = 'N',
+    TagTrue = 'T',
+    TagFalse = 'F',
+    TagNumber = 'D',
+    TagString = 'S',
+    TagArray = 'A',
+    TagInstance = 'O',
+    TagFunction = 'f',
+    TagClass = 'c',
+    TagNative = 'n',
+    TagRef = 'R',
+    TagEnv = 'E',
+    TagGlobals = 'G',
+    TagBuiltin = 'K', // global still bound to the native of the same name
+};
+
+const void *identity(const Value &value) {
+    if (auto callable = std::get_if<std::shared_ptr<Callable>>(&value)) return callable->get();
+    if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value)) return inst->get();
+    return nullptr;
+}
+
+class Writer {
+public:
+    Writer(Interpreter &interp, std::map<const void *, std::string> natives)
+        : interp(interp), natives(std::move(natives)) {}
+
+    std::string out;
+
+    void value(const Value &value) {
+        if (std::holds_alternative<std::monostate>(value)) {
+            out.push_back(TagNil);
+        } else if (auto b = std::get_if<bool>(&value)) {
+            out.push_back(*b ? TagTrue : TagFalse);
+        } else if (auto d = std::get_if<double>(&value)) {
+            out.push_back(TagNumber);
+            raw(d, sizeof(double));
+        } else if (auto s = std::get_if<std::string>(&value)) {
+            out.push_back(TagString);
+            string(*s);
+        } else if (auto arr = std::get_if<std::shared_ptr<FSKArray>>(&value)) {
+            if (ref(arr->get())) return;
+            out.push_back(TagArray);
+            u32((uint32_t)(*arr)->elements.size());
+            for (auto &element : (*arr)->elements) this->value(element);
+        } else if (auto callable = std::get_if<std::shared_ptr<Callable>>(&value)) {
+            if (native(callable->get()) || ref(callable->get())) return;
+            if (auto function = std::dynamic_pointer_cast<FunctionCallable>(*callable)) {
+                if (function->declaration->unit < 0) {
+                    throw std::runtime_error("Snapshot impossible : fonction créée hors du script (VM.run, worker...).");
+                }
+                out.push_back(TagFunction);
+                u32((uint32_t)function->declaration->unit);
+                u32((uint32_t)function->declaration->id);
+                env(function->closure);
+            } else if (typeid(**callable) == typeid(FSKClass)) {
+                auto klass = std::static_pointer_cast<FSKClass>(*callable);
+                out.push_back(TagClass);
+                string(klass->name);
+                if (klass->superclass) this->value(Value(std::static_pointer_cast<Callable>(klass->superclass)));
+                else out.push_back(TagNil);
+                u32((uint32_t)klass->methods.size());
+                for (auto &[name, method] : klass->methods) {
+                    string(name);
+                    this->value(Value(method));
+                }
+                u32((uint32_t)klass->statics.size());
+                for (auto &[name, member] : klass->statics) {
+                    string(name);
+                    this->value(member);
+                }
+            } else {
+                throw std::runtime_error("Snapshot impossible : valeur native non restaurable (" + (*callable)->toString() + ").");
+            }
+        } else if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value)) {
+            if (native(inst->get()) || ref(inst->get())) return;
+            if (typeid(**inst) != typeid(FSKInstance)) {
+                throw std::runtime_error("Snapshot impossible : objet natif non restaurable (" + (*inst)->toString() + ").");
+            }
+            out.push_back(TagInstance);
+            this->value(Value(std::static_pointer_cast<Callable>((*inst)->klass)));
+            u32((uint32_t)(*inst)->fields.size());
+            for (auto &[name, field] : (*inst)->fields) {
+                string(name);
+                this->value(field);
+            }
+        }
+    }
+
+    void env(const std::shared_ptr<Environment> &env) {
+        if (!env) {
+            out.push_back(TagNil);
+            return;
+        }
+        if (env == interp.globals) {
+            out.push_back(TagGlobals);
+            return;
+        }
+        if (ref(env.get())) return;
+        out.push_back(TagEnv);
+        u32((uint32_t)env->getValues().size());
+        for (auto &[name, member] : env->getValues()) {
+            string(name);
+            value(member);
+        }
+        this->env(env->getEnclosing());
+    }
+
+    bool nativeNamed(const Value &value, const std::string &name) {
+        auto it = natives.find(identity(value));
+        return it != natives.end() && it->second == name;
+    }
+
+    void u32(uint32_t n) { raw(&n, sizeof(n)); }
+
+    void string(const std::string &s) {
+        u32((uint32_t)s.size());
+        out.append(s);
+    }
+
+private:
+    bool native(const void *ptr) {
+        auto it = natives.find(ptr);
+        if (it == natives.end()) return false;
+        out.push_back(TagNative);
+        string(it->second);
+        return true;
+    }
+
+    // Heap objects get an id in encounter order; repeats are back-references.
+    bool ref(const void *ptr) {
+        auto it = seen.find(ptr);
+        if (it != seen.end()) {
+            out.push_back(TagRef);
+            u32(it->second);
+            return true;
+        }
+        seen[ptr] = nextRef++;
+        return false;
+    }
+
+    void raw(const void *src, size_t size) { out.append(static_cast<const char *>(src), size); }
+
+    Interpreter &interp;
+    std::map<const void *, std::string> natives;
+    std::map<const void *, uint32_t> seen;
+    uint32_t nextRef = 0;
+};
+
+class Reader {
+public:
+    Reader(Interpreter &interp, const std::string &data) : interp(interp), data(data) {}
+
+    std::vector<std::vector<std::shared_ptr<Function>>> units;
+
+    Value value() {
+        char tag = next();
+        switch (tag) {
+        case TagNil: return Value(std::monostate{});
+        case TagTrue: return Value(true);
+        case TagFalse: return Value(false);
+        case TagNumber: {
+            double d;
+            raw(&d, sizeof(d));
+            return Value(d);
+        }
+        case TagString: return Value(string());
+        case TagNative: return native(string());
+        case TagRef: return refs.at(u32()).value;
+        case TagArray: {
+            auto arr = std::make_shared<FSKArray>(std::vector<Value>{});
+            refs.push_back({Value(arr), nullptr});
+            uint32_t count = u32();
+            arr->elements.reserve(count);
+            for (uint32_t i = 0; i < count; i++) arr->elements.push_back(value());
+            return Value(arr);
+        }
+        case TagFunction: {
+            uint32_t unit = u32(), id = u32();
+            if (unit >= units.size() || id >= units[unit].size()) throw std::runtime_error("Snapshot corrompu.");
+            auto function = std::make_shared<FunctionCallable>(units[unit][id], nullptr);
+            refs.push_back({Value(std::static_pointer_cast<Callable>(function)), nullptr});
+            function->closure = env();
+            return Value(std::static_pointer_cast<Callable>(function));
+        }
+        case TagClass: {
+            auto klass = std::make_shared<FSKClass>(string(), nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+            refs.push_back({Value(std::static_pointer_cast<Callable>(klass)), nullptr});
+            Value superclass = value();
+            if (auto callable = std::get_if<std::shared_ptr<Callable>>(&superclass)) {
+                klass->superclass = std::dynamic_pointer_cast<FSKClass>(*callable);
+            }
+            for (uint32_t i = 0, n = u32(); i < n; i++) {
+                std::string name = string();
+                Value method = value();
+                if (auto callable = std::get_if<std::shared_ptr<Callable>>(&method)) klass->methods[name] = *callable;
+            }
+            for (uint32_t i = 0, n = u32(); i < n; i++) {
+                std::string name = string();
+                klass->statics[name] = value();
+            }
+            return Value(std::static_pointer_cast<Callable>(klass));
+        }
+        case TagInstance: {
+            auto inst = std::make_shared<FSKInstance>(nullptr);
+            refs.push_back({Value(inst), nullptr});
+            Value klass = value();
+            if (auto callable = std::get_if<std::shared_ptr<Callable>>(&klass)) {
+                inst->klass = std::dynamic_pointer_cast<FSKClass>(*callable);
+            }
+            if (!inst->klass) throw std::runtime_error("Snapshot corrompu.");
+            for (uint32_t i = 0, n = u32(); i < n; i++) {
+                std::string name = string();
+                inst->fields[name] = value();
+            }
+            return Value(inst);
+        }
+        }
+        throw std::runtime_error("Snapshot corrompu.");
+    }
+
+    std::shared_ptr<Environment> env() {
+        char tag = next();
+        switch (tag) {
+        case TagNil: return nullptr;
+        case TagGlobals: return interp.globals;
+        case TagRef: return refs.at(u32()).env;
+        case TagEnv: {
+            // Registered before its contents so closures over it can refer back.
+            auto env = std::make_shared<Environment>();
+            refs.push_back({Value(std::monostate{}), env});
+            for (uint32_t i = 0, n = u32(); i < n; i++) {
+                std::string name = string();
+                env->define(name, value());
+            }
+            env->setEnclosing(this->env());
+            return env;
+        }
+        }
+        throw std::runtime_error("Snapshot corrompu.");
+    }
+
+    char next() {
+        if (pos >= data.size()) throw std::runtime_error("Snapshot corrompu.");
+        return data[pos++];
+    }
+
+    void unread() { pos--; }
+
+    uint32_t u32() {
+        uint32_t n;
+        raw(&n, sizeof(n));
+        return n;
+    }
+
+    std::string string() {
+        uint32_t size = u32();
+        if (pos + size > data.size()) throw std::runtime_error("Snapshot corrompu.");
+        std::string s = data.substr(pos, size);
+        pos += size;
+        return s;
+    }
+
+private:
+    // "Name" or "Module.member", resolved against this interpreter's natives.
+    Value native(const std::string &path) {
+        size_t dot = path.find('.');
+        Value value = interp.globals->get(path.substr(0, dot));
+        if (dot == std::string::npos) return value;
+        auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value);
+        if (!inst || !(*inst)->fields.count(path.substr(dot + 1))) {
+            throw std::runtime_error("Snapshot : native inconnue " + path);
+        }
+        return (*inst)->fields[path.substr(dot + 1)];
+    }
+
+    void raw(void *dst, size_t size) {
+        if (pos + size > data.size()) throw std::runtime_error("Snapshot corrompu.");
+        std::memcpy(dst, data.data() + pos, size);
+        pos += size;
+    }
+
+    struct Ref {
+        Value value;
+        std::shared_ptr<Environment> env;
+    };
+
+    Interpreter &interp;
+    const std::string &data;
+    size_t pos = 0;
+    std::vector<Ref> refs;
+};
+
+} // namespace
+
+void writeSnapshot(Interpreter &interp, const std::map<std::string, Value> &builtins, const std::string &path) {
+    if (!interp.eventLoop->idle()) {
+        throw std::runtime_error("Snapshot impossible : timers, serveurs ou tâches encore en attente.");
+    }
+
+    std::map<const void *, std::string> natives;
+    auto add = [&natives](const Value &value, const std::string &id) {
+        if (auto ptr = identity(value)) natives.emplace(ptr, id);
+    };
+    for (auto &[name, value] : builtins) add(value, name);
+    for (auto &[name, module] : interp.nativeModules) {
+        add(module, name);
+        if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&module)) {
+            for (auto &[field, member] : (*inst)->fields) add(member, name + "." + field);
+        }
+    }
+
+    Writer writer(interp, std::move(natives));
+    writer.out = Magic;
+    writer.u32((uint32_t)interp.sources.size());
+    for (auto &source : interp.sources) writer.string(source);
+
+    auto &globals = interp.globals->getValues();
+    writer.u32((uint32_t)globals.size());
+    for (auto &[name, value] : globals) {
+        writer.string(name);
+        if (writer.nativeNamed(value, name)) writer.out.push_back(TagBuiltin);
+        else writer.value(value);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Snapshot : impossible d'écrire " + path);
+    file.write(writer.out.data(), (std::streamsize)writer.out.size());
+}
+
+void restoreSnapshot(Interpreter &interp, const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Snapshot : impossible d'ouvrir " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string data = buffer.str();
+    if (data.compare(0, Magic.size(), Magic) != 0) throw std::runtime_error("Snapshot : format inconnu " + path);
+
+    Reader reader(interp, data);
+    for (size_t i = 0; i < Magic.size(); i++) reader.next();
+
+    // Parse only: the functions come back with the same ids, nothing executes.
+    uint32_t unitCount = reader.u32();
+    for (uint32_t unit = 0; unit < unitCount; unit++) {
+        std::string source = reader.string();
+        Lexer lexer(source);
+        Parser parser(lexer.scanTokens());
+        parser.parse();
+        for (auto &function : parser.functions) function->unit = (int)unit;
+        reader.units.push_back(std::move(parser.functions));
+        interp.sources.push_back(std::move(source));
+    }
+
+    for (uint32_t i = 0, n = reader.u32(); i < n; i++) {
+        std::string name = reader.string();
+        if (reader.next() == TagBuiltin) continue;
+        reader.unread();
+        interp.globals->define(name, reader.value());
+    }
+}
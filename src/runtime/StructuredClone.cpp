@@ -0,0 +1,237 @@
+#include "StructuredClone.hpp"
+#include "Callable.hpp"
+#include "FiberScheduler.hpp"
+#include "SharedBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+enum Tag : char {
+    TagNil = 'N',
+    TagTrue = 'T',
+    TagFalse = 'F',
+    TagNumber = 'D',
+    TagString = 'S',
+    TagLargeString = 'L',
+    TagArray = 'A',
+    TagMovedArray = 'M',
+    TagObject = 'O',
+    TagRef = 'R',
+    TagSharedBuffer = 'B',
+    TagTypedView = 'V',
+    TagChannel = 'C',
+};
+
+bool isPrimitive(const Value &v) {
+    return std::holds_alternative<double>(v) || std::holds_alternative<std::string>(v) ||
+           std::holds_alternative<bool>(v) || std::holds_alternative<std::monostate>(v);
+}
+
+class Encoder {
+public:
+    Encoder(ClonedMessage &out, bool transfer) : out(out), transfer(transfer) {}
+
+    void write(Value &value, bool owned) {
+        if (std::holds_alternative<std::monostate>(value)) {
+            out.data.push_back(TagNil);
+        } else if (auto b = std::get_if<bool>(&value)) {
+            out.data.push_back(*b ? TagTrue : TagFalse);
+        } else if (auto d = std::get_if<double>(&value)) {
+            out.data.push_back(TagNumber);
+            writeRaw(d, sizeof(double));
+        } else if (auto s = std::get_if<std::string>(&value)) {
+            if (s->size() >= ClonedMessage::LargeString) {
+                out.data.push_back(TagLargeString);
+                writeU32((uint32_t)out.strings.size());
+                out.strings.push_back(owned ? std::move(*s) : *s);
+            } else {
+                out.data.push_back(TagString);
+                writeString(*s);
+            }
+        } else if (auto arr = std::get_if<std::shared_ptr<FSKArray>>(&value)) {
+            if (writeRef(arr->get())) return;
+            auto &elements = (*arr)->elements;
+            if (transfer && std::all_of(elements.begin(), elements.end(), isPrimitive)) {
+                out.data.push_back(TagMovedArray);
+                writeU32((uint32_t)out.arrays.size());
+                out.arrays.push_back(std::move(elements));
+                elements.clear();
+                return;
+            }
+            out.data.push_back(TagArray);
+            writeU32((uint32_t)elements.size());
+            for (auto &element : elements) write(element, false);
+        } else if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value)) {
+            if (writeRef(inst->get())) return;
+            if (auto buffer = std::dynamic_pointer_cast<FSKSharedBuffer>(*inst)) {
+                out.data.push_back(TagSharedBuffer);
+                writeU32((uint32_t)out.shared.size());
+                out.shared.push_back(buffer->memory);
+                return;
+            }
+            if (auto view = std::dynamic_pointer_cast<FSKTypedView>(*inst)) {
+                out.data.push_back(TagTypedView);
+                writeU32((uint32_t)out.shared.size());
+                out.shared.push_back(view->memory);
+                out.data.push_back((char)view->kind);
+                uint64_t offset = view->byteOffset, length = view->length;
+                writeRaw(&offset, sizeof(offset));
+                writeRaw(&length, sizeof(length));
+                return;
+            }
+            if (auto channel = std::dynamic_pointer_cast<FSKChannel>(*inst)) {
+                out.data.push_back(TagChannel);
+                writeU32((uint32_t)out.channels.size());
+                out.channels.push_back(channel->channel);
+                return;
+            }
+            auto &fields = (*inst)->fields;
+            out.data.push_back(TagObject);
+            writeU32((uint32_t)fields.size());
+            for (auto &[key, field] : fields) {
+                writeString(key);
+                write(field, false);
+            }
+        } else {
+            throw std::runtime_error("Clonage impossible : une fonction ne peut pas être envoyée à un autre thread.");
+        }
+    }
+
+private:
+    // Containers get an id in encounter order; repeats are written as back-references.
+    bool writeRef(const void *ptr) {
+        auto it = seen.find(ptr);
+        if (it != seen.end()) {
+            out.data.push_back(TagRef);
+            writeU32(it->second);
+            return true;
+        }
+        seen[ptr] = nextRef++;
+        return false;
+    }
+
+    void writeRaw(const void *src, size_t size) {
+        out.data.append(static_cast<const char *>(src), size);
+    }
+
+    void writeU32(uint32_t n) { writeRaw(&n, sizeof(n)); }
+
+    void writeString(const std::string &s) {
+        writeU32((uint32_t)s.size());
+        out.data.append(s);
+    }
+
+    ClonedMessage &out;
+    bool transfer;
+    std::map<const void *, uint32_t> seen;
+    uint32_t nextRef = 0;
+};
+
+class Decoder {
+public:
+    explicit Decoder(ClonedMessage &in) : in(in) {}
+
+    Value read() {
+        char tag = in.data.at(pos++);
+        switch (tag) {
+        case TagNil: return Value(std::monostate{});
+        case TagTrue: return Value(true);
+        case TagFalse: return Value(false);
+        case TagNumber: {
+            double d;
+            readRaw(&d, sizeof(d));
+            return Value(d);
+        }
+        case TagString: return Value(readString());
+        case TagLargeString: return Value(std::move(in.strings.at(readU32())));
+        case TagMovedArray: {
+            auto arr = std::make_shared<FSKArray>(std::vector<Value>{});
+            arr->elements = std::move(in.arrays.at(readU32()));
+            refs.push_back(Value(arr));
+            return Value(arr);
+        }
+        case TagArray: {
+            uint32_t count = readU32();
+            auto arr = std::make_shared<FSKArray>(std::vector<Value>{});
+            refs.push_back(Value(arr));
+            arr->elements.reserve(count);
+            for (uint32_t i = 0; i < count; i++) arr->elements.push_back(read());
+            return Value(arr);
+        }
+        case TagObject: {
+            static auto objClass = std::make_shared<FSKClass>("Object", nullptr, std::map<std::string, std::shared_ptr<Callable>>());
+            uint32_t count = readU32();
+            auto obj = std::make_shared<FSKInstance>(objClass);
+            refs.push_back(Value(obj));
+            for (uint32_t i = 0; i < count; i++) {
+                std::string key = readString();
+                obj->fields[key] = read();
+            }
+            return Value(obj);
+        }
+        case TagSharedBuffer: {
+            Value buffer(std::static_pointer_cast<FSKInstance>(makeSharedBuffer(in.shared.at(readU32()))));
+            refs.push_back(buffer);
+            return buffer;
+        }
+        case TagTypedView: {
+            auto memory = in.shared.at(readU32());
+            auto kind = (FSKTypedView::Kind)in.data.at(pos++);
+            uint64_t offset, length;
+            readRaw(&offset, sizeof(offset));
+            readRaw(&length, sizeof(length));
+            Value view(std::static_pointer_cast<FSKInstance>(makeTypedView(memory, kind, offset, length)));
+            refs.push_back(view);
+            return view;
+        }
+        case TagChannel: {
+            Value channel(std::static_pointer_cast<FSKInstance>(makeChannel(in.channels.at(readU32()))));
+            refs.push_back(channel);
+            return channel;
+        }
+        case TagRef: return refs.at(readU32());
+        }
+        throw std::runtime_error("Message clone corrompu.");
+    }
+
+private:
+    void readRaw(void *dst, size_t size) {
+        if (pos + size > in.data.size()) throw std::runtime_error("Message clone corrompu.");
+        std::memcpy(dst, in.data.data() + pos, size);
+        pos += size;
+    }
+
+    uint32_t readU32() {
+        uint32_t n;
+        readRaw(&n, sizeof(n));
+        return n;
+    }
+
+    std::string readString() {
+        uint32_t size = readU32();
+        if (pos + size > in.data.size()) throw std::runtime_error("Message clone corrompu.");
+        std::string s = in.data.substr(pos, size);
+        pos += size;
+        return s;
+    }
+
+    ClonedMessage &in;
+    size_t pos = 0;
+    std::vector<Value> refs;
+};
+
+} // namespace
+
+ClonedMessage ClonedMessage::fromValue(Value value, bool transfer) {
+    ClonedMessage message;
+    Encoder(message, transfer).write(value, true);
+    return message;
+}
+
+Value ClonedMessage::toValue() {
+    if (data.empty()) return Value(std::monostate{});
+    return Decoder(*this).read();
+}
@@ -0,0 +1,148 @@
+#include "WorkerPool.hpp"
+#include "Callable.hpp"
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include <fstream>
+#include <sstream>
+
+WorkerPool::WorkerPool(std::string scriptPath, size_t size) : scriptPath(std::move(scriptPath)) {
+    if (size == 0) size = 1;
+    for (size_t i = 0; i < size; i++) {
+        members.push_back(std::make_unique<Member>());
+    }
+    for (size_t i = 0; i < size; i++) {
+        threads.emplace_back([this, i]() { memberLoop(i); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    close();
+    for (auto &t : threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+bool WorkerPool::submit(Job job) {
+    size_t target = nextMember++ % members.size();
+    {
+        // Push and count together so a member never takes a job it has not seen counted.
+        std::lock_guard<std::mutex> wakeLock(wakeMutex);
+        // Members leave once closed and drained: a later job would never run.
+        if (closed) return false;
+        std::lock_guard<std::mutex> lock(members[target]->mutex);
+        members[target]->jobs.push_back(std::move(job));
+        pending++;
+    }
+    wake.notify_one();
+    return true;
+}
+
+void WorkerPool::close() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        closed = true;
+    }
+    wake.notify_all();
+}
+
+WorkerPool::Stats WorkerPool::stats() {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    return {members.size(), idle.load(), pending, completed.load(), stolen.load()};
+}
+
+// Own jobs come off the front; stolen ones off the back of the victim's deque.
+bool WorkerPool::take(size_t self, Job &job) {
+    {
+        auto &own = *members[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.front());
+            own.jobs.pop_front();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < members.size(); offset++) {
+        auto &victim = *members[(self + offset) % members.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+            stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::memberLoop(size_t self) {
+    // Warm-up: build the interpreter and run the script's top level once.
+    Interpreter interp;
+    interp.isWorker = true;
+    interp.workerIncoming = std::make_shared<ThreadSafeQueue<ClonedMessage>>();
+    interp.workerOutgoing = std::make_shared<ThreadSafeQueue<ClonedMessage>>();
+
+    std::shared_ptr<Callable> handler;
+    std::string loadError;
+    std::ifstream file(scriptPath);
+    if (file.is_open()) {
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        Lexer lexer(buffer.str());
+        Parser parser(lexer.scanTokens());
+        interp.interpret(parser.parse(), false);
+        try {
+            Value fn = interp.globals->get("onJob");
+            if (auto callable = std::get_if<std::shared_ptr<Callable>>(&fn)) handler = *callable;
+        } catch (const std::runtime_error &) {}
+        if (!handler) loadError = "Worker.pool: le script doit définir onJob(data).";
+    } else {
+        loadError = "Worker.pool: impossible d'ouvrir " + scriptPath;
+    }
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            idle++;
+            wake.wait(lock, [this] { return pending > 0 || closed; });
+            idle--;
+            if (pending == 0 && closed) return;
+        }
+        if (!take(self, job)) continue;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            pending--;
+        }
+
+        bool ok = false;
+        Value result = Value(loadError);
+        if (handler) {
+            try {
+                Value value = handler->call(interp, {job.payload.toValue()});
+                if (auto inst = std::get_if<std::shared_ptr<FSKInstance>>(&value)) {
+                    if (auto promise = std::dynamic_pointer_cast<FSKPromise>(*inst)) {
+                        value = promise->wait(interp);
+                    }
+                }
+                result = value;
+                ok = true;
+            } catch (const FSKException &e) {
+                result = e.value;
+            } catch (const std::runtime_error &e) {
+                result = Value(std::string(e.what()));
+            }
+            interp.callStack.clear();
+        }
+
+        ClonedMessage reply;
+        try {
+            reply = ClonedMessage::fromValue(std::move(result));
+        } catch (const std::runtime_error &e) {
+            ok = false;
+            reply = ClonedMessage::fromValue(Value(std::string(e.what())));
+        }
+        completed++;
+        job.done(ok, std::move(reply));
+    }
+}